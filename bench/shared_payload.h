@@ -0,0 +1,23 @@
+#ifndef SHARED_PAYLOAD_H
+#define SHARED_PAYLOAD_H
+
+#include <stdint.h>
+
+/*
+ * Face payload layout used by the benchmark. Applications provide their own
+ * shared_payload.h; the manager only needs face_payload_header_t and the two
+ * FACE_PAYLOAD_* accessors.
+ */
+typedef struct {
+    uint32_t frame_id;
+    uint16_t num_keypoints;  // ints following the header
+    uint16_t width;
+    uint16_t height;
+    uint16_t reserved;
+    uint32_t image_len;      // image bytes following the keypoints
+} face_payload_header_t;
+
+#define FACE_PAYLOAD_KEYPOINT_COUNT(h) ((size_t)(h)->num_keypoints)
+#define FACE_PAYLOAD_IMAGE_LEN(h) ((size_t)(h)->image_len)
+
+#endif // SHARED_PAYLOAD_H
@@ -0,0 +1,326 @@
+/*
+ * Host benchmark for the zenoh manager (ESP-IDF linux target, see readme).
+ *
+ * Run one consumer and one server build side by side:
+ *   consumer (I_AM_CONSUMER_OR_SERVER=1): publishes bursts on KEYEXPR_ANNOUNCE
+ *       "/bench/data" for every payload size, times face payload publication and
+ *       serves GETs on KEYEXPR_DATA_QUERY "/bench".
+ *   server   (I_AM_CONSUMER_OR_SERVER=0): counts the bursts and reports them back
+ *       on KEYEXPR_RESULTS "/bench/report", then measures the GET round trip.
+ *
+ * BENCH_PROTOCOL=udp|tcp selects the transport (default: zenoh_config.h),
+ * BENCH_CONNECT the endpoint a TCP consumer connects to (default: tcp/<ip>:ZENOH_PORT
+ * with the address a server on the same host listens on, see build_config()),
+ * BENCH_MESSAGES the number of puts per payload size.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "zenoh_manager.h"
+#include "zenoh_platform.h"
+#include "zenoh_utils.h"
+
+static const char *TAG = "ZENOH_BENCH";
+
+#define BENCH_KEY_DATA   KEYEXPR_ANNOUNCE "/bench/data"
+#define BENCH_KEY_END    KEYEXPR_ANNOUNCE "/bench/end"
+#define BENCH_KEY_DONE   KEYEXPR_ANNOUNCE "/bench/done"
+#define BENCH_KEY_REPORT KEYEXPR_RESULTS "/bench/report"
+#define BENCH_KEY_QUERY  KEYEXPR_DATA_QUERY "/bench"
+
+#define BENCH_DEFAULT_MESSAGES 2000
+#define BENCH_QUERY_ROUNDS     200
+#define BENCH_QUERY_REPLY_LEN  64
+#define BENCH_FACE_ROUNDS      200
+#define BENCH_FACE_KEYPOINTS   10
+#define BENCH_FACE_IMAGE_LEN   (16 * 1024)
+#define BENCH_WAIT_MS          10000
+
+static const size_t k_payload_sizes[] = { 16, 64, 256, 1024, 4096, 16384 };
+#define BENCH_RUNS (sizeof(k_payload_sizes) / sizeof(k_payload_sizes[0]))
+
+// First bytes of every BENCH_KEY_DATA put, and the body of BENCH_KEY_END
+typedef struct {
+    uint32_t run;
+    uint32_t seq;
+} bench_msg_t;
+
+// BENCH_KEY_REPORT: what the server saw of one run, or of the query test (run = BENCH_RUNS)
+typedef struct {
+    uint32_t run;
+    uint32_t received;
+    uint64_t bytes;
+    uint32_t span_us;     // first to last sample of the run
+    uint32_t avg_us;      // query test: round trip
+    uint32_t max_us;
+} bench_report_t;
+
+static EventGroupHandle_t s_events;
+static SemaphoreHandle_t s_signal;
+static bench_report_t s_report;
+
+static uint32_t bench_messages() {
+    const char *env = getenv("BENCH_MESSAGES");
+    long n = env ? strtol(env, NULL, 10) : 0;
+    return n > 0 ? (uint32_t)n : BENCH_DEFAULT_MESSAGES;
+}
+
+// Protocol and endpoints from the environment on top of the zenoh_config.h defaults
+static void bench_settings(zenoh_settings_t *settings) {
+    zenoh_settings_defaults(settings);
+    const char *proto = getenv("BENCH_PROTOCOL");
+    if (proto != NULL && strcmp(proto, "tcp") == 0) {
+        strcpy(settings->protocol, "tcp");
+        settings->listen_ip[0] = '\0';
+#if I_AM_CONSUMER_OR_SERVER == 1
+        const char *connect = getenv("BENCH_CONNECT");
+        strcpy(settings->mode, "client");
+        if (connect != NULL) {
+            snprintf(settings->connect, sizeof(settings->connect), "%s", connect);
+        } else {
+            // A TCP server listens on the active interface (not loopback if there is another one)
+            network_info_t net = active_network_interface("BENCH");
+            snprintf(settings->connect, sizeof(settings->connect), "tcp/%s:%s",
+                    net.ip_address[0] != '\0' ? net.ip_address : "127.0.0.1", ZENOH_PORT);
+        }
+#endif
+    } else if (proto != NULL && strcmp(proto, "udp") == 0) {
+        strcpy(settings->protocol, "udp");
+        strcpy(settings->mode, "peer");
+        snprintf(settings->listen_ip, sizeof(settings->listen_ip), "%s", ZENOH_UDP_MULTICAST_IP);
+    }
+    // Every put should reach the wire on its own
+    settings->batching = false;
+}
+
+static bool key_is(const z_loaned_sample_t *sample, const char *key) {
+    z_view_string_t ks;
+    z_keyexpr_as_view_string(z_sample_keyexpr(sample), &ks);
+    size_t n = strlen(key);
+    return z_string_len(z_loan(ks)) == n && memcmp(z_string_data(z_loan(ks)), key, n) == 0;
+}
+
+#if I_AM_CONSUMER_OR_SERVER == 1
+
+// Replies to every bench GET with a small fixed payload
+static int bench_query_provider(void *ctx, zenoh_query_ctx_t *query) {
+    static const uint8_t reply[BENCH_QUERY_REPLY_LEN] = { 0 };
+    (void)ctx;
+    return zenoh_query_reply_data(query, reply, sizeof(reply)) < 0 ? -1 : ZENOH_STREAM_DONE;
+}
+
+static void bench_data_handler(z_loaned_sample_t *sample, void *arg) {
+    (void)arg;
+    if (!key_is(sample, BENCH_KEY_REPORT)) { return; }
+    if (zenoh_bytes_read_at(z_sample_payload(sample), 0, (uint8_t *)&s_report, sizeof(s_report)) == sizeof(s_report)) {
+        xSemaphoreGive(s_signal);
+    }
+}
+
+static bool wait_report(uint32_t run) {
+    while (xSemaphoreTake(s_signal, pdMS_TO_TICKS(BENCH_WAIT_MS)) == pdTRUE) {
+        if (s_report.run == run) { return true; }
+    }
+    return false;
+}
+
+static void bench_throughput(uint32_t messages) {
+    ESP_LOGI(TAG, "%8s %8s %10s %10s %9s %10s %10s", "size", "sent", "tx msg/s", "tx MB/s", "loss %", "rx msg/s", "rx MB/s");
+    for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+        size_t size = k_payload_sizes[run];
+        uint8_t *buf = (uint8_t *)calloc(1, size);
+        if (buf == NULL) { return; }
+        int64_t started_us = esp_timer_get_time();
+        uint32_t sent = 0;
+        for (uint32_t seq = 0; seq < messages; seq++) {
+            bench_msg_t msg = { run, seq };
+            memcpy(buf, &msg, size < sizeof(msg) ? size : sizeof(msg));
+            z_owned_bytes_t payload;
+            // Serialized before the put returns, the buffer is reused right away
+            if (z_bytes_from_static_buf(&payload, buf, size) != Z_OK) { break; }
+            if (zenoh_publish_bytes(BENCH_KEY_DATA, &payload, NULL) >= 0) { sent++; }
+        }
+        int64_t elapsed_us = esp_timer_get_time() - started_us;
+        free(buf);
+
+        bench_msg_t end = { run, sent };
+        z_owned_bytes_t payload;
+        z_bytes_copy_from_buf(&payload, (const uint8_t *)&end, sizeof(end));
+        zenoh_publish_bytes(BENCH_KEY_END, &payload, NULL);
+        if (!wait_report(run)) {
+            ESP_LOGE(TAG, "❗No report for run %lu (size %u)❗", (unsigned long)run, (unsigned)size);
+            continue;
+        }
+        double tx_s = elapsed_us > 0 ? elapsed_us / 1e6 : 1e-6;
+        double rx_s = s_report.span_us > 0 ? s_report.span_us / 1e6 : 1e-6;
+        double loss = sent ? 100.0 * (sent - (s_report.received < sent ? s_report.received : sent)) / sent : 0.0;
+        ESP_LOGI(TAG, "%8u %8lu %10.0f %10.2f %9.2f %10.0f %10.2f", (unsigned)size, (unsigned long)sent,
+                sent / tx_s, sent * size / tx_s / 1e6, loss,
+                s_report.received / rx_s, s_report.bytes / rx_s / 1e6);
+    }
+}
+
+static void bench_face_payload() {
+    static int32_t keypoints[BENCH_FACE_KEYPOINTS * 2];
+    face_payload_header_t header = {};
+    header.num_keypoints = BENCH_FACE_KEYPOINTS * 2;
+    header.width = 96;
+    header.height = 96;
+    header.image_len = BENCH_FACE_IMAGE_LEN;
+
+    zenoh_stats_reset();
+    uint32_t max_us = 0;
+    int64_t total_us = 0;
+    for (uint32_t i = 0; i < BENCH_FACE_ROUNDS; i++) {
+        // The manager takes the image and frees it once sent
+        uint8_t *image = (uint8_t *)zenoh_psram_malloc(BENCH_FACE_IMAGE_LEN);
+        if (image == NULL) { break; }
+        memset(image, (int)i, BENCH_FACE_IMAGE_LEN);
+        header.frame_id = i;
+        int64_t started_us = esp_timer_get_time();
+        zenoh_publish_face_payload(KEYEXPR_ANNOUNCE "/bench/face", &header, keypoints, image);
+        uint32_t us = (uint32_t)(esp_timer_get_time() - started_us);
+        total_us += us;
+        if (us > max_us) { max_us = us; }
+    }
+    zenoh_stats_t stats;
+    zenoh_get_stats(&stats);
+    ESP_LOGI(TAG, "face payload %u B: %lu publishes, call avg %lu us max %lu us, put avg %lu us max %lu us",
+            (unsigned)(sizeof(header) + sizeof(keypoints) + BENCH_FACE_IMAGE_LEN), (unsigned long)stats.publishes,
+            (unsigned long)(total_us / BENCH_FACE_ROUNDS), (unsigned long)max_us,
+            (unsigned long)stats.put_latency.avg_us, (unsigned long)stats.put_latency.max_us);
+}
+
+static void bench_run() {
+    zenoh_register_queryable(BENCH_KEY_QUERY, bench_query_provider, NULL);
+    bench_throughput(bench_messages());
+    bench_face_payload();
+
+    // Hand over to the server for the query test and wait for its result
+    z_owned_bytes_t payload;
+    z_bytes_copy_from_str(&payload, "done");
+    zenoh_publish_bytes(BENCH_KEY_DONE, &payload, NULL);
+    if (wait_report(BENCH_RUNS)) {
+        ESP_LOGI(TAG, "query round trip: %lu replies, avg %lu us max %lu us",
+                (unsigned long)s_report.received, (unsigned long)s_report.avg_us, (unsigned long)s_report.max_us);
+    } else {
+        ESP_LOGE(TAG, "❗No query report from the server❗");
+    }
+}
+
+#else // server
+
+// Per run receive counters, written by the data handler only
+static struct {
+    uint32_t run;
+    uint32_t received;
+    uint64_t bytes;
+    int64_t first_us;
+    int64_t last_us;
+} s_rx = { BENCH_RUNS, 0, 0, 0, 0 };
+static volatile bool s_done = false;
+static volatile int64_t s_reply_us = 0;
+
+static void publish_report(const bench_report_t *report) {
+    z_owned_bytes_t payload;
+    z_bytes_copy_from_buf(&payload, (const uint8_t *)report, sizeof(*report));
+    zenoh_publish_bytes(BENCH_KEY_REPORT, &payload, NULL);
+}
+
+static void bench_data_handler(z_loaned_sample_t *sample, void *arg) {
+    (void)arg;
+    const z_loaned_bytes_t *bytes = z_sample_payload(sample);
+    bench_msg_t msg;
+    if (key_is(sample, BENCH_KEY_DATA)) {
+        int64_t now = esp_timer_get_time();
+        size_t len = z_bytes_len(bytes);
+        if (zenoh_bytes_read_at(bytes, 0, (uint8_t *)&msg, sizeof(msg)) < sizeof(msg)) {
+            msg.run = s_rx.run; // too small to carry the header, keep counting the current run
+        }
+        if (msg.run != s_rx.run) {
+            s_rx.run = msg.run;
+            s_rx.received = 0;
+            s_rx.bytes = 0;
+            s_rx.first_us = now;
+        }
+        s_rx.received++;
+        s_rx.bytes += len;
+        s_rx.last_us = now;
+    } else if (key_is(sample, BENCH_KEY_END)) {
+        if (zenoh_bytes_read_at(bytes, 0, (uint8_t *)&msg, sizeof(msg)) != sizeof(msg)) { return; }
+        bench_report_t report = {};
+        report.run = msg.run;
+        if (s_rx.run == msg.run) {
+            report.received = s_rx.received;
+            report.bytes = s_rx.bytes;
+            report.span_us = (uint32_t)(s_rx.last_us - s_rx.first_us);
+        }
+        ESP_LOGI(TAG, "run %lu: %lu/%lu received", (unsigned long)msg.run,
+                (unsigned long)report.received, (unsigned long)msg.seq);
+        publish_report(&report);
+    } else if (key_is(sample, BENCH_KEY_DONE)) {
+        s_done = true;
+        xSemaphoreGive(s_signal);
+    }
+}
+
+static void bench_reply_handler(z_loaned_reply_t *reply, const z_loaned_bytes_t *payload, void *arg) {
+    (void)reply;
+    (void)arg;
+    if (payload != NULL) {
+        s_reply_us = esp_timer_get_time();
+        xSemaphoreGive(s_signal);
+    }
+}
+
+static void bench_run() {
+    while (!s_done) {
+        xSemaphoreTake(s_signal, portMAX_DELAY);
+    }
+    bench_report_t report = {};
+    report.run = BENCH_RUNS;
+    uint64_t total_us = 0;
+    for (uint32_t i = 0; i < BENCH_QUERY_ROUNDS; i++) {
+        int64_t started_us = esp_timer_get_time();
+        zenoh_get_data(BENCH_KEY_QUERY, bench_reply_handler, NULL);
+        if (xSemaphoreTake(s_signal, pdMS_TO_TICKS(BENCH_WAIT_MS)) != pdTRUE) { continue; }
+        uint32_t us = (uint32_t)(s_reply_us - started_us);
+        total_us += us;
+        report.received++;
+        if (us > report.max_us) { report.max_us = us; }
+    }
+    report.avg_us = report.received ? (uint32_t)(total_us / report.received) : 0;
+    ESP_LOGI(TAG, "query round trip: %lu/%d replies, avg %lu us max %lu us", (unsigned long)report.received,
+            BENCH_QUERY_ROUNDS, (unsigned long)report.avg_us, (unsigned long)report.max_us);
+    publish_report(&report);
+    vTaskDelay(pdMS_TO_TICKS(500)); // let the report leave before the session closes
+}
+
+#endif // I_AM_CONSUMER_OR_SERVER
+
+extern "C" void app_main() {
+    s_events = xEventGroupCreate();
+    s_signal = xSemaphoreCreateCounting(16, 0);
+
+    zenoh_settings_t settings;
+    bench_settings(&settings);
+    ESP_LOGI(TAG, "Benchmark as %s over %s (%s)", I_AM_CONSUMER_OR_SERVER ? "consumer" : "server",
+            settings.protocol, settings.mode);
+    zenoh_client_init_with_settings(s_events, bench_data_handler, &settings);
+
+    EventBits_t bits = xEventGroupWaitBits(s_events, ZENOH_DECLARED_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(30000));
+    if (!(bits & ZENOH_DECLARED_BIT)) {
+        ESP_LOGE(TAG, "❗Zenoh resources not declared, giving up❗");
+        exit(1);
+    }
+    vTaskDelay(pdMS_TO_TICKS(1000)); // let the other side declare its subscribers
+    bench_run();
+    zenoh_client_stop();
+    exit(0);
+}
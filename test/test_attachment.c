@@ -0,0 +1,102 @@
+/*
+ * test_attachment.c
+ *
+ * Attachment TLV encoding (zenoh_attachment_begin / _add) and lookup.
+ */
+
+#include "zenoh_attachment.h"
+#include <string.h>
+#include "unity.h"
+
+static z_id_t test_zid(void) {
+    z_id_t zid;
+    for (size_t i = 0; i < sizeof(zid.id); i++) { zid.id[i] = (uint8_t)(0xA0 + i); }
+    return zid;
+}
+
+// Looks type up in the len bytes of buf, sent as an attachment
+static bool find_in(const uint8_t *buf, size_t len, uint8_t type, uint8_t *value, size_t *value_len) {
+    z_owned_bytes_t bytes;
+    TEST_ASSERT_EQUAL(Z_OK, z_bytes_copy_from_buf(&bytes, buf, len));
+    bool found = zenoh_attachment_find(z_loan(bytes), type, value, value_len);
+    z_drop(z_move(bytes));
+    return found;
+}
+
+TEST_CASE("attachment carries liveness and added fields", "[attachment]") {
+    z_id_t zid = test_zid();
+    zenoh_attachment_init(&zid);
+    uint8_t buf[ZENOH_ATTACH_MAX_LEN];
+    size_t len = zenoh_attachment_begin(buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(ZENOH_ATTACH_HEADER_LEN + 2 + sizeof(zid.id), len);
+    const uint8_t trace[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+    TEST_ASSERT_TRUE(zenoh_attachment_add(buf, sizeof(buf), &len, ZENOH_ATTACH_TRACE, trace, sizeof(trace)));
+    TEST_ASSERT_EQUAL_UINT8(2, buf[3]);
+
+    uint8_t value[32];
+    size_t value_len = sizeof(value);
+    TEST_ASSERT_TRUE(find_in(buf, len, ZENOH_ATTACH_LIVENESS, value, &value_len));
+    TEST_ASSERT_EQUAL(sizeof(zid.id), value_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(zid.id, value, sizeof(zid.id));
+    value_len = sizeof(value);
+    TEST_ASSERT_TRUE(find_in(buf, len, ZENOH_ATTACH_TRACE, value, &value_len));
+    TEST_ASSERT_EQUAL(sizeof(trace), value_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(trace, value, sizeof(trace));
+    value_len = sizeof(value);
+    TEST_ASSERT_FALSE(find_in(buf, len, ZENOH_ATTACH_ORIGIN, value, &value_len));
+
+    z_id_t self;
+    TEST_ASSERT_TRUE(zenoh_attachment_self(&self));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(zid.id, self.id, sizeof(zid.id));
+}
+
+TEST_CASE("attachment field beyond the buffer is not added", "[attachment]") {
+    z_id_t zid = test_zid();
+    zenoh_attachment_init(&zid);
+    uint8_t buf[ZENOH_ATTACH_MAX_LEN];
+    TEST_ASSERT_EQUAL(0, zenoh_attachment_begin(buf, ZENOH_ATTACH_HEADER_LEN + 2));
+    size_t len = zenoh_attachment_begin(buf, sizeof(buf));
+    size_t begun = len;
+    uint8_t big[ZENOH_ATTACH_MAX_LEN] = { 0 };
+    TEST_ASSERT_FALSE(zenoh_attachment_add(buf, sizeof(buf), &len, ZENOH_ATTACH_ORIGIN, big,
+            (uint8_t)(sizeof(buf) - begun - 1)));
+    TEST_ASSERT_EQUAL(begun, len);
+    TEST_ASSERT_EQUAL_UINT8(1, buf[3]);
+    TEST_ASSERT_TRUE(zenoh_attachment_add(buf, sizeof(buf), &len, ZENOH_ATTACH_ORIGIN, big,
+            (uint8_t)(sizeof(buf) - begun - 2)));
+    TEST_ASSERT_EQUAL(sizeof(buf), len);
+}
+
+TEST_CASE("attachment lookup skips unknown fields", "[attachment]") {
+    const uint8_t buf[] = { ZENOH_ATTACH_MAGIC0, ZENOH_ATTACH_MAGIC1, ZENOH_ATTACH_VERSION, 2,
+                            0x7F, 3, 'x', 'y', 'z',
+                            ZENOH_ATTACH_TRACE, 1, 0x55 };
+    uint8_t value[4];
+    size_t value_len = sizeof(value);
+    TEST_ASSERT_TRUE(find_in(buf, sizeof(buf), ZENOH_ATTACH_TRACE, value, &value_len));
+    TEST_ASSERT_EQUAL(1, value_len);
+    TEST_ASSERT_EQUAL_HEX8(0x55, value[0]);
+}
+
+TEST_CASE("attachment lookup rejects malformed attachments", "[attachment]") {
+    uint8_t value[8];
+    size_t value_len = sizeof(value);
+    TEST_ASSERT_FALSE(zenoh_attachment_find(NULL, ZENOH_ATTACH_TRACE, value, &value_len));
+
+    // Field running past the end
+    const uint8_t truncated[] = { ZENOH_ATTACH_MAGIC0, ZENOH_ATTACH_MAGIC1, ZENOH_ATTACH_VERSION, 1,
+                                  ZENOH_ATTACH_TRACE, 4, 1, 2 };
+    TEST_ASSERT_FALSE(find_in(truncated, sizeof(truncated), ZENOH_ATTACH_TRACE, value, &value_len));
+    // Count larger than the fields present
+    const uint8_t short_count[] = { ZENOH_ATTACH_MAGIC0, ZENOH_ATTACH_MAGIC1, ZENOH_ATTACH_VERSION, 3,
+                                    0x7F, 1, 0 };
+    TEST_ASSERT_FALSE(find_in(short_count, sizeof(short_count), ZENOH_ATTACH_TRACE, value, &value_len));
+    // Other version, and a field larger than value
+    const uint8_t other_version[] = { ZENOH_ATTACH_MAGIC0, ZENOH_ATTACH_MAGIC1, ZENOH_ATTACH_VERSION + 1, 1,
+                                      ZENOH_ATTACH_TRACE, 1, 0 };
+    TEST_ASSERT_FALSE(find_in(other_version, sizeof(other_version), ZENOH_ATTACH_TRACE, value, &value_len));
+    const uint8_t too_big[] = { ZENOH_ATTACH_MAGIC0, ZENOH_ATTACH_MAGIC1, ZENOH_ATTACH_VERSION, 1,
+                                ZENOH_ATTACH_TRACE, 2, 1, 2 };
+    value_len = 1;
+    TEST_ASSERT_FALSE(find_in(too_big, sizeof(too_big), ZENOH_ATTACH_TRACE, value, &value_len));
+}
@@ -0,0 +1,81 @@
+/*
+ * test_batch.c
+ *
+ * Batch framing: record encoding, the record walk of the receiver and the key
+ * list match. zenoh_batch.c is included to reach its static helpers, so the
+ * test build does not compile it on its own.
+ */
+
+#define ZENOH_BATCH_KEYEXPRS ZENOH_BATCH_KEY("test/batch")
+#include "zenoh_batch.c"
+#include <string.h>
+#include "unity.h"
+
+#if ZENOH_BATCHING_ON
+
+static size_t batch_begin(uint8_t *buf) {
+    buf[0] = ZENOH_BATCH_MAGIC0;
+    buf[1] = ZENOH_BATCH_MAGIC1;
+    buf[2] = ZENOH_BATCH_VERSION;
+    buf[3] = 0;
+    return ZENOH_BATCH_HEADER_LEN;
+}
+
+TEST_CASE("batch records round trip through the record walk", "[batch]") {
+    static uint8_t buf[ZENOH_BATCH_MAX_BYTES];
+    uint8_t big[300];
+    memset(big, 0x5A, sizeof(big));
+    size_t used = batch_begin(buf);
+    batch_put_record(buf, &used, (const uint8_t *)"abc", 3);
+    batch_put_record(buf, &used, (const uint8_t *)"", 0);
+    batch_put_record(buf, &used, big, sizeof(big));
+    TEST_ASSERT_EQUAL_UINT8(3, buf[3]);
+    TEST_ASSERT_EQUAL(ZENOH_BATCH_HEADER_LEN + 3 * ZENOH_BATCH_RECORD_HEADER_LEN + 3 + sizeof(big), used);
+    // Little endian length of the third record
+    size_t third = ZENOH_BATCH_HEADER_LEN + 2 * ZENOH_BATCH_RECORD_HEADER_LEN + 3;
+    TEST_ASSERT_EQUAL_HEX8(sizeof(big) & 0xFF, buf[third]);
+    TEST_ASSERT_EQUAL_HEX8(sizeof(big) >> 8, buf[third + 1]);
+
+    size_t off = ZENOH_BATCH_HEADER_LEN;
+    const uint8_t *record;
+    size_t len;
+    TEST_ASSERT_TRUE(batch_next_record(buf, used, &off, &record, &len));
+    TEST_ASSERT_EQUAL(3, len);
+    TEST_ASSERT_EQUAL_MEMORY("abc", record, 3);
+    TEST_ASSERT_TRUE(batch_next_record(buf, used, &off, &record, &len));
+    TEST_ASSERT_EQUAL(0, len);
+    TEST_ASSERT_TRUE(batch_next_record(buf, used, &off, &record, &len));
+    TEST_ASSERT_EQUAL(sizeof(big), len);
+    TEST_ASSERT_EQUAL_MEMORY(big, record, sizeof(big));
+    TEST_ASSERT_EQUAL(used, off);
+    TEST_ASSERT_FALSE(batch_next_record(buf, used, &off, &record, &len));
+}
+
+TEST_CASE("batch record walk stops at truncated records", "[batch]") {
+    uint8_t buf[32];
+    size_t used = batch_begin(buf);
+    batch_put_record(buf, &used, (const uint8_t *)"0123456789", 10);
+    const uint8_t *record;
+    size_t len;
+    // Body cut short
+    size_t off = ZENOH_BATCH_HEADER_LEN;
+    TEST_ASSERT_FALSE(batch_next_record(buf, used - 1, &off, &record, &len));
+    TEST_ASSERT_EQUAL(ZENOH_BATCH_HEADER_LEN, off);
+    // Record header cut short
+    TEST_ASSERT_FALSE(batch_next_record(buf, ZENOH_BATCH_HEADER_LEN + 1, &off, &record, &len));
+    TEST_ASSERT_EQUAL(ZENOH_BATCH_HEADER_LEN, off);
+    // Length field larger than the batch
+    buf[ZENOH_BATCH_HEADER_LEN + 1] = 0xFF;
+    TEST_ASSERT_FALSE(batch_next_record(buf, used, &off, &record, &len));
+}
+
+TEST_CASE("batch keys match listed prefixes on segment boundaries", "[batch]") {
+    TEST_ASSERT_TRUE(key_is_batched("test/batch", strlen("test/batch")));
+    TEST_ASSERT_TRUE(key_is_batched("test/batch/cam1", strlen("test/batch/cam1")));
+    TEST_ASSERT_TRUE(key_is_batched("test/batch/cam1", strlen("test/batch"))); // key_len bytes only
+    TEST_ASSERT_FALSE(key_is_batched("test/batchy", strlen("test/batchy")));
+    TEST_ASSERT_FALSE(key_is_batched("test", strlen("test")));
+    TEST_ASSERT_FALSE(key_is_batched("other/batch", strlen("other/batch")));
+}
+
+#endif // ZENOH_BATCHING_ON
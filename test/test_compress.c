@@ -0,0 +1,164 @@
+/*
+ * test_compress.c
+ *
+ * LZ compression round trips and the bounds checks of the decoder.
+ * zenoh_compress.c is included to reach lz_decompress(), so the test build
+ * does not compile it on its own.
+ */
+
+#include "zenoh_compress.c"
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+
+#if ZENOH_COMPRESSION_ON
+
+// Incompressible bytes, the same for a given seed
+static void fill_noise(uint8_t *buf, size_t len, uint32_t seed) {
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+// Compresses src, checks it shrank and decompresses it back through zenoh_decompress()
+static void round_trip(const uint8_t *src, size_t len) {
+    uint8_t *packed = NULL;
+    size_t packed_len = zenoh_compress(src, len, &packed);
+    TEST_ASSERT_TRUE(packed_len > ZENOH_COMPRESS_HEADER_LEN);
+    TEST_ASSERT_TRUE(packed_len < len);
+
+    z_owned_bytes_t in, out;
+    TEST_ASSERT_EQUAL(Z_OK, z_bytes_copy_from_buf(&in, packed, packed_len));
+    zenoh_compress_free(packed, NULL);
+    TEST_ASSERT_TRUE(zenoh_decompress(z_loan(in), &out));
+    TEST_ASSERT_EQUAL(len, z_bytes_len(z_loan(out)));
+    uint8_t *plain = malloc(len);
+    TEST_ASSERT_NOT_NULL(plain);
+    TEST_ASSERT_EQUAL(len, zenoh_bytes_read_at(z_loan(out), 0, plain, len));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(src, plain, len);
+    free(plain);
+    z_drop(z_move(out));
+    z_drop(z_move(in));
+}
+
+// Compresses src and returns the LZ block (header stripped) in a malloc'd buffer
+static uint8_t *block_of(const uint8_t *src, size_t len, size_t *block_len) {
+    uint8_t *packed = NULL;
+    size_t packed_len = zenoh_compress(src, len, &packed);
+    TEST_ASSERT_TRUE(packed_len > ZENOH_COMPRESS_HEADER_LEN);
+    *block_len = packed_len - ZENOH_COMPRESS_HEADER_LEN;
+    uint8_t *block = malloc(*block_len);
+    TEST_ASSERT_NOT_NULL(block);
+    memcpy(block, packed + ZENOH_COMPRESS_HEADER_LEN, *block_len);
+    zenoh_compress_free(packed, NULL);
+    return block;
+}
+
+TEST_CASE("compress round trip of repetitive text", "[compress]") {
+    static const char line[] = "{\"face\":1,\"x\":120,\"y\":84,\"w\":64,\"h\":64}\n";
+    uint8_t src[2048];
+    for (size_t i = 0; i < sizeof(src); i++) { src[i] = (uint8_t)line[i % (sizeof(line) - 1)]; }
+    round_trip(src, sizeof(src));
+}
+
+TEST_CASE("compress round trip of long literal runs and long matches", "[compress]") {
+    // More than 15 + 255 literals, then a run matched against its own output
+    uint8_t src[1400];
+    fill_noise(src, 300, 1);
+    memset(src + 300, 'a', sizeof(src) - 300);
+    round_trip(src, sizeof(src));
+}
+
+TEST_CASE("compress leaves incompressible and encoded data alone", "[compress]") {
+    uint8_t src[1024];
+    uint8_t *packed = NULL;
+    fill_noise(src, sizeof(src), 7);
+    TEST_ASSERT_EQUAL(0, zenoh_compress(src, sizeof(src), &packed));
+
+    memset(src, 0, sizeof(src));
+    src[0] = 0xFF; src[1] = 0xD8; src[2] = 0xFF; // JPEG
+    TEST_ASSERT_EQUAL(0, zenoh_compress(src, sizeof(src), &packed));
+    src[0] = 0x89; src[1] = 'P'; src[2] = 'N'; src[3] = 'G';
+    TEST_ASSERT_EQUAL(0, zenoh_compress(src, sizeof(src), &packed));
+    TEST_ASSERT_EQUAL(0, zenoh_compress(src + 4, ZENOH_COMPRESS_HEADER_LEN, &packed));
+
+    uint8_t *big = calloc(1, ZENOH_COMPRESS_MAX_BYTES + 1);
+    TEST_ASSERT_NOT_NULL(big);
+    TEST_ASSERT_EQUAL(0, zenoh_compress(big, ZENOH_COMPRESS_MAX_BYTES + 1, &packed));
+    free(big);
+}
+
+TEST_CASE("lz block decodes to its exact length only", "[compress]") {
+    uint8_t src[1400];
+    fill_noise(src, 300, 3);
+    memset(src + 300, 'b', sizeof(src) - 300);
+    size_t block_len;
+    uint8_t *block = block_of(src, sizeof(src), &block_len);
+    uint8_t *dst = malloc(sizeof(src) + 1);
+    TEST_ASSERT_NOT_NULL(dst);
+
+    TEST_ASSERT_TRUE(lz_decompress(block, block_len, dst, sizeof(src)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(src, dst, sizeof(src));
+    TEST_ASSERT_FALSE(lz_decompress(block, block_len, dst, sizeof(src) - 1));
+    TEST_ASSERT_FALSE(lz_decompress(block, block_len, dst, sizeof(src) + 1));
+    // Every truncation fails cleanly
+    for (size_t len = 0; len < block_len; len++) {
+        TEST_ASSERT_FALSE(lz_decompress(block, len, dst, sizeof(src)));
+    }
+    free(dst);
+    free(block);
+}
+
+TEST_CASE("lz block with a bad offset or length is rejected", "[compress]") {
+    uint8_t dst[64];
+    // One literal, then a match reaching before the output
+    const uint8_t before_start[] = { 0x10, 'a', 0x02, 0x00, 0x10, 'z' };
+    TEST_ASSERT_FALSE(lz_decompress(before_start, sizeof(before_start), dst, 6));
+    const uint8_t zero_offset[] = { 0x10, 'a', 0x00, 0x00, 0x10, 'z' };
+    TEST_ASSERT_FALSE(lz_decompress(zero_offset, sizeof(zero_offset), dst, 6));
+    // Literal count continues past the end of the block
+    const uint8_t open_length[] = { 0xF0 };
+    TEST_ASSERT_FALSE(lz_decompress(open_length, sizeof(open_length), dst, sizeof(dst)));
+    const uint8_t long_literals[] = { 0xF0, 0x00, 'a', 'b' };
+    TEST_ASSERT_FALSE(lz_decompress(long_literals, sizeof(long_literals), dst, sizeof(dst)));
+    // Match longer than the output, and a cut offset
+    const uint8_t long_match[] = { 0x1F, 'a', 0x01, 0x00, 0xFF, 0x00 };
+    TEST_ASSERT_FALSE(lz_decompress(long_match, sizeof(long_match), dst, sizeof(dst)));
+    const uint8_t cut_offset[] = { 0x10, 'a', 0x01 };
+    TEST_ASSERT_FALSE(lz_decompress(cut_offset, sizeof(cut_offset), dst, 5));
+    // A match overlapping its own output, then the last literals
+    const uint8_t run[] = { 0x10, 'a', 0x01, 0x00, 0x10, 'z' };
+    TEST_ASSERT_TRUE(lz_decompress(run, sizeof(run), dst, 6));
+    TEST_ASSERT_EQUAL_MEMORY("aaaaaz", dst, 6);
+}
+
+TEST_CASE("decompress passes plain data and bad headers through", "[compress]") {
+    z_owned_bytes_t in, out;
+    const uint8_t plain[] = "not compressed at all";
+    TEST_ASSERT_EQUAL(Z_OK, z_bytes_copy_from_buf(&in, plain, sizeof(plain)));
+    TEST_ASSERT_FALSE(zenoh_decompress(z_loan(in), &out));
+    z_drop(z_move(in));
+
+    uint8_t head[ZENOH_COMPRESS_HEADER_LEN + 2] = { ZENOH_COMPRESS_MAGIC0, ZENOH_COMPRESS_MAGIC1,
+            ZENOH_COMPRESS_MAGIC2, ZENOH_COMPRESS_METHOD_LZ, 0, 0, 0, 0, 0x10, 'a' };
+    TEST_ASSERT_EQUAL(Z_OK, z_bytes_copy_from_buf(&in, head, sizeof(head))); // original length 0
+    TEST_ASSERT_FALSE(zenoh_decompress(z_loan(in), &out));
+    z_drop(z_move(in));
+    write_u32(head + 4, ZENOH_COMPRESS_MAX_BYTES + 1);
+    TEST_ASSERT_EQUAL(Z_OK, z_bytes_copy_from_buf(&in, head, sizeof(head)));
+    TEST_ASSERT_FALSE(zenoh_decompress(z_loan(in), &out));
+    z_drop(z_move(in));
+    write_u32(head + 4, 2); // block holds one byte only
+    TEST_ASSERT_EQUAL(Z_OK, z_bytes_copy_from_buf(&in, head, sizeof(head)));
+    TEST_ASSERT_FALSE(zenoh_decompress(z_loan(in), &out));
+    z_drop(z_move(in));
+    write_u32(head + 4, 1);
+    TEST_ASSERT_EQUAL(Z_OK, z_bytes_copy_from_buf(&in, head, sizeof(head)));
+    TEST_ASSERT_TRUE(zenoh_decompress(z_loan(in), &out));
+    TEST_ASSERT_EQUAL(1, z_bytes_len(z_loan(out)));
+    z_drop(z_move(out));
+    z_drop(z_move(in));
+}
+
+#endif // ZENOH_COMPRESSION_ON
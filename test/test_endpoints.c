@@ -0,0 +1,54 @@
+/*
+ * test_endpoints.c
+ *
+ * Connect endpoint parsing and the configured order before any probe.
+ * zenoh_endpoints.c is included to reach parse_tcp_locator(), so the test
+ * build does not compile it on its own.
+ */
+
+#include "zenoh_endpoints.c"
+#include <string.h>
+#include "unity.h"
+
+TEST_CASE("tcp locator parses into an address", "[endpoints]") {
+    struct sockaddr_in addr;
+    TEST_ASSERT_TRUE(parse_tcp_locator("tcp/192.168.1.10:7447", &addr));
+    TEST_ASSERT_EQUAL(AF_INET, addr.sin_family);
+    TEST_ASSERT_EQUAL_UINT16(7447, ntohs(addr.sin_port));
+    TEST_ASSERT_EQUAL_HEX32(0xC0A8010A, ntohl(addr.sin_addr.s_addr));
+
+    TEST_ASSERT_TRUE(parse_tcp_locator("tcp/10.0.0.1:65535#iface=eth0", &addr));
+    TEST_ASSERT_EQUAL_UINT16(65535, ntohs(addr.sin_port));
+    TEST_ASSERT_TRUE(parse_tcp_locator("tcp/255.255.255.255:1", &addr));
+}
+
+TEST_CASE("locators that cannot be probed are not parsed", "[endpoints]") {
+    struct sockaddr_in addr;
+    TEST_ASSERT_FALSE(parse_tcp_locator("udp/192.168.1.10:7447", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/router.local:7447", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/[::1]:7447", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/192.168.1.10", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/192.168.100.100.1:7447", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/192.168.1.256:7447", &addr));
+}
+
+TEST_CASE("tcp locator port must be 1..65535", "[endpoints]") {
+    struct sockaddr_in addr;
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/192.168.1.10:", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/192.168.1.10:0", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/192.168.1.10:65536", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/192.168.1.10:port", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/192.168.1.10:74x7", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/192.168.1.10:-1", &addr));
+    TEST_ASSERT_FALSE(parse_tcp_locator("tcp/192.168.1.10: 7447", &addr));
+}
+
+TEST_CASE("endpoints keep the configured order before a probe", "[endpoints]") {
+    TEST_ASSERT_EQUAL(sizeof(g_endpoints) / sizeof(g_endpoints[0]), zenoh_endpoints_count());
+    for (size_t i = 0; i < zenoh_endpoints_count(); i++) {
+        const zenoh_endpoint_t *ep = zenoh_endpoint_get(i);
+        TEST_ASSERT_EQUAL_PTR(&g_endpoints[i], ep);
+        TEST_ASSERT_EQUAL_UINT32(ZENOH_ENDPOINT_RTT_UNKNOWN, ep->rtt_us);
+    }
+    TEST_ASSERT_NULL(zenoh_endpoint_get(zenoh_endpoints_count()));
+}
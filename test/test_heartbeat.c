@@ -0,0 +1,113 @@
+/*
+ * test_heartbeat.c
+ *
+ * Heartbeat text and binary codecs. zenoh_heartbeat.c is included to reach its
+ * static decoders, so the test build does not compile it on its own.
+ */
+
+#include "zenoh_heartbeat.c"
+#include <string.h>
+#include "unity.h"
+
+#if HEARTBEAT_ON
+
+static bool decode_str(const char *text, hb_msg_t *out) {
+    return decode_text(text, strlen(text), out);
+}
+
+TEST_CASE("heartbeat text carries counter and zid", "[heartbeat]") {
+    hb_msg_t msg;
+    TEST_ASSERT_TRUE(decode_str(HEARTBEAT_MESSAGE " #42 @0A1B2C", &msg));
+    TEST_ASSERT_EQUAL_UINT32(42, msg.seq);
+    TEST_ASSERT_EQUAL_STRING("0A1B2C", msg.zid);
+    TEST_ASSERT_FALSE(msg.legacy);
+}
+
+TEST_CASE("heartbeat echo text has no message", "[heartbeat]") {
+    hb_msg_t msg;
+    TEST_ASSERT_TRUE(decode_str("#7 @FF00", &msg));
+    TEST_ASSERT_EQUAL_UINT32(7, msg.seq);
+    TEST_ASSERT_EQUAL_STRING("FF00", msg.zid);
+    TEST_ASSERT_FALSE(msg.legacy);
+}
+
+TEST_CASE("legacy heartbeat text is keyed by its message", "[heartbeat]") {
+    hb_msg_t msg;
+    TEST_ASSERT_TRUE(decode_str("ESP32-CAM-Heartbeat  #3", &msg));
+    TEST_ASSERT_EQUAL_UINT32(3, msg.seq);
+    TEST_ASSERT_EQUAL_STRING("ESP32-CAM-Heartbeat", msg.zid);
+    TEST_ASSERT_TRUE(msg.legacy);
+}
+
+TEST_CASE("heartbeat '@' before the counter is part of the message", "[heartbeat]") {
+    hb_msg_t msg;
+    TEST_ASSERT_TRUE(decode_str("cam@lab #5", &msg));
+    TEST_ASSERT_EQUAL_STRING("cam@lab", msg.zid);
+    TEST_ASSERT_TRUE(msg.legacy);
+
+    TEST_ASSERT_TRUE(decode_str("cam@lab #5 @ABCD", &msg));
+    TEST_ASSERT_EQUAL_UINT32(5, msg.seq);
+    TEST_ASSERT_EQUAL_STRING("ABCD", msg.zid);
+    TEST_ASSERT_FALSE(msg.legacy);
+}
+
+TEST_CASE("heartbeat text without counter or zid is rejected", "[heartbeat]") {
+    hb_msg_t msg;
+    TEST_ASSERT_FALSE(decode_str("", &msg));
+    TEST_ASSERT_FALSE(decode_str(HEARTBEAT_MESSAGE, &msg));
+    TEST_ASSERT_FALSE(decode_str(HEARTBEAT_MESSAGE " #", &msg));
+    TEST_ASSERT_FALSE(decode_str(HEARTBEAT_MESSAGE " #x @ABCD", &msg));
+    TEST_ASSERT_FALSE(decode_str(HEARTBEAT_MESSAGE " #1 @", &msg));
+    TEST_ASSERT_FALSE(decode_str("#1", &msg));
+}
+
+TEST_CASE("heartbeat text stops at its length", "[heartbeat]") {
+    hb_msg_t msg;
+    const char *text = "#12 @ABCDtrailing";
+    TEST_ASSERT_TRUE(decode_text(text, strlen("#12 @ABCD"), &msg));
+    TEST_ASSERT_EQUAL_UINT32(12, msg.seq);
+    TEST_ASSERT_EQUAL_STRING("ABCD", msg.zid);
+}
+
+TEST_CASE("heartbeat zid longer than a hex zid is rejected", "[heartbeat]") {
+    char text[8 + ZENOH_HB_ZID_STR_LEN];
+    strcpy(text, "#1 @");
+    size_t n = strlen(text);
+    memset(text + n, 'A', ZENOH_HB_ZID_STR_LEN);
+    text[n + ZENOH_HB_ZID_STR_LEN] = '\0';
+    hb_msg_t msg;
+    TEST_ASSERT_FALSE(decode_str(text, &msg));
+    text[n + ZENOH_HB_ZID_STR_LEN - 1] = '\0'; // exactly a hex zid
+    TEST_ASSERT_TRUE(decode_str(text, &msg));
+}
+
+TEST_CASE("binary heartbeat round trip", "[heartbeat]") {
+    z_id_t zid;
+    for (size_t i = 0; i < sizeof(zid.id); i++) { zid.id[i] = (uint8_t)(i * 17 + 1); }
+    uint8_t buf[ZENOH_HB_BINARY_LEN];
+    TEST_ASSERT_EQUAL(ZENOH_HB_BINARY_LEN, encode_binary(buf, ZENOH_HB_FLAG_ECHO, 0x01020304, &zid));
+
+    hb_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    TEST_ASSERT_TRUE(decode_binary(buf, sizeof(buf), &msg));
+    char expected[ZENOH_HB_ZID_STR_LEN];
+    format_zid(&zid, expected, sizeof(expected));
+    TEST_ASSERT_EQUAL_STRING(expected, msg.zid);
+    TEST_ASSERT_EQUAL_UINT32(0x01020304, msg.seq);
+    TEST_ASSERT_EQUAL_UINT8(ZENOH_HB_FLAG_ECHO, msg.flags);
+    TEST_ASSERT_EQUAL_UINT8(ZENOH_HB_CPU_UNKNOWN, msg.cpu_load_pct);
+    TEST_ASSERT_TRUE(msg.has_status);
+    TEST_ASSERT_FALSE(msg.legacy);
+}
+
+TEST_CASE("binary heartbeat short or of another version is rejected", "[heartbeat]") {
+    z_id_t zid = { { 0 } };
+    uint8_t buf[ZENOH_HB_BINARY_LEN];
+    encode_binary(buf, 0, 1, &zid);
+    hb_msg_t msg;
+    TEST_ASSERT_FALSE(decode_binary(buf, sizeof(buf) - 1, &msg));
+    buf[2]++;
+    TEST_ASSERT_FALSE(decode_binary(buf, sizeof(buf), &msg));
+}
+
+#endif // HEARTBEAT_ON
@@ -0,0 +1,17 @@
+/*
+ * test_main.c
+ *
+ * Host unit tests of the zenoh/ codecs and tables on the ESP-IDF linux target.
+ * Runs every TEST_CASE of the test_*.c / test_*.cpp files once and exits with
+ * the number of failures, see "Host Unit Tests" in readme.md.
+ */
+
+#include <stdlib.h>
+#include "unity.h"
+#include "unity_test_runner.h"
+
+void app_main(void) {
+    UNITY_BEGIN();
+    unity_run_all_tests();
+    exit(UNITY_END());
+}
@@ -0,0 +1,123 @@
+/*
+ * test_query_route.cpp
+ *
+ * Queryable dispatch table: registration and longest-prefix routing.
+ * zenoh_manager.cpp is included to reach query_route(), so the test build does
+ * not compile it on its own. Keys stay under KEYEXPR_QUERYABLE, which needs no
+ * queryable of its own, and every test unregisters what it registered.
+ */
+
+#include "zenoh_manager.cpp"
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+
+static int provider_a(void *ctx, zenoh_query_ctx_t *query) { (void)ctx; (void)query; return 0; }
+static int provider_b(void *ctx, zenoh_query_ctx_t *query) { (void)ctx; (void)query; return 0; }
+static int ctx_a, ctx_b;
+
+static bool route(const char *key, zenoh_query_stream_provider_t *provider, void **ctx) {
+    *provider = NULL;
+    *ctx = NULL;
+    return query_route(key, strlen(key), provider, ctx);
+}
+
+TEST_CASE("query route picks the longest registered prefix", "[query_route]") {
+    TEST_ASSERT_EQUAL(0, zenoh_register_queryable(KEYEXPR_QUERYABLE, provider_a, &ctx_a));
+    TEST_ASSERT_EQUAL(0, zenoh_register_queryable(KEYEXPR_QUERYABLE "/img", provider_b, &ctx_b));
+    zenoh_query_stream_provider_t provider;
+    void *ctx;
+
+    TEST_ASSERT_TRUE(route(KEYEXPR_QUERYABLE "/img/7", &provider, &ctx));
+    TEST_ASSERT_TRUE(provider == provider_b);
+    TEST_ASSERT_EQUAL_PTR(&ctx_b, ctx);
+    TEST_ASSERT_TRUE(route(KEYEXPR_QUERYABLE "/meta", &provider, &ctx));
+    TEST_ASSERT_TRUE(provider == provider_a);
+    TEST_ASSERT_EQUAL_PTR(&ctx_a, ctx);
+    TEST_ASSERT_TRUE(route(KEYEXPR_QUERYABLE, &provider, &ctx));
+    TEST_ASSERT_TRUE(provider == provider_a);
+
+    zenoh_unregister_queryable(KEYEXPR_QUERYABLE "/img");
+    TEST_ASSERT_TRUE(route(KEYEXPR_QUERYABLE "/img/7", &provider, &ctx));
+    TEST_ASSERT_TRUE(provider == provider_a);
+    zenoh_unregister_queryable(KEYEXPR_QUERYABLE);
+    TEST_ASSERT_FALSE(route(KEYEXPR_QUERYABLE "/img/7", &provider, &ctx));
+}
+
+TEST_CASE("query route matches whole segments only", "[query_route]") {
+    TEST_ASSERT_EQUAL(0, zenoh_register_queryable(KEYEXPR_QUERYABLE "/img", provider_a, &ctx_a));
+    zenoh_query_stream_provider_t provider;
+    void *ctx;
+    TEST_ASSERT_FALSE(route(KEYEXPR_QUERYABLE "/imgs", &provider, &ctx));
+    TEST_ASSERT_FALSE(route(KEYEXPR_QUERYABLE "/im", &provider, &ctx));
+    TEST_ASSERT_FALSE(route(KEYEXPR_QUERYABLE, &provider, &ctx));
+    TEST_ASSERT_FALSE(route("other/img", &provider, &ctx));
+    zenoh_unregister_queryable(KEYEXPR_QUERYABLE "/img");
+}
+
+TEST_CASE("query route stops at wildcard segments", "[query_route]") {
+    TEST_ASSERT_EQUAL(0, zenoh_register_queryable(KEYEXPR_QUERYABLE, provider_a, &ctx_a));
+    zenoh_query_stream_provider_t provider;
+    void *ctx;
+    TEST_ASSERT_TRUE(route(KEYEXPR_QUERYABLE "/**", &provider, &ctx));
+    TEST_ASSERT_TRUE(provider == provider_a);
+    TEST_ASSERT_TRUE(route(KEYEXPR_QUERYABLE "/*/x", &provider, &ctx));
+    TEST_ASSERT_TRUE(provider == provider_a);
+    zenoh_unregister_queryable(KEYEXPR_QUERYABLE);
+    TEST_ASSERT_FALSE(route(KEYEXPR_QUERYABLE "/**", &provider, &ctx));
+}
+
+TEST_CASE("wildcard keys are refused by zenoh_register_queryable", "[query_route]") {
+    TEST_ASSERT_EQUAL(-1, zenoh_register_queryable(KEYEXPR_QUERYABLE "/*", provider_a, &ctx_a));
+    TEST_ASSERT_EQUAL(-1, zenoh_register_queryable(KEYEXPR_QUERYABLE "/**", provider_a, &ctx_a));
+    TEST_ASSERT_EQUAL(-1, zenoh_register_queryable(KEYEXPR_QUERYABLE "/a*b", provider_a, &ctx_a));
+    TEST_ASSERT_EQUAL(-1, zenoh_register_queryable(KEYEXPR_QUERYABLE, NULL, NULL));
+    zenoh_query_stream_provider_t provider;
+    void *ctx;
+    TEST_ASSERT_FALSE(route(KEYEXPR_QUERYABLE "/x", &provider, &ctx));
+    TEST_ASSERT_EQUAL(-1, g_query_nodes[0].child); // nothing was inserted
+}
+
+TEST_CASE("query route refuses a too long segment", "[query_route]") {
+    char key[ZENOH_KEYEXPR_MAX_LEN];
+    int n = snprintf(key, sizeof(key), "%s/", KEYEXPR_QUERYABLE);
+    memset(key + n, 's', ZENOH_QUERYABLE_SEGMENT_MAX_LEN + 1);
+    key[n + ZENOH_QUERYABLE_SEGMENT_MAX_LEN + 1] = '\0';
+    TEST_ASSERT_EQUAL(-1, zenoh_register_queryable(key, provider_a, &ctx_a));
+    zenoh_query_stream_provider_t provider;
+    void *ctx;
+    TEST_ASSERT_FALSE(route(KEYEXPR_QUERYABLE, &provider, &ctx));
+    TEST_ASSERT_EQUAL(-1, g_query_nodes[0].child); // the partial path was released
+}
+
+TEST_CASE("query route reuses released nodes", "[query_route]") {
+    char key[ZENOH_KEYEXPR_MAX_LEN];
+    int registered = 0;
+    // Fill the table with siblings until a registration fails
+    while (registered < ZENOH_QUERYABLE_TRIE_NODES) {
+        snprintf(key, sizeof(key), "%s/k%d", KEYEXPR_QUERYABLE, registered);
+        if (zenoh_register_queryable(key, provider_a, &ctx_a) < 0) { break; }
+        registered++;
+    }
+    TEST_ASSERT_TRUE(registered > 0 && registered < ZENOH_QUERYABLE_TRIE_NODES);
+    zenoh_query_stream_provider_t provider;
+    void *ctx;
+    snprintf(key, sizeof(key), "%s/k%d", KEYEXPR_QUERYABLE, registered - 1);
+    TEST_ASSERT_TRUE(route(key, &provider, &ctx));
+
+    for (int i = 0; i < registered; i++) {
+        snprintf(key, sizeof(key), "%s/k%d", KEYEXPR_QUERYABLE, i);
+        zenoh_unregister_queryable(key);
+        TEST_ASSERT_FALSE(route(key, &provider, &ctx));
+    }
+    TEST_ASSERT_EQUAL(-1, g_query_nodes[0].child);
+    // The released nodes serve new registrations
+    for (int i = 0; i < registered; i++) {
+        snprintf(key, sizeof(key), "%s/n%d", KEYEXPR_QUERYABLE, i);
+        TEST_ASSERT_EQUAL(0, zenoh_register_queryable(key, provider_b, &ctx_b));
+    }
+    for (int i = 0; i < registered; i++) {
+        snprintf(key, sizeof(key), "%s/n%d", KEYEXPR_QUERYABLE, i);
+        zenoh_unregister_queryable(key);
+    }
+}
@@ -0,0 +1,243 @@
+/*
+ * zenoh_async.cpp
+ *
+ * Bounded multi-producer publish queue drained by a dedicated sender task.
+ * The ring is the classic sequence-numbered bounded MPMC queue: producers
+ * and the sender only touch their own index with a CAS, so enqueueing never
+ * takes a lock and never waits on the socket.
+ */
+
+#include "zenoh_async.h"
+
+#if ZENOH_ASYNC_PUBLISH_ON
+
+#include "zenoh_manager.h"
+#include "zenoh_pool.h"
+#define ZENOH_LOG_SUBSYSTEM ASYNC
+#include "zenoh_log.h"
+#include <string.h>
+#include <stdlib.h>
+#include <atomic>
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "Z_ASYNC";
+
+#define RING_MASK (ZENOH_ASYNC_QUEUE_DEPTH - 1)
+#define DROP_OLDEST_MAX_TRIES 4 // evictions per push, the sender or other producers may refill the ring
+static_assert((ZENOH_ASYNC_QUEUE_DEPTH & RING_MASK) == 0, "ZENOH_ASYNC_QUEUE_DEPTH must be a power of two");
+
+typedef struct {
+    std::atomic<uint32_t> seq;
+    char keyexpr[ZENOH_KEYEXPR_MAX_LEN];
+    z_owned_bytes_t payload;
+} ring_slot_t;
+
+static ring_slot_t g_ring[ZENOH_ASYNC_QUEUE_DEPTH];
+static std::atomic<uint32_t> g_enqueue_pos(0);
+static std::atomic<uint32_t> g_dequeue_pos(0);
+
+static std::atomic<uint32_t> g_high_water(0);
+static std::atomic<uint32_t> g_enqueued(0);
+static std::atomic<uint32_t> g_sent(0);
+static std::atomic<uint32_t> g_send_failed(0);
+static std::atomic<uint32_t> g_dropped_oldest(0);
+static std::atomic<uint32_t> g_dropped_newest(0);
+
+static const zenoh_overflow_policy_t g_policy = ZENOH_ASYNC_OVERFLOW_POLICY;
+static TaskHandle_t sender_task_handle = NULL;
+static SemaphoreHandle_t g_space_sem = NULL; // given by the sender whenever a slot frees up
+static SemaphoreHandle_t g_exit_sem = NULL;  // given by the sender when it leaves, see zenoh_async_stop()
+static std::atomic<bool> g_stopping(false);
+
+// Same ownership rule as zenoh_publish_binary: pool blocks go back to the pool.
+static void free_deleter(void *data, void *context) {
+    (void)context;
+#if ZENOH_PAYLOAD_POOL_ON
+    if (zenoh_payload_pool_owns(data)) {
+        zenoh_payload_release(data);
+        return;
+    }
+#endif
+    free(data);
+}
+
+static uint32_t ring_depth() {
+    return g_enqueue_pos.load(std::memory_order_relaxed) - g_dequeue_pos.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Claims a slot and moves the message into it.
+ * keyexpr must fit in ZENOH_KEYEXPR_MAX_LEN, see zenoh_publish_async_bytes().
+ * @return true on success, false if the ring is full (payload untouched).
+ */
+static bool ring_push(const char *keyexpr, z_owned_bytes_t *payload) {
+    uint32_t pos = g_enqueue_pos.load(std::memory_order_relaxed);
+    ring_slot_t *slot;
+    for (;;) {
+        slot = &g_ring[pos & RING_MASK];
+        uint32_t seq = slot->seq.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (g_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = g_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    strcpy(slot->keyexpr, keyexpr);
+    z_bytes_take(&slot->payload, z_move(*payload));
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Moves the oldest message out of the ring.
+ * @return true on success, false if the ring is empty.
+ */
+static bool ring_pop(char *keyexpr, size_t keyexpr_len, z_owned_bytes_t *payload) {
+    uint32_t pos = g_dequeue_pos.load(std::memory_order_relaxed);
+    ring_slot_t *slot;
+    for (;;) {
+        slot = &g_ring[pos & RING_MASK];
+        uint32_t seq = slot->seq.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - (pos + 1));
+        if (diff == 0) {
+            if (g_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = g_dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    if (keyexpr != NULL) {
+        strncpy(keyexpr, slot->keyexpr, keyexpr_len - 1);
+        keyexpr[keyexpr_len - 1] = '\0';
+    }
+    z_bytes_take(payload, z_move(slot->payload));
+    slot->seq.store(pos + RING_MASK + 1, std::memory_order_release);
+    if (g_space_sem != NULL) { xSemaphoreGive(g_space_sem); }
+    return true;
+}
+
+static void update_high_water() {
+    uint32_t depth = ring_depth();
+    uint32_t hw = g_high_water.load(std::memory_order_relaxed);
+    while (depth > hw && !g_high_water.compare_exchange_weak(hw, depth, std::memory_order_relaxed)) {}
+}
+
+// Runs until zenoh_async_stop() sets g_stopping, then gives g_exit_sem and deletes itself
+static void sender_task(void *arg) {
+    EventGroupHandle_t event_group = (EventGroupHandle_t)arg;
+    while (!g_stopping && (xEventGroupWaitBits(event_group, ZENOH_DECLARED_BIT, pdFALSE, pdFALSE,
+                pdMS_TO_TICKS(100)) & ZENOH_DECLARED_BIT) == 0) {}
+    ZLOGD(TAG, "Sender task running on core %d", xPortGetCoreID());
+
+    char keyexpr[ZENOH_KEYEXPR_MAX_LEN];
+    while (!g_stopping) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        z_owned_bytes_t payload;
+        while (!g_stopping && ring_pop(keyexpr, sizeof(keyexpr), &payload)) {
+            if (zenoh_publish_bytes(keyexpr, &payload, NULL) < 0) {
+                g_send_failed.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                g_sent.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    xSemaphoreGive(g_exit_sem);
+    vTaskDelete(NULL);
+}
+
+extern "C" {
+    void zenoh_async_start(EventGroupHandle_t event_group) {
+        if (sender_task_handle != NULL) { return; }
+        for (uint32_t i = 0; i < ZENOH_ASYNC_QUEUE_DEPTH; i++) {
+            g_ring[i].seq.store(i, std::memory_order_relaxed);
+        }
+        g_enqueue_pos.store(0);
+        g_dequeue_pos.store(0);
+        if (g_space_sem == NULL) { g_space_sem = xSemaphoreCreateBinary(); }
+        if (g_exit_sem == NULL) { g_exit_sem = xSemaphoreCreateBinary(); }
+        g_stopping = false;
+        if (xTaskCreatePinnedToCore(sender_task, "zenoh_async_tx", ZENOH_ASYNC_TASK_STACK, event_group,
+                ZENOH_ASYNC_TASK_PRIO, &sender_task_handle, ZENOH_ASYNC_TASK_CORE) != pdPASS) {
+            ZLOGE(TAG, "❗Unable to create async sender task❗");
+            sender_task_handle = NULL;
+            return;
+        }
+        ZLOGI(TAG, "📤 Async publish queue (%d slots) on core %d", ZENOH_ASYNC_QUEUE_DEPTH, ZENOH_ASYNC_TASK_CORE);
+    }
+
+    void zenoh_async_stop() {
+        if (sender_task_handle != NULL) {
+            // The sender may be inside a publish holding the session mutex: let it finish
+            g_stopping = true;
+            xTaskNotifyGive(sender_task_handle);
+            xSemaphoreTake(g_exit_sem, portMAX_DELAY);
+            sender_task_handle = NULL;
+        }
+        z_owned_bytes_t payload;
+        while (ring_pop(NULL, 0, &payload)) { z_drop(z_move(payload)); }
+    }
+
+    int zenoh_publish_async_bytes(const char *keyexpr, z_owned_bytes_t *payload) {
+        if (strlen(keyexpr) >= ZENOH_KEYEXPR_MAX_LEN) {
+            ZLOGE(TAG, "❗Key expression '%s' longer than ZENOH_KEYEXPR_MAX_LEN, not queued❗", keyexpr);
+            z_drop(z_move(*payload));
+            g_dropped_newest.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+        bool queued = ring_push(keyexpr, payload);
+        if (!queued && g_policy == ZENOH_OVERFLOW_DROP_OLDEST) {
+            for (int tries = 0; !queued && tries < DROP_OLDEST_MAX_TRIES; tries++) {
+                z_owned_bytes_t oldest;
+                if (ring_pop(NULL, 0, &oldest)) {
+                    z_drop(z_move(oldest));
+                    g_dropped_oldest.fetch_add(1, std::memory_order_relaxed);
+                }
+                queued = ring_push(keyexpr, payload);
+            }
+        } else if (!queued && g_policy == ZENOH_OVERFLOW_BLOCK) {
+            TickType_t start = xTaskGetTickCount();
+            TickType_t timeout = pdMS_TO_TICKS(ZENOH_ASYNC_BLOCK_TIMEOUT_MS);
+            while (!queued) {
+                TickType_t elapsed = xTaskGetTickCount() - start;
+                if (elapsed >= timeout || xSemaphoreTake(g_space_sem, timeout - elapsed) != pdTRUE) { break; }
+                queued = ring_push(keyexpr, payload);
+            }
+        }
+        if (!queued) {
+            z_drop(z_move(*payload));
+            g_dropped_newest.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+        g_enqueued.fetch_add(1, std::memory_order_relaxed);
+        update_high_water();
+        if (sender_task_handle != NULL) { xTaskNotifyGive(sender_task_handle); }
+        return 0;
+    }
+
+    int zenoh_publish_async(const char *keyexpr, const uint8_t *payload, size_t len) {
+        z_owned_bytes_t z_payload;
+        if (z_bytes_from_buf(&z_payload, (uint8_t *)payload, len, free_deleter, NULL) != Z_OK) {
+            ZLOGE(TAG, "Failed to create zenoh payload from buffer");
+            free_deleter((void *)payload, NULL);
+            return -1;
+        }
+        return zenoh_publish_async_bytes(keyexpr, &z_payload);
+    }
+
+    void zenoh_async_get_stats(zenoh_async_stats_t *out) {
+        out->depth = ring_depth();
+        out->high_water = g_high_water.load(std::memory_order_relaxed);
+        out->enqueued = g_enqueued.load(std::memory_order_relaxed);
+        out->sent = g_sent.load(std::memory_order_relaxed);
+        out->send_failed = g_send_failed.load(std::memory_order_relaxed);
+        out->dropped_oldest = g_dropped_oldest.load(std::memory_order_relaxed);
+        out->dropped_newest = g_dropped_newest.load(std::memory_order_relaxed);
+    }
+} // extern "C"
+
+#endif // ZENOH_ASYNC_PUBLISH_ON
@@ -0,0 +1,79 @@
+#ifndef ZENOH_ASYNC_H
+#define ZENOH_ASYNC_H
+
+#include <zenoh-pico.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// What zenoh_publish_async() does when the queue is full
+typedef enum {
+    ZENOH_OVERFLOW_DROP_OLDEST = 0, // evict the oldest queued message
+    ZENOH_OVERFLOW_DROP_NEWEST,     // reject the new message
+    ZENOH_OVERFLOW_BLOCK            // wait up to ZENOH_ASYNC_BLOCK_TIMEOUT_MS for space
+} zenoh_overflow_policy_t;
+
+#include "zenoh_config.h"
+
+#if ZENOH_ASYNC_PUBLISH_ON
+
+// Counters of the publish queue. All values are totals since start, except depth.
+typedef struct {
+    uint32_t depth;          // messages currently queued
+    uint32_t high_water;     // deepest the queue has been
+    uint32_t enqueued;
+    uint32_t sent;           // handed to zenoh successfully
+    uint32_t send_failed;    // zenoh rejected the put
+    uint32_t dropped_oldest; // evicted by ZENOH_OVERFLOW_DROP_OLDEST
+    uint32_t dropped_newest; // rejected: queue full (any policy) or key too long
+} zenoh_async_stats_t;
+
+/**
+ * @brief Starts the sender task. Called by the manager on init.
+ * @param event_group Application event group; the sender waits for ZENOH_DECLARED_BIT.
+ */
+void zenoh_async_start(EventGroupHandle_t event_group);
+
+/**
+ * @brief Stops the sender task and drops every queued message.
+ * Waits for the sender to finish the message it is publishing.
+ */
+void zenoh_async_stop();
+
+/**
+ * @brief Queues a raw buffer for publication by the sender task.
+ *
+ * Never blocks unless the overflow policy is ZENOH_OVERFLOW_BLOCK. Takes
+ * ownership of a malloc'd payload exactly like zenoh_publish_binary().
+ *
+ * @param keyexpr Key expression to publish on (copied). Keys of ZENOH_KEYEXPR_MAX_LEN
+ * characters or more are rejected.
+ * @param payload malloc'd buffer or pool block, released once sent or dropped.
+ * @param len Payload length in bytes.
+ * @return 0 if queued, -1 if the message was dropped.
+ */
+int zenoh_publish_async(const char *keyexpr, const uint8_t *payload, size_t len);
+
+/**
+ * @brief Queues an already built zenoh payload. The payload is always consumed.
+ * @return 0 if queued, -1 if the message was dropped.
+ */
+int zenoh_publish_async_bytes(const char *keyexpr, z_owned_bytes_t *payload);
+
+/**
+ * @brief Copies the queue counters into *out.
+ */
+void zenoh_async_get_stats(zenoh_async_stats_t *out);
+
+#endif // ZENOH_ASYNC_PUBLISH_ON
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_ASYNC_H
@@ -0,0 +1,84 @@
+/*
+ * zenoh_attachment.c
+ *
+ * TLV attachments added to publications by the manager (liveness, tracing).
+ */
+
+#include "zenoh_attachment.h"
+
+#include <string.h>
+
+static uint8_t g_liveness[ZENOH_ATTACH_HEADER_LEN + 2 + sizeof(((z_id_t *)0)->id)];
+static bool g_ready = false;
+
+void zenoh_attachment_init(const z_id_t *zid) {
+    g_liveness[0] = ZENOH_ATTACH_MAGIC0;
+    g_liveness[1] = ZENOH_ATTACH_MAGIC1;
+    g_liveness[2] = ZENOH_ATTACH_VERSION;
+    g_liveness[3] = 1;
+    g_liveness[4] = ZENOH_ATTACH_LIVENESS;
+    g_liveness[5] = (uint8_t)sizeof(zid->id);
+    memcpy(&g_liveness[6], zid->id, sizeof(zid->id));
+    g_ready = true;
+}
+
+bool zenoh_attachment_liveness(z_owned_bytes_t *out) {
+    return g_ready && z_bytes_from_static_buf(out, g_liveness, sizeof(g_liveness)) == Z_OK;
+}
+
+bool zenoh_attachment_self(z_id_t *out) {
+    if (!g_ready) { return false; }
+    memcpy(out->id, &g_liveness[6], sizeof(out->id));
+    return true;
+}
+
+size_t zenoh_attachment_begin(uint8_t *buf, size_t cap) {
+    if (!g_ready || cap < sizeof(g_liveness)) { return 0; }
+    memcpy(buf, g_liveness, sizeof(g_liveness));
+    return sizeof(g_liveness);
+}
+
+bool zenoh_attachment_add(uint8_t *buf, size_t cap, size_t *len, uint8_t type, const void *value, uint8_t value_len) {
+    if (*len < ZENOH_ATTACH_HEADER_LEN || *len + 2 + value_len > cap) { return false; }
+    buf[*len] = type;
+    buf[*len + 1] = value_len;
+    memcpy(buf + *len + 2, value, value_len);
+    *len += 2 + value_len;
+    buf[3]++;
+    return true;
+}
+
+bool zenoh_attachment_find(const z_loaned_bytes_t *attachment, uint8_t type, uint8_t *value, size_t *len) {
+    if (attachment == NULL) { return false; }
+    uint8_t frame[ZENOH_ATTACH_MAX_LEN];
+    const uint8_t *data;
+    size_t total;
+    z_view_slice_t view;
+    if (z_bytes_get_contiguous_view(attachment, &view) == Z_OK) {
+        data = z_slice_data(z_loan(view));
+        total = z_slice_len(z_loan(view));
+    } else {
+        z_bytes_reader_t reader = z_bytes_get_reader(attachment);
+        total = z_bytes_reader_read(&reader, frame, sizeof(frame));
+        data = frame;
+    }
+    if (total < ZENOH_ATTACH_HEADER_LEN || data[0] != ZENOH_ATTACH_MAGIC0 || data[1] != ZENOH_ATTACH_MAGIC1
+        || data[2] != ZENOH_ATTACH_VERSION) {
+        return false;
+    }
+    size_t off = ZENOH_ATTACH_HEADER_LEN;
+    for (uint8_t i = 0; i < data[3] && off + 2 <= total; i++) {
+        uint8_t field_type = data[off];
+        size_t field_len = data[off + 1];
+        off += 2;
+        if (off + field_len > total) { break; }
+        if (field_type == type) {
+            if (field_len > *len) { return false; }
+            memcpy(value, data + off, field_len);
+            *len = field_len;
+            return true;
+        }
+        off += field_len;
+    }
+    return false;
+}
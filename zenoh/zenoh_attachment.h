@@ -0,0 +1,78 @@
+#ifndef ZENOH_ATTACHMENT_H
+#define ZENOH_ATTACHMENT_H
+
+#include <zenoh-pico.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "zenoh_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Attachment wire format, a small TLV list:
+ *   'Z' 'A' <version=1> <field count>  then per field: <u8 type> <u8 len> <bytes>
+ * Unknown field types are skipped by receivers.
+ */
+#define ZENOH_ATTACH_MAGIC0 'Z'
+#define ZENOH_ATTACH_MAGIC1 'A'
+#define ZENOH_ATTACH_VERSION 1
+#define ZENOH_ATTACH_HEADER_LEN 4
+#define ZENOH_ATTACH_MAX_LEN 80
+
+// Field types
+#define ZENOH_ATTACH_LIVENESS 1 // u8 zid[16] of the publisher
+#define ZENOH_ATTACH_TRACE 2    // u32 seq, u64 source_us (publisher's esp_timer), see zenoh_trace.h
+#define ZENOH_ATTACH_ORIGIN 3   // u8 zid[16], u32 seq, u64 source_us of the message a chain started with
+
+/**
+ * @brief Prepares the attachments that carry this node's identity.
+ * Called by the manager once the session is open.
+ */
+void zenoh_attachment_init(const z_id_t *zid);
+
+/**
+ * @brief Builds the liveness attachment piggybacked on data publications.
+ *
+ * The bytes reference a static buffer, so this neither copies nor allocates.
+ * @return false before zenoh_attachment_init().
+ */
+bool zenoh_attachment_liveness(z_owned_bytes_t *out);
+
+/**
+ * @brief ZID given to zenoh_attachment_init().
+ * @return false before zenoh_attachment_init().
+ */
+bool zenoh_attachment_self(z_id_t *out);
+
+/**
+ * @brief Starts an attachment in buf, holding only the liveness field.
+ * @param cap Size of buf, at least ZENOH_ATTACH_MAX_LEN.
+ * @return Length written, 0 before zenoh_attachment_init().
+ */
+size_t zenoh_attachment_begin(uint8_t *buf, size_t cap);
+
+/**
+ * @brief Appends a field to an attachment started with zenoh_attachment_begin().
+ * @param len In: current length. Out: length with the field.
+ * @return false if the field does not fit into cap.
+ */
+bool zenoh_attachment_add(uint8_t *buf, size_t cap, size_t *len, uint8_t type, const void *value, uint8_t value_len);
+
+/**
+ * @brief Looks up a field in a received attachment, without heap allocation.
+ * @param attachment Attachment of a sample (may be NULL).
+ * @param type Field type to look for.
+ * @param value Receives the field bytes.
+ * @param len In: size of value. Out: field length.
+ * @return true if the field was found and fit into value.
+ */
+bool zenoh_attachment_find(const z_loaned_bytes_t *attachment, uint8_t type, uint8_t *value, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_ATTACHMENT_H
@@ -0,0 +1,309 @@
+#include "zenoh_batch.h"
+
+#if ZENOH_BATCHING_ON // The entire file is conditionally compiled
+
+#include "zenoh_manager.h"
+#include "zenoh_utils.h"
+#define ZENOH_LOG_SUBSYSTEM BATCH
+#include "zenoh_log.h"
+#include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+
+static const char *TAG = "Z_BATCH";
+
+#define ZENOH_BATCH_KEY(keyexpr) keyexpr,
+static const char *const g_batch_keys[] = { ZENOH_BATCH_KEYEXPRS NULL };
+#undef ZENOH_BATCH_KEY
+
+typedef struct {
+    bool in_use;
+    char keyexpr[ZENOH_KEYEXPR_MAX_LEN];
+    uint8_t buf[ZENOH_BATCH_MAX_BYTES];
+    size_t used;
+    TimerHandle_t timer;
+} batch_slot_t;
+
+#if ZENOH_BATCH_SLOTS > 32
+#error "ZENOH_BATCH_SLOTS must fit in the 32 notification bits of the flush task"
+#endif
+
+static batch_slot_t g_slots[ZENOH_BATCH_SLOTS];
+static SemaphoreHandle_t g_batch_mutex = NULL;
+static TaskHandle_t flush_task_handle = NULL; // notified with one bit per due slot
+static SemaphoreHandle_t g_exit_sem = NULL;   // given by the flush task when it leaves, see zenoh_batch_stop()
+static volatile bool g_stopping = false;
+
+// A key is batched when it is a listed prefix or a sub-key of one (key_len bytes, no NUL needed)
+static bool key_is_batched(const char *keyexpr, size_t key_len) {
+    for (size_t i = 0; g_batch_keys[i] != NULL; i++) {
+        size_t n = strlen(g_batch_keys[i]);
+        if (key_len >= n && strncmp(keyexpr, g_batch_keys[i], n) == 0 && (key_len == n || keyexpr[n] == '/')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Appends a record of len bytes to the batch in buf, the caller checked it fits
+static void batch_put_record(uint8_t *buf, size_t *used, const uint8_t *data, size_t len) {
+    uint8_t *p = buf + *used;
+    p[0] = (uint8_t)(len & 0xFF);
+    p[1] = (uint8_t)(len >> 8);
+    memcpy(p + ZENOH_BATCH_RECORD_HEADER_LEN, data, len);
+    *used += ZENOH_BATCH_RECORD_HEADER_LEN + len;
+    buf[3]++;
+}
+
+/**
+ * @brief Reads the record at *off of a batch of total bytes.
+ * @return false if the record header or body runs past total (*off unchanged).
+ */
+static bool batch_next_record(const uint8_t *data, size_t total, size_t *off, const uint8_t **record, size_t *len) {
+    if (*off + ZENOH_BATCH_RECORD_HEADER_LEN > total) { return false; }
+    size_t n = (size_t)data[*off] | ((size_t)data[*off + 1] << 8);
+    if (*off + ZENOH_BATCH_RECORD_HEADER_LEN + n > total) { return false; }
+    *record = data + *off + ZENOH_BATCH_RECORD_HEADER_LEN;
+    *len = n;
+    *off += ZENOH_BATCH_RECORD_HEADER_LEN + n;
+    return true;
+}
+
+static void send_payload(const char *keyexpr, z_owned_bytes_t *payload) {
+#if ZENOH_ASYNC_PUBLISH_ON
+    zenoh_publish_async_bytes(keyexpr, payload);
+#else
+    zenoh_publish_bytes(keyexpr, payload, NULL);
+#endif
+}
+
+/**
+ * @brief Moves the pending batch of a slot into *out and resets the slot.
+ *
+ * Must be called with g_batch_mutex held; the put happens after unlocking.
+ * @return true if there was something to send.
+ */
+static bool take_batch_locked(batch_slot_t *slot, char *keyexpr, z_owned_bytes_t *out) {
+    if (!slot->in_use || slot->buf[3] == 0) { return false; }
+    xTimerStop(slot->timer, 0);
+    bool ok = z_bytes_copy_from_buf(out, slot->buf, slot->used) == Z_OK;
+    if (!ok) {
+        ZLOGE(TAG, "Failed to copy batch of %u records on '%s'", slot->buf[3], slot->keyexpr);
+    }
+    strcpy(keyexpr, slot->keyexpr);
+    slot->used = ZENOH_BATCH_HEADER_LEN;
+    slot->buf[3] = 0;
+    return ok;
+}
+
+static void flush_slot(batch_slot_t *slot) {
+    char keyexpr[ZENOH_KEYEXPR_MAX_LEN];
+    z_owned_bytes_t payload;
+    xSemaphoreTake(g_batch_mutex, portMAX_DELAY);
+    bool pending = take_batch_locked(slot, keyexpr, &payload);
+    xSemaphoreGive(g_batch_mutex);
+    if (pending) { send_payload(keyexpr, &payload); }
+}
+
+// Timer daemon: only hands the slot to the flush task, the put may wait for the session mutex
+static void batch_timer_cb(TimerHandle_t timer) {
+    batch_slot_t *slot = (batch_slot_t *)pvTimerGetTimerID(timer);
+    TaskHandle_t task = flush_task_handle;
+    if (task != NULL) { xTaskNotify(task, 1u << (slot - g_slots), eSetBits); }
+}
+
+// Runs until zenoh_batch_stop() sets g_stopping, then gives g_exit_sem and deletes itself
+static void flush_task(void *arg) {
+    (void)arg;
+    while (!g_stopping) {
+        uint32_t due = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &due, portMAX_DELAY);
+        for (size_t i = 0; i < ZENOH_BATCH_SLOTS && !g_stopping; i++) {
+            if (due & (1u << i)) { flush_slot(&g_slots[i]); }
+        }
+    }
+    xSemaphoreGive(g_exit_sem);
+    vTaskDelete(NULL);
+}
+
+void zenoh_batch_init() {
+    if (g_batch_mutex == NULL) {
+        g_batch_mutex = xSemaphoreCreateMutex();
+        g_exit_sem = xSemaphoreCreateBinary();
+        for (size_t i = 0; i < ZENOH_BATCH_SLOTS; i++) {
+            g_slots[i].timer = xTimerCreate("zenoh_batch", pdMS_TO_TICKS(zenoh_settings()->batch_latency_ms),
+                    pdFALSE, &g_slots[i], batch_timer_cb);
+        }
+    }
+    if (flush_task_handle == NULL) {
+        g_stopping = false;
+        if (xTaskCreatePinnedToCore(flush_task, "zenoh_batch", ZENOH_BATCH_TASK_STACK, NULL,
+                ZENOH_BATCH_TASK_PRIO, &flush_task_handle, ZENOH_BATCH_TASK_CORE) != pdPASS) {
+            ZLOGE(TAG, "❗Unable to create the batch flush task❗");
+            flush_task_handle = NULL;
+        }
+    }
+}
+
+bool zenoh_batch_wants(const char *keyexpr, size_t len) {
+    return g_batch_mutex != NULL && zenoh_settings()->batching && len <= ZENOH_BATCH_RECORD_MAX
+        && key_is_batched(keyexpr, strlen(keyexpr));
+}
+
+int zenoh_publish_batched(const char *keyexpr, const uint8_t *data, size_t len) {
+    if (g_batch_mutex == NULL || len > ZENOH_BATCH_MAX_BYTES - ZENOH_BATCH_HEADER_LEN - ZENOH_BATCH_RECORD_HEADER_LEN
+        || strlen(keyexpr) >= ZENOH_KEYEXPR_MAX_LEN) {
+        // Not batchable, send as is (after any pending batch of the same key)
+        zenoh_batch_flush(keyexpr);
+        z_owned_bytes_t payload;
+        if (z_bytes_copy_from_buf(&payload, data, len) != Z_OK) { return -1; }
+        send_payload(keyexpr, &payload);
+        return 0;
+    }
+
+    char flush_key[ZENOH_KEYEXPR_MAX_LEN];
+    z_owned_bytes_t flushed;
+    bool have_flushed = false;
+    batch_slot_t *slot = NULL;
+
+    xSemaphoreTake(g_batch_mutex, portMAX_DELAY);
+    batch_slot_t *free_slot = NULL;
+    for (size_t i = 0; i < ZENOH_BATCH_SLOTS; i++) {
+        if (g_slots[i].in_use && strcmp(g_slots[i].keyexpr, keyexpr) == 0) { slot = &g_slots[i]; break; }
+        if (!g_slots[i].in_use && free_slot == NULL) { free_slot = &g_slots[i]; }
+    }
+    if (slot == NULL && free_slot != NULL) {
+        slot = free_slot;
+        slot->in_use = true;
+        strcpy(slot->keyexpr, keyexpr);
+        slot->buf[0] = ZENOH_BATCH_MAGIC0;
+        slot->buf[1] = ZENOH_BATCH_MAGIC1;
+        slot->buf[2] = ZENOH_BATCH_VERSION;
+        slot->buf[3] = 0;
+        slot->used = ZENOH_BATCH_HEADER_LEN;
+    }
+    if (slot == NULL) {
+        xSemaphoreGive(g_batch_mutex);
+        ZLOGW(TAG, "All %d batch slots busy, sending '%s' unbatched", ZENOH_BATCH_SLOTS, keyexpr);
+        z_owned_bytes_t payload;
+        if (z_bytes_copy_from_buf(&payload, data, len) != Z_OK) { return -1; }
+        send_payload(keyexpr, &payload);
+        return 0;
+    }
+    // Size threshold: flush first if this record would overflow the batch
+    if (slot->used + ZENOH_BATCH_RECORD_HEADER_LEN + len > ZENOH_BATCH_MAX_BYTES || slot->buf[3] == UINT8_MAX) {
+        have_flushed = take_batch_locked(slot, flush_key, &flushed);
+    }
+    batch_put_record(slot->buf, &slot->used, data, len);
+    if (slot->buf[3] == 1) {
+        // Latency bound starts with the first record of the batch
+        xTimerReset(slot->timer, 0);
+    }
+    xSemaphoreGive(g_batch_mutex);
+
+    if (have_flushed) { send_payload(flush_key, &flushed); }
+    return 0;
+}
+
+void zenoh_batch_flush(const char *keyexpr) {
+    if (g_batch_mutex == NULL) { return; }
+    for (size_t i = 0; i < ZENOH_BATCH_SLOTS; i++) {
+        char flush_key[ZENOH_KEYEXPR_MAX_LEN];
+        z_owned_bytes_t payload;
+        xSemaphoreTake(g_batch_mutex, portMAX_DELAY);
+        bool pending = (keyexpr == NULL || (g_slots[i].in_use && strcmp(g_slots[i].keyexpr, keyexpr) == 0))
+            && take_batch_locked(&g_slots[i], flush_key, &payload);
+        xSemaphoreGive(g_batch_mutex);
+        if (pending) { send_payload(flush_key, &payload); }
+    }
+}
+
+void zenoh_batch_stop() {
+    if (g_batch_mutex == NULL) { return; }
+    if (flush_task_handle != NULL) {
+        // The task may be inside a put holding the session mutex: let it finish
+        g_stopping = true;
+        xTaskNotify(flush_task_handle, 0, eNoAction);
+        xSemaphoreTake(g_exit_sem, portMAX_DELAY);
+        flush_task_handle = NULL;
+    }
+    for (size_t i = 0; i < ZENOH_BATCH_SLOTS; i++) {
+        char keyexpr[ZENOH_KEYEXPR_MAX_LEN];
+        z_owned_bytes_t payload;
+        xSemaphoreTake(g_batch_mutex, portMAX_DELAY);
+        bool pending = take_batch_locked(&g_slots[i], keyexpr, &payload);
+        xTimerStop(g_slots[i].timer, 0);
+        g_slots[i].in_use = false;
+        xSemaphoreGive(g_batch_mutex);
+        // Put directly: the session is still open, the async queue is dropped right after this
+        if (pending) { zenoh_publish_bytes(keyexpr, &payload, NULL); }
+    }
+}
+
+void zenoh_batch_dispatch(z_loaned_sample_t *sample, zenoh_batch_handler_t handler, void *arg) {
+    const z_loaned_bytes_t *payload = z_sample_payload(sample);
+    size_t total = z_bytes_len(payload);
+    z_view_string_t key;
+    z_keyexpr_as_view_string(z_sample_keyexpr(sample), &key);
+    if (total < ZENOH_BATCH_HEADER_LEN || !key_is_batched(z_string_data(z_loan(key)), z_string_len(z_loan(key)))) {
+        handler(sample, arg);
+        return;
+    }
+
+    // Batches are small, normally a single slice; reassemble only if fragmented
+    uint8_t *copy = NULL;
+    const uint8_t *data = NULL;
+    z_view_slice_t view;
+    if (z_bytes_get_contiguous_view(payload, &view) == Z_OK) {
+        data = z_slice_data(z_loan(view));
+    } else {
+        uint8_t head[ZENOH_BATCH_HEADER_LEN];
+        z_bytes_reader_t peek = z_bytes_get_reader(payload);
+        z_bytes_reader_read(&peek, head, sizeof(head));
+        if (head[0] != ZENOH_BATCH_MAGIC0 || head[1] != ZENOH_BATCH_MAGIC1 || head[2] != ZENOH_BATCH_VERSION) {
+            handler(sample, arg);
+            return;
+        }
+        copy = (uint8_t *)malloc(total);
+        if (copy == NULL) {
+            ZLOGE(TAG, "No memory to unbatch %u bytes", (unsigned)total);
+            return;
+        }
+        z_bytes_reader_t reader = z_bytes_get_reader(payload);
+        z_bytes_reader_read(&reader, copy, total);
+        data = copy;
+    }
+
+    if (data[0] != ZENOH_BATCH_MAGIC0 || data[1] != ZENOH_BATCH_MAGIC1 || data[2] != ZENOH_BATCH_VERSION) {
+        handler(sample, arg);
+        free(copy);
+        return;
+    }
+
+    uint8_t count = data[3];
+    size_t off = ZENOH_BATCH_HEADER_LEN;
+    const uint8_t *rec;
+    size_t len;
+    for (uint8_t i = 0; i < count && batch_next_record(data, total, &off, &rec, &len); i++) {
+        // Owned copy, a payload retained by the handler outlives the batch buffer
+        z_owned_bytes_t record;
+        if (z_bytes_copy_from_buf(&record, rec, len) != Z_OK) {
+            ZLOGE(TAG, "No memory for a %u byte record", (unsigned)len);
+            free(copy);
+            return;
+        }
+        z_loaned_sample_t inner;
+        zenoh_utils_sample_with_payload(sample, z_loan(record), &inner);
+        handler(&inner, arg);
+        z_drop(z_move(record));
+    }
+    if (off != total) {
+        ZLOGW(TAG, "Malformed batch: %u of %u bytes parsed", (unsigned)off, (unsigned)total);
+    }
+    free(copy);
+}
+
+#endif // ZENOH_BATCHING_ON
@@ -0,0 +1,81 @@
+#ifndef ZENOH_BATCH_H
+#define ZENOH_BATCH_H
+
+#include <zenoh-pico.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "zenoh_config.h"
+
+#if ZENOH_BATCHING_ON
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Batch wire format (little endian):
+ *   'Z' 'B' <version=1> <record count>  then per record: <u16 length> <bytes>
+ */
+#define ZENOH_BATCH_MAGIC0 'Z'
+#define ZENOH_BATCH_MAGIC1 'B'
+#define ZENOH_BATCH_VERSION 1
+#define ZENOH_BATCH_HEADER_LEN 4
+#define ZENOH_BATCH_RECORD_HEADER_LEN 2
+
+// Same signature as z_data_handler_t in zenoh_manager.h
+typedef void (*zenoh_batch_handler_t)(z_loaned_sample_t *sample, void *arg);
+
+/**
+ * @brief Creates the batch slots, their latency timers and the flush task.
+ * Called by the manager, also after zenoh_batch_stop().
+ */
+void zenoh_batch_init();
+
+/**
+ * @brief Tells whether a publication should go through the batcher.
+ * @return true if batching is enabled in the runtime settings, keyexpr is in
+ * ZENOH_BATCH_KEYEXPRS and len <= ZENOH_BATCH_RECORD_MAX.
+ */
+bool zenoh_batch_wants(const char *keyexpr, size_t len);
+
+/**
+ * @brief Appends a record to the batch of keyexpr (data is copied).
+ *
+ * Flushes the pending batch first if the record would not fit. Records that
+ * are too big for a batch are published on their own.
+ *
+ * @return 0 on success, -1 if the record was dropped.
+ */
+int zenoh_publish_batched(const char *keyexpr, const uint8_t *data, size_t len);
+
+/**
+ * @brief Publishes the pending batch of keyexpr now, or of every key if NULL.
+ */
+void zenoh_batch_flush(const char *keyexpr);
+
+/**
+ * @brief Stops the flush task and timers, then publishes every pending batch.
+ *
+ * Called while the session is still open; the caller must not hold the
+ * session mutex.
+ */
+void zenoh_batch_stop();
+
+/**
+ * @brief Delivers a received sample, unbatching it if needed.
+ *
+ * A batch on a ZENOH_BATCH_KEYEXPRS key calls handler once per inner record
+ * with a view of the sample that carries the record as payload (the view is
+ * valid only during the call, the record payload is owned and can be
+ * retained with zenoh_sample_retain_payload()). Any other sample is passed to handler unchanged, even if
+ * its payload looks like a batch.
+ */
+void zenoh_batch_dispatch(z_loaned_sample_t *sample, zenoh_batch_handler_t handler, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_BATCHING_ON
+#endif // ZENOH_BATCH_H
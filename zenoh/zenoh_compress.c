@@ -0,0 +1,244 @@
+#include "zenoh_compress.h"
+
+#if ZENOH_COMPRESSION_ON // The entire file is conditionally compiled
+
+#include "zenoh_manager.h"
+#include "zenoh_platform.h"
+#include "zenoh_utils.h"
+#define ZENOH_LOG_SUBSYSTEM COMPRESS
+#include "zenoh_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "Z_COMPRESS";
+
+#define ZENOH_COMPRESS_KEY(keyexpr) keyexpr,
+static const char *const g_compress_keys[] = { ZENOH_COMPRESS_KEYEXPRS NULL };
+#undef ZENOH_COMPRESS_KEY
+
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5   // the block always ends with literals
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_SIZE (1u << ZENOH_COMPRESS_HASH_BITS)
+
+static uint32_t read_u32(const uint8_t *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+static void write_u32(uint8_t *p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24); }
+
+static uint32_t lz_hash(uint32_t seq) { return (seq * 2654435761u) >> (32 - ZENOH_COMPRESS_HASH_BITS); }
+
+// A key is compressed when it is a listed prefix or a sub-key of one
+bool zenoh_compress_key_listed(const char *keyexpr, size_t key_len) {
+    for (size_t i = 0; g_compress_keys[i] != NULL; i++) {
+        size_t n = strlen(g_compress_keys[i]);
+        if (key_len >= n && strncmp(keyexpr, g_compress_keys[i], n) == 0 && (key_len == n || keyexpr[n] == '/')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// JPEG (FF D8 FF) and PNG (89 'P' 'N' 'G') are compressed already
+static bool already_compressed(const uint8_t *src, size_t len) {
+    if (len >= 3 && src[0] == 0xFF && src[1] == 0xD8 && src[2] == 0xFF) { return true; }
+    if (len >= 4 && src[0] == 0x89 && src[1] == 'P' && src[2] == 'N' && src[3] == 'G') { return true; }
+    return false;
+}
+
+// Payload pool block if one fits, PSRAM otherwise
+static uint8_t *buffer_alloc(size_t len) {
+#if ZENOH_PAYLOAD_POOL_ON
+    uint8_t *block = zenoh_payload_acquire(len);
+    if (block != NULL) { return block; }
+#endif
+    return (uint8_t *)zenoh_platform_malloc(len, true);
+}
+
+void zenoh_compress_free(void *buf, void *ctx) {
+    (void)ctx;
+#if ZENOH_PAYLOAD_POOL_ON
+    if (zenoh_payload_pool_owns(buf)) {
+        zenoh_payload_release(buf);
+        return;
+    }
+#endif
+    free(buf);
+}
+
+// Writes a length continuation (the nibble was 15); false if out of room
+static bool put_length(uint8_t **op, const uint8_t *end, size_t rest) {
+    while (rest >= 255) {
+        if (*op >= end) { return false; }
+        *(*op)++ = 255;
+        rest -= 255;
+    }
+    if (*op >= end) { return false; }
+    *(*op)++ = (uint8_t)rest;
+    return true;
+}
+
+static bool put_sequence(uint8_t **op, const uint8_t *end, const uint8_t *lit, size_t lit_len,
+        size_t offset, size_t match_len) {
+    if (*op >= end) { return false; }
+    uint8_t *token = (*op)++;
+    *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15 && !put_length(op, end, lit_len - 15)) { return false; }
+    if ((size_t)(end - *op) < lit_len) { return false; }
+    memcpy(*op, lit, lit_len);
+    *op += lit_len;
+    if (match_len == 0) { return true; } // last sequence
+    if (end - *op < 2) { return false; }
+    *(*op)++ = (uint8_t)offset;
+    *(*op)++ = (uint8_t)(offset >> 8);
+    size_t m = match_len - LZ_MIN_MATCH;
+    *token |= (uint8_t)(m >= 15 ? 15 : m);
+    return m < 15 || put_length(op, end, m - 15);
+}
+
+/**
+ * @brief Greedy LZ with a single-entry hash table of 4-byte sequences.
+ * @return Block length, or 0 if it does not fit in cap bytes.
+ */
+static size_t lz_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t cap, uint32_t *table) {
+    uint8_t *op = dst;
+    const uint8_t *end = dst + cap;
+    size_t anchor = 0;
+    size_t i = 0;
+    memset(table, 0, LZ_HASH_SIZE * sizeof(table[0]));
+    while (len >= LZ_MIN_MATCH + LZ_LAST_LITERALS && i <= len - LZ_MIN_MATCH - LZ_LAST_LITERALS) {
+        uint32_t seq = read_u32(src + i);
+        uint32_t h = lz_hash(seq);
+        size_t ref = table[h];
+        table[h] = (uint32_t)i;
+        if (ref >= i || i - ref > LZ_MAX_OFFSET || read_u32(src + ref) != seq) {
+            i++;
+            continue;
+        }
+        size_t m = LZ_MIN_MATCH;
+        while (i + m < len - LZ_LAST_LITERALS && src[ref + m] == src[i + m]) { m++; }
+        if (!put_sequence(&op, end, src + anchor, i - anchor, i - ref, m)) { return 0; }
+        i += m;
+        anchor = i;
+    }
+    if (!put_sequence(&op, end, src + anchor, len - anchor, 0, 0)) { return 0; }
+    return (size_t)(op - dst);
+}
+
+// Reads a length continuation; false on a truncated block
+static bool get_length(const uint8_t **ip, const uint8_t *end, size_t *len) {
+    uint8_t b;
+    do {
+        if (*ip >= end) { return false; }
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+/**
+ * @brief Decodes a block into exactly out_len bytes; every read and write is bounds checked.
+ */
+static bool lz_decompress(const uint8_t *src, size_t len, uint8_t *dst, size_t out_len) {
+    const uint8_t *ip = src;
+    const uint8_t *end = src + len;
+    size_t op = 0;
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t lit = token >> 4;
+        if (lit == 15 && !get_length(&ip, end, &lit)) { return false; }
+        if ((size_t)(end - ip) < lit || out_len - op < lit) { return false; }
+        memcpy(dst + op, ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == end) { break; } // last sequence
+        if (end - ip < 2) { return false; }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t m = token & 0x0F;
+        if (m == 15 && !get_length(&ip, end, &m)) { return false; }
+        m += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || out_len - op < m) { return false; }
+        // Byte by byte: a match may overlap its own output
+        for (size_t k = 0; k < m; k++, op++) { dst[op] = dst[op - offset]; }
+    }
+    return op == out_len;
+}
+
+bool zenoh_compress_wants(const char *keyexpr, size_t key_len, size_t len) {
+    return len >= ZENOH_COMPRESS_MIN_BYTES && len <= ZENOH_COMPRESS_MAX_BYTES
+        && zenoh_compress_key_listed(keyexpr, key_len);
+}
+
+size_t zenoh_compress(const uint8_t *src, size_t len, uint8_t **out) {
+    if (len > ZENOH_COMPRESS_MAX_BYTES || already_compressed(src, len)) { return 0; }
+    size_t cap = len - len * ZENOH_COMPRESS_MIN_SAVING_PCT / 100; // header included
+    if (cap <= ZENOH_COMPRESS_HEADER_LEN) { return 0; }
+    uint32_t *table = (uint32_t *)malloc(LZ_HASH_SIZE * sizeof(uint32_t));
+    uint8_t *buf = buffer_alloc(cap);
+    if (table == NULL || buf == NULL) {
+        ZLOGW(TAG, "No memory to compress %u bytes, sent as is", (unsigned)len);
+        free(table);
+        if (buf) { zenoh_compress_free(buf, NULL); }
+        return 0;
+    }
+    size_t block = lz_compress(src, len, buf + ZENOH_COMPRESS_HEADER_LEN, cap - ZENOH_COMPRESS_HEADER_LEN, table);
+    free(table);
+    if (block == 0) {
+        zenoh_compress_free(buf, NULL);
+        return 0;
+    }
+    buf[0] = ZENOH_COMPRESS_MAGIC0;
+    buf[1] = ZENOH_COMPRESS_MAGIC1;
+    buf[2] = ZENOH_COMPRESS_MAGIC2;
+    buf[3] = ZENOH_COMPRESS_METHOD_LZ;
+    write_u32(buf + 4, (uint32_t)len);
+    *out = buf;
+    ZLOGD_HOT(TAG, "Compressed %u -> %u bytes", (unsigned)len, (unsigned)(block + ZENOH_COMPRESS_HEADER_LEN));
+    return block + ZENOH_COMPRESS_HEADER_LEN;
+}
+
+bool zenoh_decompress(const z_loaned_bytes_t *in, z_owned_bytes_t *out) {
+    uint8_t head[ZENOH_COMPRESS_HEADER_LEN];
+    if (zenoh_bytes_read_at(in, 0, head, sizeof(head)) != sizeof(head)
+        || head[0] != ZENOH_COMPRESS_MAGIC0 || head[1] != ZENOH_COMPRESS_MAGIC1
+        || head[2] != ZENOH_COMPRESS_MAGIC2 || head[3] != ZENOH_COMPRESS_METHOD_LZ) {
+        return false;
+    }
+    uint32_t plain_len = read_u32(head + 4);
+    if (plain_len == 0 || plain_len > ZENOH_COMPRESS_MAX_BYTES) { return false; }
+
+    // The block in place when contiguous, else a copy
+    size_t total = z_bytes_len(in);
+    zenoh_bytes_view_t view;
+    uint8_t *copy = NULL;
+    if (!zenoh_bytes_view(in, &view)) {
+        copy = (uint8_t *)malloc(total);
+        if (copy == NULL) { return false; }
+        view.data = copy;
+        view.len = zenoh_bytes_read_at(in, 0, copy, total);
+    }
+    uint8_t *plain = buffer_alloc(plain_len);
+    bool ok = plain != NULL && lz_decompress(view.data + ZENOH_COMPRESS_HEADER_LEN,
+            view.len - ZENOH_COMPRESS_HEADER_LEN, plain, plain_len);
+    free(copy);
+    if (!ok || z_bytes_from_buf(out, plain, plain_len, zenoh_compress_free, NULL) != Z_OK) {
+        if (plain) { zenoh_compress_free(plain, NULL); }
+        ZLOGW(TAG, "Payload with a compression header did not decode, delivered as is");
+        return false;
+    }
+    return true;
+}
+
+bool zenoh_compress_dispatch(z_loaned_sample_t *sample, zenoh_compress_handler_t handler, void *arg) {
+    z_view_string_t key;
+    z_keyexpr_as_view_string(z_sample_keyexpr(sample), &key);
+    if (!zenoh_compress_key_listed(z_string_data(z_loan(key)), z_string_len(z_loan(key)))) { return false; }
+    z_owned_bytes_t plain;
+    if (!zenoh_decompress(z_sample_payload(sample), &plain)) { return false; }
+    z_loaned_sample_t inner;
+    zenoh_utils_sample_with_payload(sample, z_loan(plain), &inner);
+    handler(&inner, arg);
+    z_drop(z_move(plain)); // a payload the handler retained stays alive
+    return true;
+}
+
+#endif // ZENOH_COMPRESSION_ON
@@ -0,0 +1,89 @@
+#ifndef ZENOH_COMPRESS_H
+#define ZENOH_COMPRESS_H
+
+#include <zenoh-pico.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "zenoh_config.h"
+
+#if ZENOH_COMPRESSION_ON
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compressed payload (little endian):
+ *   0x89 'Z' 'C' <method=1: LZ>   u32 original length   then the LZ block
+ * LZ block: sequences of <token> [literal length bytes] <literals> <u16 offset>
+ * [match length bytes], LZ4 style: token high nibble = literal count, low nibble
+ * = match length - 4, a nibble of 15 continues in 255-valued bytes. The last
+ * sequence has literals only. Payloads without the header are plain data.
+ */
+#define ZENOH_COMPRESS_MAGIC0 0x89
+#define ZENOH_COMPRESS_MAGIC1 'Z'
+#define ZENOH_COMPRESS_MAGIC2 'C'
+#define ZENOH_COMPRESS_METHOD_LZ 1
+#define ZENOH_COMPRESS_HEADER_LEN 8
+
+// Same signature as z_data_handler_t in zenoh_manager.h
+typedef void (*zenoh_compress_handler_t)(z_loaned_sample_t *sample, void *arg);
+
+/**
+ * @brief Tells whether keyexpr is in ZENOH_COMPRESS_KEYEXPRS (a listed prefix or a sub-key of one).
+ * @param keyexpr Key expression, key_len bytes (need not be NUL terminated).
+ */
+bool zenoh_compress_key_listed(const char *keyexpr, size_t key_len);
+
+/**
+ * @brief Tells whether a payload on keyexpr should be compressed.
+ * @param keyexpr Key expression, key_len bytes (need not be NUL terminated).
+ * @return true if keyexpr is in ZENOH_COMPRESS_KEYEXPRS and len is within
+ * ZENOH_COMPRESS_MIN_BYTES..ZENOH_COMPRESS_MAX_BYTES.
+ */
+bool zenoh_compress_wants(const char *keyexpr, size_t key_len, size_t len);
+
+/**
+ * @brief Compresses src into a new buffer (header included).
+ *
+ * JPEG and PNG data pass through, and so does anything that does not shrink by
+ * ZENOH_COMPRESS_MIN_SAVING_PCT.
+ *
+ * @param out Set to the buffer on success; release it with zenoh_compress_free()
+ * (malloc'd or a payload pool block, so payload_deleter accepts it too).
+ * @return Compressed length, or 0 if src should be sent as is.
+ */
+size_t zenoh_compress(const uint8_t *src, size_t len, uint8_t **out);
+
+/**
+ * @brief Frees a buffer of zenoh_compress() or a decompressed payload.
+ * Deleter signature of z_bytes_from_buf.
+ */
+void zenoh_compress_free(void *buf, void *ctx);
+
+/**
+ * @brief Decompresses a payload into a pooled buffer.
+ * @return true if in was compressed and *out now holds the original data
+ * (drop it when done); false if in is plain data (or not a valid block).
+ */
+bool zenoh_decompress(const z_loaned_bytes_t *in, z_owned_bytes_t *out);
+
+/**
+ * @brief Delivers a received sample decompressed, if it is compressed.
+ *
+ * Only samples on ZENOH_COMPRESS_KEYEXPRS are looked at, so plain data that
+ * happens to start with the header is delivered untouched. The handler gets a
+ * copy of the sample carrying the original payload.
+ *
+ * @return false if the sample is not compressed; the caller delivers it itself.
+ */
+bool zenoh_compress_dispatch(z_loaned_sample_t *sample, zenoh_compress_handler_t handler, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_COMPRESSION_ON
+
+#endif // ZENOH_COMPRESS_H
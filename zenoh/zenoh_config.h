@@ -10,8 +10,11 @@
  * I_AM_CONSUMER_OR_SERVER: set per-device role
  *   1 == consumer (will connect to a server when using TCP)
  *   0 == server   (will listen on its own IP/iface when using TCP)
+ * Can be set from the build (-DI_AM_CONSUMER_OR_SERVER=0), as bench/ does with BENCH_ROLE.
  */
+#ifndef I_AM_CONSUMER_OR_SERVER
 #define I_AM_CONSUMER_OR_SERVER 1
+#endif
 
 // Transport: 1 = UDP (multicast peer mode), 0 = TCP (unicast)
 #define ZENOH_USE_UDP 1
@@ -24,31 +27,272 @@
 #define ZENOH_MODE "peer"
 
 /* Protocol selection derived from ZENOH_USE_UDP */
+// multicast address used by UDP peer mode
+#define ZENOH_UDP_MULTICAST_IP "224.0.0.251"
 #if ZENOH_USE_UDP == 1
 #define ZENOH_PROTOCOL "udp"
-// multicast address used by UDP peer mode
-#define ZENOH_LISTEN_BROADCAST_IP "224.0.0.251"
+#define ZENOH_LISTEN_BROADCAST_IP ZENOH_UDP_MULTICAST_IP
 #else
 #define ZENOH_PROTOCOL "tcp"
 // leave empty when not using multicast
 #define ZENOH_LISTEN_BROADCAST_IP ""
 #endif
 
+/*
+ * Hybrid transport (ZENOH_HYBRID_ON, TCP only): next to the TCP session the
+ * manager opens a UDP multicast peer session on ZENOH_UDP_MULTICAST_IP and
+ * routes the ZENOH_HYBRID_UDP_KEYEXPRS (and their sub-keys) to it: puts go out
+ * on multicast, subscribers are declared on both sessions, and the heartbeat
+ * runs on multicast. Queries, transfers and every other key stay on TCP.
+ * While the multicast session is down those keys fall back to TCP, and it is
+ * reopened every ZENOH_HYBRID_RETRY_MS. Needs Z_FEATURE_MULTICAST_TRANSPORT
+ * and room for a second session (read and lease tasks, batch buffers).
+ */
+#define ZENOH_HYBRID_ON 0
+#define ZENOH_HYBRID_UDP_KEYEXPRS ZENOH_HYBRID_KEY(KEYEXPR_ANNOUNCE) ZENOH_HYBRID_KEY(HEARTBEAT_CHANNEL)
+#define ZENOH_HYBRID_PORT ZENOH_PORT
+#define ZENOH_HYBRID_RETRY_MS 10000
+
+/*
+ * Runtime settings (zenoh_settings.h): mode, transport, listen/connect
+ * addresses, heartbeat interval and batching can be overridden from NVS.
+ * The values in this file are the defaults.
+ */
+#define ZENOH_SETTINGS_NVS_ON 1
+#define ZENOH_SETTINGS_NVS_NAMESPACE "zenoh"
+
 // SERVER IP (the consumer will connect to this address when acting as consumer in TCP)
 #define ZENOH_SERVER_IP "192.168.137.37"
 
 #define ZENOH_PORT "7447"
 
+/*
+ * Connect endpoints (TCP consumer): probed concurrently at start and after a
+ * lost session; the lowest TCP handshake time is tried first, the others are
+ * the failover order. tcp/ and udp/ locators, IPv4 addresses for probing.
+ *   ZENOH_ENDPOINT("tcp/192.168.137.38:7447")
+ */
+#define ZENOH_CONNECT_ENDPOINTS \
+    ZENOH_ENDPOINT("tcp/" ZENOH_SERVER_IP ":" ZENOH_PORT)
+#define ZENOH_ENDPOINT_PROBE_TIMEOUT_MS 300
+
+/*
+ * Scouting (SCOUT_ON): a background task scouts ZENOH_SCOUT_MULTICAST_LOCATOR
+ * every ZENOH_SCOUT_PERIOD_MS and keeps the answers in a peer table. A TCP
+ * consumer tries the best scouted locator (routers first) before the
+ * ZENOH_CONNECT_ENDPOINTS list. zenoh-pico nodes do not answer scouts, so
+ * this discovers routers and zenohd peers.
+ */
+#define ZENOH_SCOUT_MULTICAST_LOCATOR "udp/224.0.0.224:7446"
+#define ZENOH_SCOUT_TIMEOUT_MS 1000
+#define ZENOH_SCOUT_PERIOD_MS 30000
+#define ZENOH_SCOUT_MAX_PEERS 8
+#define ZENOH_SCOUT_PEER_TTL_MS 120000
+#define ZENOH_SCOUT_LOCATOR_MAX_LEN 64
+
 // Feature Flags
 #define PUBLISHER_ON 1
 #define SUBSCRIBER_ON 1 
-#define SCOUT_ON 0 // it does not seem to work for UDP as supposed to!
+#define SCOUT_ON 0 // background discovery, see ZENOH_SCOUT_* above
 #if I_AM_CONSUMER_OR_SERVER == 1
 #define QUERYABLE_ON 1
 #else
 #define QUERYABLE_ON 0
 #endif
 
+/*
+ * Logging, see zenoh_log.h. Levels are ZENOH_LOG_NONE..ZENOH_LOG_VERBOSE and
+ * strip everything above them at compile time. HOT covers per message logs
+ * (every put, heartbeat, GET and payload free). Deferred events go to a ring
+ * printed by a low priority task instead of formatting on the data path.
+ */
+#define ZENOH_LOG_LEVEL_MANAGER 3   // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_HEARTBEAT 3 // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_SCOUT 3     // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_SELFTEST 3  // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_ASYNC 3     // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_BATCH 3     // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_COMPRESS 3  // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_DISPATCH 3  // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_ENDPOINTS 3 // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_POOL 3      // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_SETTINGS 3  // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_TRACE 3     // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_TRANSFER 3  // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_UTILS 3     // ZENOH_LOG_INFO
+#define ZENOH_LOG_LEVEL_HOT 2       // ZENOH_LOG_WARN: per message logs compiled out
+#define ZENOH_LOG_DEFERRED_ON 1
+#define ZENOH_LOG_RING_SIZE 64
+#define ZENOH_LOG_DRAIN_PERIOD_MS 500
+#define ZENOH_LOG_TASK_CORE tskNO_AFFINITY
+#define ZENOH_LOG_TASK_STACK 3072
+#define ZENOH_LOG_TASK_PRIO 1
+
+/*
+ * Connection supervisor: z_open is retried with jittered exponential backoff,
+ * then a timer polls the session every ZENOH_SUPERVISOR_PERIOD_MS. When zenoh
+ * reports it closed (lease expired) or ZENOH_SUPERVISOR_PUT_FAILURES puts in a
+ * row fail, all resources are torn down, the session reopened and redeclared.
+ * The supervisor task only exists while it connects or has periodic work
+ * (stats, hybrid retries); its stack is freed in between.
+ */
+#define ZENOH_RECONNECT_BACKOFF_MIN_MS 50
+#define ZENOH_RECONNECT_BACKOFF_MAX_MS 5000
+#define ZENOH_SUPERVISOR_PERIOD_MS 100
+#define ZENOH_SUPERVISOR_PUT_FAILURES 5
+
+/*
+ * Task placement: core (0, 1 or tskNO_AFFINITY), stack bytes and priority of
+ * the network tasks. Core 0 keeps them next to the WiFi and lwIP tasks and
+ * off the camera/inference core. zenoh-pico's read and lease tasks (one pair
+ * per session) take a stack and priority only: its ESP-IDF port creates them
+ * unpinned. The other modules have a *_TASK_CORE next to their stack setting.
+ */
+#define ZENOH_CLIENT_TASK_CORE 0
+#define ZENOH_CLIENT_TASK_STACK 8192
+#define ZENOH_CLIENT_TASK_PRIO 5
+#define ZENOH_HB_TASK_CORE 0
+#define ZENOH_HB_TASK_STACK 4096
+#define ZENOH_HB_TASK_PRIO 5
+#define ZENOH_SCOUT_TASK_CORE 0
+#define ZENOH_SCOUT_TASK_STACK 4096
+#define ZENOH_SCOUT_TASK_PRIO 4
+#define ZENOH_READ_TASK_STACK 5120
+#define ZENOH_READ_TASK_PRIO (configMAX_PRIORITIES / 2)
+#define ZENOH_LEASE_TASK_STACK 5120
+#define ZENOH_LEASE_TASK_PRIO (configMAX_PRIORITIES / 2)
+
+/*
+ * Publisher registry: publish calls reuse a publisher declared lazily per key
+ * expression (z_publisher_put) instead of resolving the key on every z_put.
+ * Keys beyond the registry size fall back to z_put.
+ */
+#define ZENOH_PUBLISHER_REGISTRY_SIZE 8
+#define ZENOH_KEYEXPR_MAX_LEN 64
+
+// Upper bound of streaming provider calls per GET (see zenoh_register_query_stream_provider)
+#define ZENOH_QUERY_STREAM_MAX_CALLS 64
+
+/*
+ * Queryable dispatch (zenoh_register_queryable): one tree node per distinct key
+ * segment, and queryables for registered keys outside KEYEXPR_QUERYABLE.
+ */
+#define ZENOH_QUERYABLE_TRIE_NODES 24
+#define ZENOH_QUERYABLE_SEGMENT_MAX_LEN 24 // longer segments cannot be registered
+#define ZENOH_EXTRA_QUERYABLES 4
+
+// Simultaneous zenoh_subscribe() subscriptions, each a zenoh subscriber of its own
+#define ZENOH_MAX_SUBSCRIPTIONS 8
+
+/*
+ * Asynchronous publishing: zenoh_publish_async() pushes into a bounded
+ * lock-free ring and a sender task (pinned to ZENOH_ASYNC_TASK_CORE) does
+ * the actual put, so the capture loop never waits on the socket.
+ * ZENOH_ASYNC_QUEUE_DEPTH must be a power of two.
+ * Overflow: ZENOH_OVERFLOW_DROP_OLDEST, ZENOH_OVERFLOW_DROP_NEWEST or ZENOH_OVERFLOW_BLOCK
+ */
+#define ZENOH_ASYNC_PUBLISH_ON 1
+#define ZENOH_ASYNC_QUEUE_DEPTH 16
+#define ZENOH_ASYNC_OVERFLOW_POLICY ZENOH_OVERFLOW_DROP_OLDEST
+#define ZENOH_ASYNC_BLOCK_TIMEOUT_MS 20
+#define ZENOH_ASYNC_TASK_CORE 1
+#define ZENOH_ASYNC_TASK_STACK 4096
+#define ZENOH_ASYNC_TASK_PRIO 5
+
+/*
+ * Subscriber dispatch: the read task only clones incoming samples into a queue
+ * and ZENOH_DISPATCH_WORKERS tasks pinned to ZENOH_DISPATCH_TASK_CORE run the
+ * data handler. With more than one worker, samples may be handled out of order.
+ * Samples are dropped (and counted) when the queue is full.
+ */
+#define ZENOH_DISPATCH_ON 0 // handlers run in the read task unless enabled
+#define ZENOH_DISPATCH_WORKERS 1
+#define ZENOH_DISPATCH_QUEUE_DEPTH 8
+#define ZENOH_DISPATCH_TASK_CORE 1
+#define ZENOH_DISPATCH_TASK_STACK 6144
+#define ZENOH_DISPATCH_TASK_PRIO 4
+#define ZENOH_DISPATCH_SLOW_HANDLER_US 50000 // handlers slower than this are logged (debug)
+
+/*
+ * Local delivery (ZENOH_LOCAL_DELIVERY_ON): a publication also reaches the
+ * zenoh_subscribe() subscriptions of this board without a network round
+ * trip. zenoh-pico (built with Z_FEATURE_LOCAL_SUBSCRIBER) hands them the
+ * sample inside the put, and the manager queues a copy of its payload and
+ * attachment for the dispatch workers (needs ZENOH_DISPATCH_ON), so the
+ * handler never runs inside the publishing call. The copy (one malloc and
+ * memcpy of payload plus attachment per matching local subscription, none for
+ * remote subscribers) replaces by-reference delivery: publishers pass
+ * z_bytes_from_static_buf() payloads (Codec<T>, stack buffers, the trace and
+ * liveness attachments) that only live until the put returns, so a
+ * z_bytes_clone() queued past the put could dangle. The main subscriber and the
+ * liveness tracking skip the board's own samples.
+ */
+#define ZENOH_LOCAL_DELIVERY_ON 0
+
+/*
+ * Payload pool: fixed-size blocks allocated once at init to replace
+ * per-message malloc/free. The default classes take about 164 KB, from PSRAM
+ * only: on a board without PSRAM the classes are disabled with a warning. Blocks from zenoh_payload_acquire() can be passed
+ * to zenoh_publish_binary(); the deleter hands them back to the pool.
+ *   ZENOH_POOL_CLASS(block size in bytes, number of blocks), smallest first
+ */
+#define ZENOH_PAYLOAD_POOL_ON 1
+#define ZENOH_PAYLOAD_POOL_CLASSES \
+    ZENOH_POOL_CLASS(256,   16) \
+    ZENOH_POOL_CLASS(4096,  8)  \
+    ZENOH_POOL_CLASS(32768, 4)
+
+/*
+ * Metrics of the hot paths (zenoh_get_stats(), see zenoh_stats.h): publish
+ * counts and bytes, put failures and drops, put / handler / query latency
+ * histograms, reconnects and downtime, payload pool usage. With a non-zero
+ * period the supervisor also publishes them as JSON on
+ * ZENOH_STATS_KEYEXPR "/<zid>/stats".
+ */
+#define ZENOH_STATS_ON 1
+#define ZENOH_STATS_HIST_BUCKETS 16 // log2 microsecond buckets, the last one ~32 ms and up
+#define ZENOH_STATS_PUBLISH_PERIOD_MS 0 // 0: read locally only
+#define ZENOH_STATS_KEYEXPR "faces/diagnostics"
+#define ZENOH_STATS_PAYLOAD_MAX 1024
+
+/*
+ * Tracing (opt-in, see zenoh_trace.h): data puts carry a sequence number and
+ * send time in their attachment; receivers track gaps, reordering and one-way
+ * latency per publisher. Cross-node clocks are aligned with the heartbeat echo
+ * (needs HEARTBEAT_ON, ZENOH_HB_ECHO_ON and the binary format).
+ */
+#define ZENOH_TRACE_ON 0
+#define ZENOH_TRACE_MAX_PEERS 4
+#define ZENOH_TRACE_REORDER_WINDOW 64 // a seq further back than this means the publisher restarted
+
+/*
+ * On-device self-test (zenoh_selftest.h), on both boards: once the resources
+ * are declared the consumer runs a ping-pong and a stream test against the
+ * server over the active transport for every size in ZENOH_SELFTEST_SIZES and
+ * logs p50/p99 RTT, msgs/s, kB/s and loss. The sizes straddle one zenoh batch
+ * and the fragmentation limit, to tune Z_BATCH_*_SIZE and Z_FRAG_MAX_SIZE
+ * (zenoh-pico config.h) to the site's Wi-Fi. A size above the peer's
+ * Z_FRAG_MAX_SIZE shows up as 100% loss. Needs SUBSCRIBER_ON.
+ */
+#define ZENOH_SELFTEST_ON 0
+#define ZENOH_SELFTEST_KEYEXPR "selftest"
+#define ZENOH_SELFTEST_SIZES \
+    ZENOH_SELFTEST_SIZE(64) \
+    ZENOH_SELFTEST_SIZE(ZENOH_BATCH_MAX_BYTES / 2) \
+    ZENOH_SELFTEST_SIZE(ZENOH_BATCH_MAX_BYTES) \
+    ZENOH_SELFTEST_SIZE(Z_BATCH_UNICAST_SIZE) \
+    ZENOH_SELFTEST_SIZE(Z_BATCH_MULTICAST_SIZE) \
+    ZENOH_SELFTEST_SIZE(2 * Z_BATCH_UNICAST_SIZE) \
+    ZENOH_SELFTEST_SIZE(Z_FRAG_MAX_SIZE - ZENOH_BATCH_FRAME_OVERHEAD) \
+    ZENOH_SELFTEST_SIZE(Z_FRAG_MAX_SIZE)
+#define ZENOH_SELFTEST_PINGS 200
+#define ZENOH_SELFTEST_STREAM_COUNT 500
+#define ZENOH_SELFTEST_TIMEOUT_MS 1000 // per pong and per stream report
+#define ZENOH_SELFTEST_START_DELAY_MS 3000
+#define ZENOH_SELFTEST_TASK_CORE tskNO_AFFINITY
+#define ZENOH_SELFTEST_TASK_STACK 4096
+#define ZENOH_SELFTEST_TASK_PRIO 4
+
 // Key Expressions for the application protocol
 #define KEYEXPR_ANNOUNCE "faces/announcements"
 #define KEYEXPR_DATA_QUERY "faces/data"
@@ -64,6 +308,88 @@
 #define KEYEXPR_SUB KEYEXPR_ANNOUNCE
 #endif
 
+/*
+ * Face payload layout, used by zenoh_publish_face_payload().
+ * face_payload_header_t lives in the application's shared_payload.h; these
+ * accessors tell the manager how many keypoints and image bytes follow the
+ * header. Override them before including this file if the field names differ.
+ * Wire layout: [header][keypoints (int32 each)][image bytes]
+ */
+#ifndef FACE_PAYLOAD_KEYPOINT_COUNT
+#define FACE_PAYLOAD_KEYPOINT_COUNT(hdr) ((size_t)(hdr)->num_keypoints)
+#endif
+#ifndef FACE_PAYLOAD_IMAGE_LEN
+#define FACE_PAYLOAD_IMAGE_LEN(hdr) ((size_t)(hdr)->image_len)
+#endif
+
+/*
+ * Batching of small publications. Payloads up to ZENOH_BATCH_RECORD_MAX bytes
+ * published on a key listed in ZENOH_BATCH_KEYEXPRS are coalesced into one
+ * length-prefixed batch, flushed when the next record would not fit in
+ * ZENOH_BATCH_MAX_BYTES (derived from Z_BATCH_UNICAST_SIZE) or after
+ * ZENOH_BATCH_MAX_LATENCY_MS. Receivers unbatch transparently, so both sides
+ * need ZENOH_BATCHING_ON. Opt-in: the key list is empty by default, e.g.
+ *   #define ZENOH_BATCH_KEYEXPRS ZENOH_BATCH_KEY(KEYEXPR_RESULTS)
+ */
+#define ZENOH_BATCHING_ON 1
+#ifndef ZENOH_BATCH_KEYEXPRS
+#define ZENOH_BATCH_KEYEXPRS
+#endif
+#define ZENOH_BATCH_SLOTS 4
+#define ZENOH_BATCH_RECORD_MAX 256
+#define ZENOH_BATCH_MAX_LATENCY_MS 20
+// Task the latency timers hand their flush to, a put must not block the timer daemon
+#define ZENOH_BATCH_TASK_CORE 1
+#define ZENOH_BATCH_TASK_STACK 4096
+#define ZENOH_BATCH_TASK_PRIO 5
+// Room left in a zenoh batch for frame/message headers and the key expression
+#define ZENOH_BATCH_FRAME_OVERHEAD 96
+#define ZENOH_BATCH_MAX_BYTES (Z_BATCH_UNICAST_SIZE - ZENOH_BATCH_FRAME_OVERHEAD)
+
+/*
+ * Payload compression, same setting on both sides. Payloads of
+ * ZENOH_COMPRESS_MIN_BYTES..ZENOH_COMPRESS_MAX_BYTES published with
+ * zenoh_publish_binary() or replied to a GET on a key of ZENOH_COMPRESS_KEYEXPRS
+ * (prefix match) are LZ compressed; JPEG / PNG data and payloads that do not
+ * shrink by ZENOH_COMPRESS_MIN_SAVING_PCT go as is. Subscribers and
+ * zenoh_get_data() reply handlers (as their payload argument) get the original
+ * payload back, decompressed into a payload pool block. Only samples on
+ * ZENOH_COMPRESS_KEYEXPRS are decompressed.
+ *   #define ZENOH_COMPRESS_KEYEXPRS ZENOH_COMPRESS_KEY(KEYEXPR_DATA_QUERY)
+ * Can be set from the build (-DZENOH_COMPRESSION_ON=1), as test/ does.
+ */
+#ifndef ZENOH_COMPRESSION_ON
+#define ZENOH_COMPRESSION_ON 0
+#endif
+#define ZENOH_COMPRESS_KEYEXPRS ZENOH_COMPRESS_KEY(KEYEXPR_DATA_QUERY) ZENOH_COMPRESS_KEY(KEYEXPR_RESULTS)
+#define ZENOH_COMPRESS_MIN_BYTES 256
+#define ZENOH_COMPRESS_MAX_BYTES (64 * 1024)
+#define ZENOH_COMPRESS_MIN_SAVING_PCT 10
+#define ZENOH_COMPRESS_HASH_BITS 12 // match table of 4 << bits bytes, allocated per compression
+
+/*
+ * Chunked large-object transfer over the queryable, on ZENOH_TRANSFER_KEYEXPR
+ * (and its sub-keys) only: "meta" / "chunk" GETs on other keys reach the
+ * application's queryables as usual.
+ * The consumer stages an object with zenoh_transfer_stage(); the server pulls
+ * it with zenoh_fetch_object(): one "meta" GET, then GETs for chunk ranges
+ * with up to ZENOH_TRANSFER_WINDOW of them in flight. Missing chunks are
+ * re-requested up to ZENOH_TRANSFER_MAX_RETRIES times, and TRANSFER_COMPLETE_BIT
+ * is set once the object is reassembled. A chunk fits in one zenoh batch so a
+ * loss costs one chunk, not the whole GET.
+ */
+#define ZENOH_TRANSFER_ON 1
+#define ZENOH_TRANSFER_KEYEXPR KEYEXPR_DATA_QUERY
+#define ZENOH_TRANSFER_CHUNK_SIZE (Z_BATCH_UNICAST_SIZE - ZENOH_BATCH_FRAME_OVERHEAD - 32)
+#define ZENOH_TRANSFER_RANGE_CHUNKS 8
+#define ZENOH_TRANSFER_WINDOW 4
+#define ZENOH_TRANSFER_MAX_RETRIES 3
+#define ZENOH_TRANSFER_GET_TIMEOUT_MS 2000
+#define ZENOH_TRANSFER_MAX_OBJECT_BYTES (2 * 1024 * 1024) // larger META announcements are rejected
+#define ZENOH_TRANSFER_TASK_CORE 0
+#define ZENOH_TRANSFER_TASK_STACK 4096
+#define ZENOH_TRANSFER_TASK_PRIO 5
+
 // Periodic Heartbeat. Is heartbeat needed?
 #define HEARTBEAT_ON 1
 #define HEARTBEAT_CHANNEL "heartbeats"
@@ -76,10 +402,60 @@
 #define HEARTBEAT_INTERVAL_MS 73000 //primes and different to avoid collisions
 #endif
 
+/*
+ * Heartbeat peer table: every heartbeat carries "#<counter> @<zid>"; receivers
+ * track last-seen time and counter gaps (loss) per sender. With
+ * ZENOH_HB_ECHO_ON receivers echo each heartbeat back so senders measure RTT.
+ */
+#define ZENOH_HB_MAX_PEERS 8
+#define ZENOH_HB_PEER_TIMEOUT_INTERVALS 3 // heartbeat intervals without news before a peer is not alive
+#define ZENOH_HB_ECHO_ON 0 // every receiver echoes every heartbeat: N^2 traffic, for small fleets
+#define ZENOH_HB_SEND_HISTORY 4 // send times kept to match echoes
+
+/*
+ * Adaptive heartbeat (opt-in): heartbeats are skipped while data is being
+ * published on KEYEXPR_PUB (that traffic carries a liveness attachment when
+ * ZENOH_HB_PIGGYBACK_ON), at most ZENOH_HB_MAX_SUPPRESSED in a row and never
+ * so many that a peer goes ZENOH_HB_PEER_TIMEOUT_INTERVALS without a real
+ * heartbeat: the attachment only reaches subscribers of KEYEXPR_PUB. After a
+ * (re)connect or a detected heartbeat loss, ZENOH_HB_FAST_COUNT heartbeats go
+ * out at ZENOH_HB_FAST_INTERVAL_MS.
+ */
+#define ZENOH_HB_ADAPTIVE_ON 0
+#define ZENOH_HB_PIGGYBACK_ON 0
+#define ZENOH_HB_MAX_SUPPRESSED 1 // below ZENOH_HB_PEER_TIMEOUT_INTERVALS - 1
+#define ZENOH_HB_FAST_INTERVAL_MS 2000
+#define ZENOH_HB_FAST_COUNT 5
+
+// Heartbeat wire format: text (understood by nodes without a peer table), or a
+// fixed 48-byte binary with node status once every node decodes it
+#define ZENOH_HB_FORMAT_TEXT 0
+#define ZENOH_HB_FORMAT_BINARY 1
+#define ZENOH_HB_FORMAT ZENOH_HB_FORMAT_TEXT
+
+/*
+ * Per key-expression QoS profiles, applied when the manager declares a
+ * publisher and when a queryable replies. Matched by prefix (the key is the
+ * prefix itself or a sub-key of it), first match wins, others use the default.
+ *   ZENOH_QOS(prefix, congestion control, priority, express)
+ * Bulky image traffic is droppable and low priority so it never blocks the
+ * caller under Wi-Fi congestion; results and heartbeats go express.
+ */
+#define ZENOH_QOS_PROFILES \
+    ZENOH_QOS(KEYEXPR_ANNOUNCE,   Z_CONGESTION_CONTROL_DROP,  Z_PRIORITY_DATA_LOW,         false) \
+    ZENOH_QOS(KEYEXPR_DATA_QUERY, Z_CONGESTION_CONTROL_DROP,  Z_PRIORITY_DATA_LOW,         false) \
+    ZENOH_QOS(KEYEXPR_RESULTS,    Z_CONGESTION_CONTROL_BLOCK, Z_PRIORITY_INTERACTIVE_HIGH, true)  \
+    ZENOH_QOS(HEARTBEAT_CHANNEL,  Z_CONGESTION_CONTROL_DROP,  Z_PRIORITY_INTERACTIVE_HIGH, true)
+
+#define ZENOH_QOS_DEFAULT_CONGESTION Z_CONGESTION_CONTROL_BLOCK
+#define ZENOH_QOS_DEFAULT_PRIORITY   Z_PRIORITY_DATA
+#define ZENOH_QOS_DEFAULT_EXPRESS    false
+
 // Event Group Bits
 #define ZENOH_CONNECTED_BIT       (1 << 1)
 #define ZENOH_DECLARED_BIT        (1 << 2)
 #define ZENOH_STOP_BIT            (1 << 3)
 #define TRANSFER_COMPLETE_BIT     (1 << 4)
+#define ZENOH_SCOUT_DONE_BIT      (1 << 5)
 
 #endif // ZENOH_CONFIG_H
\ No newline at end of file
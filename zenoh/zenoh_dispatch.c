@@ -0,0 +1,152 @@
+/*
+ * zenoh_dispatch.c
+ *
+ * Moves subscriber callbacks off the zenoh read task: samples are cloned into
+ * a FreeRTOS queue and a small pool of pinned worker tasks runs the handler.
+ */
+
+#include "zenoh_dispatch.h"
+
+#if ZENOH_DISPATCH_ON // The entire file is conditionally compiled
+
+#define ZENOH_LOG_SUBSYSTEM DISPATCH
+#include "zenoh_log.h"
+#include <esp_timer.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "Z_DISPATCH";
+
+typedef struct {
+    z_owned_sample_t sample;
+    zenoh_dispatch_handler_t handler;
+    void *arg;
+    int64_t queued_us;
+} dispatch_item_t;
+
+static QueueHandle_t g_queue = NULL;
+static TaskHandle_t g_workers[ZENOH_DISPATCH_WORKERS];
+static SemaphoreHandle_t g_exit_sem = NULL; // given by each worker as it leaves, see zenoh_dispatch_stop()
+static zenoh_dispatch_handler_t g_handler = NULL;
+static void *g_handler_arg = NULL;
+
+static portMUX_TYPE g_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t g_high_water = 0;
+static uint32_t g_dispatched = 0;
+static uint32_t g_dropped = 0;
+static uint32_t g_wait_max_us = 0;
+static uint32_t g_handler_max_us = 0;
+static uint64_t g_handler_total_us = 0;
+
+// Runs until it receives a stop item (handler NULL), then gives g_exit_sem and deletes itself
+static void dispatch_worker(void *arg) {
+    (void)arg;
+    dispatch_item_t item;
+    while (1) {
+        if (xQueueReceive(g_queue, &item, portMAX_DELAY) != pdTRUE) { continue; }
+        if (item.handler == NULL) { break; }
+        int64_t start = esp_timer_get_time();
+        item.handler(z_loan_mut(item.sample), item.arg);
+        int64_t end = esp_timer_get_time();
+        z_drop(z_move(item.sample));
+
+        uint32_t wait_us = (uint32_t)(start - item.queued_us);
+        uint32_t run_us = (uint32_t)(end - start);
+        taskENTER_CRITICAL(&g_stats_lock);
+        g_dispatched++;
+        g_handler_total_us += run_us;
+        if (run_us > g_handler_max_us) { g_handler_max_us = run_us; }
+        if (wait_us > g_wait_max_us) { g_wait_max_us = wait_us; }
+        taskEXIT_CRITICAL(&g_stats_lock);
+        if (run_us > ZENOH_DISPATCH_SLOW_HANDLER_US) {
+            ZLOGD_HOT(TAG, "Slow handler: %lu us", (unsigned long)run_us);
+        }
+    }
+    xSemaphoreGive(g_exit_sem);
+    vTaskDelete(NULL);
+}
+
+void zenoh_dispatch_start(zenoh_dispatch_handler_t handler, void *arg) {
+    if (g_queue != NULL) { return; }
+    g_handler = handler;
+    g_handler_arg = arg;
+    if (g_exit_sem == NULL) { g_exit_sem = xSemaphoreCreateCounting(ZENOH_DISPATCH_WORKERS, 0); }
+    g_queue = xQueueCreate(ZENOH_DISPATCH_QUEUE_DEPTH, sizeof(dispatch_item_t));
+    if (g_queue == NULL) {
+        ZLOGE(TAG, "❗Failed to create dispatch queue❗");
+        return;
+    }
+    for (size_t i = 0; i < ZENOH_DISPATCH_WORKERS; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "zenoh_disp%u", (unsigned)i);
+        if (xTaskCreatePinnedToCore(dispatch_worker, name, ZENOH_DISPATCH_TASK_STACK, NULL,
+                ZENOH_DISPATCH_TASK_PRIO, &g_workers[i], ZENOH_DISPATCH_TASK_CORE) != pdPASS) {
+            ZLOGE(TAG, "❗Failed to create dispatch worker %u❗", (unsigned)i);
+            g_workers[i] = NULL;
+        }
+    }
+    ZLOGI(TAG, "Dispatching samples to %d worker(s) on core %d", ZENOH_DISPATCH_WORKERS, ZENOH_DISPATCH_TASK_CORE);
+}
+
+void zenoh_dispatch_stop() {
+    if (g_queue == NULL) { return; }
+    // Workers may be inside a handler that publishes (session mutex) or holds a
+    // sample: each leaves on its own stop item, queued ahead of pending samples
+    size_t running = 0;
+    dispatch_item_t stop = { .handler = NULL };
+    for (size_t i = 0; i < ZENOH_DISPATCH_WORKERS; i++) {
+        if (g_workers[i] != NULL) {
+            xQueueSendToFront(g_queue, &stop, portMAX_DELAY);
+            running++;
+        }
+    }
+    for (size_t i = 0; i < running; i++) { xSemaphoreTake(g_exit_sem, portMAX_DELAY); }
+    for (size_t i = 0; i < ZENOH_DISPATCH_WORKERS; i++) { g_workers[i] = NULL; }
+    dispatch_item_t item;
+    while (xQueueReceive(g_queue, &item, 0) == pdTRUE) { z_drop(z_move(item.sample)); }
+    vQueueDelete(g_queue);
+    g_queue = NULL;
+}
+
+bool zenoh_dispatch_sample(const z_loaned_sample_t *sample) {
+    return zenoh_dispatch_sample_to(sample, g_handler, g_handler_arg);
+}
+
+bool zenoh_dispatch_sample_to(const z_loaned_sample_t *sample, zenoh_dispatch_handler_t handler, void *arg) {
+    dispatch_item_t item;
+    bool queued = g_queue != NULL && z_sample_clone(&item.sample, sample) == Z_OK;
+    if (queued) {
+        item.handler = handler;
+        item.arg = arg;
+        item.queued_us = esp_timer_get_time();
+        queued = xQueueSend(g_queue, &item, 0) == pdTRUE;
+        if (!queued) { z_drop(z_move(item.sample)); }
+    }
+    uint32_t depth = g_queue != NULL ? (uint32_t)uxQueueMessagesWaiting(g_queue) : 0;
+    taskENTER_CRITICAL(&g_stats_lock);
+    if (!queued) { g_dropped++; }
+    if (depth > g_high_water) { g_high_water = depth; }
+    taskEXIT_CRITICAL(&g_stats_lock);
+    if (!queued) {
+        ZLOGW(TAG, "Dispatch queue full, sample dropped");
+    }
+    return queued;
+}
+
+void zenoh_dispatch_get_stats(zenoh_dispatch_stats_t *out) {
+    out->depth = g_queue != NULL ? (uint32_t)uxQueueMessagesWaiting(g_queue) : 0;
+    taskENTER_CRITICAL(&g_stats_lock);
+    out->high_water = g_high_water;
+    out->dispatched = g_dispatched;
+    out->dropped = g_dropped;
+    out->wait_max_us = g_wait_max_us;
+    out->handler_max_us = g_handler_max_us;
+    out->handler_avg_us = g_dispatched ? (uint32_t)(g_handler_total_us / g_dispatched) : 0;
+    taskEXIT_CRITICAL(&g_stats_lock);
+}
+
+#endif // ZENOH_DISPATCH_ON
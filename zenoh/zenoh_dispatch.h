@@ -0,0 +1,72 @@
+#ifndef ZENOH_DISPATCH_H
+#define ZENOH_DISPATCH_H
+
+#include <zenoh-pico.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "zenoh_config.h"
+
+#if ZENOH_DISPATCH_ON
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Same signature as z_data_handler_t in zenoh_manager.h
+typedef void (*zenoh_dispatch_handler_t)(z_loaned_sample_t *sample, void *arg);
+
+// Counters of the subscriber dispatch queue. Totals since start, except depth.
+typedef struct {
+    uint32_t depth;           // samples waiting for a worker
+    uint32_t high_water;      // deepest the queue has been
+    uint32_t dispatched;      // samples handed to the handler
+    uint32_t dropped;         // queue full or clone failed, never delivered
+    uint32_t wait_max_us;     // longest time a sample waited in the queue
+    uint32_t handler_max_us;  // slowest handler call
+    uint32_t handler_avg_us;  // mean handler call duration
+} zenoh_dispatch_stats_t;
+
+/**
+ * @brief Creates the queue and the worker tasks. Called by the manager on init.
+ * @param handler Called by a worker for every queued sample.
+ * @param arg Passed to handler.
+ */
+void zenoh_dispatch_start(zenoh_dispatch_handler_t handler, void *arg);
+
+/**
+ * @brief Stops the workers and drops every queued sample.
+ *
+ * Each worker finishes the handler it is running first, so the caller must
+ * not hold the session mutex.
+ */
+void zenoh_dispatch_stop();
+
+/**
+ * @brief Queues a sample for the workers; called from the zenoh read task.
+ *
+ * The sample is cloned (payload slices are reference counted, not copied),
+ * so the read task goes back to the socket right away. Never blocks: the
+ * sample is dropped if the queue is full.
+ *
+ * @return true if queued.
+ */
+bool zenoh_dispatch_sample(const z_loaned_sample_t *sample);
+
+/**
+ * @brief Same as zenoh_dispatch_sample() with a handler of its own, e.g. the
+ * handler of one subscription. Samples keep their queue order across handlers.
+ */
+bool zenoh_dispatch_sample_to(const z_loaned_sample_t *sample, zenoh_dispatch_handler_t handler, void *arg);
+
+/**
+ * @brief Copies the dispatch counters into *out.
+ */
+void zenoh_dispatch_get_stats(zenoh_dispatch_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_DISPATCH_ON
+#endif // ZENOH_DISPATCH_H
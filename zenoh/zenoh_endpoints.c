@@ -0,0 +1,167 @@
+/*
+ * zenoh_endpoints.c
+ *
+ * Connect endpoint list with concurrent TCP probing, used by the manager to
+ * pick the closest router/server and to fail over to the next one.
+ */
+
+#include "zenoh_endpoints.h"
+
+#define ZENOH_LOG_SUBSYSTEM ENDPOINTS
+#include "zenoh_log.h"
+#include <esp_timer.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include "zenoh_platform.h"
+#if ZENOH_PLATFORM_HOST
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#else
+#include "lwip/sockets.h"
+#endif
+
+static const char *TAG = "Z_ENDPOINTS";
+
+#define ZENOH_ENDPOINT(locator) { locator, false, ZENOH_ENDPOINT_RTT_UNKNOWN },
+static zenoh_endpoint_t g_endpoints[] = { ZENOH_CONNECT_ENDPOINTS };
+#undef ZENOH_ENDPOINT
+
+#define ENDPOINT_COUNT (sizeof(g_endpoints) / sizeof(g_endpoints[0]))
+static uint8_t g_rank[ENDPOINT_COUNT];
+static bool g_ranked = false;
+
+/**
+ * @brief Parses "tcp/<ipv4>:<port>[#...]" into a socket address.
+ * @return false for other protocols or host names, which are not probed.
+ */
+static bool parse_tcp_locator(const char *locator, struct sockaddr_in *addr) {
+    if (strncmp(locator, "tcp/", 4) != 0) { return false; }
+    const char *host = locator + 4;
+    const char *colon = strrchr(host, ':');
+    if (colon == NULL || colon - host >= 16) { return false; }
+    char ip[16];
+    memcpy(ip, host, colon - host);
+    ip[colon - host] = '\0';
+    // Port 1..65535, then the end or the locator's "#" configuration
+    if (colon[1] < '0' || colon[1] > '9') { return false; }
+    char *port_end;
+    unsigned long port = strtoul(colon + 1, &port_end, 10);
+    if (port == 0 || port > UINT16_MAX || (*port_end != '\0' && *port_end != '#')) {
+        return false;
+    }
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons((uint16_t)port);
+    return inet_pton(AF_INET, ip, &addr->sin_addr) == 1;
+}
+
+// Probe class used for ranking: 0 reachable, 1 not probed, 2 unreachable
+static int probe_class(const zenoh_endpoint_t *ep, bool probed) {
+    if (ep->reachable) { return 0; }
+    return probed ? 2 : 1;
+}
+
+size_t zenoh_endpoints_count() {
+    return ENDPOINT_COUNT;
+}
+
+size_t zenoh_endpoints_probe() {
+    int socks[ENDPOINT_COUNT];
+    bool probed[ENDPOINT_COUNT];
+    int64_t start = esp_timer_get_time();
+    int pending = 0;
+
+    for (size_t i = 0; i < ENDPOINT_COUNT; i++) {
+        struct sockaddr_in addr;
+        socks[i] = -1;
+        probed[i] = parse_tcp_locator(g_endpoints[i].locator, &addr);
+        g_endpoints[i].reachable = false;
+        g_endpoints[i].rtt_us = ZENOH_ENDPOINT_RTT_UNKNOWN;
+        if (!probed[i]) { continue; }
+        int s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (s < 0) { continue; }
+        fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+        int res = connect(s, (struct sockaddr *)&addr, sizeof(addr));
+        if (res == 0) {
+            g_endpoints[i].reachable = true;
+            g_endpoints[i].rtt_us = (uint32_t)(esp_timer_get_time() - start);
+            close(s);
+        } else if (errno == EINPROGRESS) {
+            socks[i] = s;
+            pending++;
+        } else {
+            close(s);
+        }
+    }
+
+    int64_t deadline = start + (int64_t)ZENOH_ENDPOINT_PROBE_TIMEOUT_MS * 1000;
+    while (pending > 0) {
+        int64_t now = esp_timer_get_time();
+        if (now >= deadline) { break; }
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        int maxfd = -1;
+        for (size_t i = 0; i < ENDPOINT_COUNT; i++) {
+            if (socks[i] >= 0) {
+                FD_SET(socks[i], &wfds);
+                if (socks[i] > maxfd) { maxfd = socks[i]; }
+            }
+        }
+        int64_t remaining_us = deadline - now;
+        struct timeval tv = { .tv_sec = (time_t)(remaining_us / 1000000), .tv_usec = (suseconds_t)(remaining_us % 1000000) };
+        if (select(maxfd + 1, NULL, &wfds, NULL, &tv) <= 0) { break; }
+        int64_t done = esp_timer_get_time();
+        for (size_t i = 0; i < ENDPOINT_COUNT; i++) {
+            if (socks[i] < 0 || !FD_ISSET(socks[i], &wfds)) { continue; }
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(socks[i], SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err == 0) {
+                g_endpoints[i].reachable = true;
+                g_endpoints[i].rtt_us = (uint32_t)(done - start);
+            }
+            close(socks[i]);
+            socks[i] = -1;
+            pending--;
+        }
+    }
+    for (size_t i = 0; i < ENDPOINT_COUNT; i++) {
+        if (socks[i] >= 0) { close(socks[i]); }
+    }
+
+    // Insertion sort, stable so equal endpoints keep the configured order
+    for (size_t i = 0; i < ENDPOINT_COUNT; i++) {
+        size_t j = i;
+        while (j > 0) {
+            const zenoh_endpoint_t *a = &g_endpoints[g_rank[j - 1]];
+            const zenoh_endpoint_t *b = &g_endpoints[i];
+            int ca = probe_class(a, probed[g_rank[j - 1]]);
+            int cb = probe_class(b, probed[i]);
+            if (ca < cb || (ca == cb && a->rtt_us <= b->rtt_us)) { break; }
+            g_rank[j] = g_rank[j - 1];
+            j--;
+        }
+        g_rank[j] = (uint8_t)i;
+    }
+    g_ranked = true;
+
+    for (size_t r = 0; r < ENDPOINT_COUNT; r++) {
+        const zenoh_endpoint_t *ep = &g_endpoints[g_rank[r]];
+        if (ep->reachable) {
+            ZLOGI(TAG, "#%u %s: %lu us", (unsigned)r, ep->locator, (unsigned long)ep->rtt_us);
+        } else {
+            ZLOGI(TAG, "#%u %s: %s", (unsigned)r, ep->locator, probed[g_rank[r]] ? "no answer" : "not probed");
+        }
+    }
+    return ENDPOINT_COUNT;
+}
+
+const zenoh_endpoint_t *zenoh_endpoint_get(size_t rank) {
+    if (rank >= ENDPOINT_COUNT) { return NULL; }
+    return &g_endpoints[g_ranked ? g_rank[rank] : rank];
+}
@@ -0,0 +1,50 @@
+#ifndef ZENOH_ENDPOINTS_H
+#define ZENOH_ENDPOINTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "zenoh_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ZENOH_ENDPOINT_RTT_UNKNOWN UINT32_MAX
+
+// One entry of ZENOH_CONNECT_ENDPOINTS with the result of the last probe
+typedef struct {
+    const char *locator; // e.g. "tcp/192.168.1.10:7447"
+    bool reachable;      // TCP connect succeeded within ZENOH_ENDPOINT_PROBE_TIMEOUT_MS
+    uint32_t rtt_us;     // TCP handshake time, ZENOH_ENDPOINT_RTT_UNKNOWN if not measured
+} zenoh_endpoint_t;
+
+/**
+ * @brief Number of configured connect endpoints.
+ */
+size_t zenoh_endpoints_count();
+
+/**
+ * @brief Probes every TCP endpoint concurrently and ranks them.
+ *
+ * All connects are started non-blocking at once and timed until the socket
+ * is writable, so probing costs one timeout at most, not one per endpoint.
+ * Ranking: reachable TCP endpoints by handshake time, then endpoints that
+ * cannot be probed (non-TCP, hostnames) in configured order, then TCP
+ * endpoints that did not answer.
+ *
+ * @return Number of ranked endpoints (zenoh_endpoints_count()).
+ */
+size_t zenoh_endpoints_probe();
+
+/**
+ * @brief Endpoint at the given rank of the last probe (configured order before any probe).
+ * @return NULL if rank is out of range.
+ */
+const zenoh_endpoint_t *zenoh_endpoint_get(size_t rank);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_ENDPOINTS_H
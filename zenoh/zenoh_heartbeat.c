@@ -2,87 +2,540 @@
 
 #if HEARTBEAT_ON // The entire file is conditionally compiled
 
-#include <esp_log.h>
+#include "zenoh_manager.h"
+#include "zenoh_utils.h"
+#define ZENOH_LOG_SUBSYSTEM HEARTBEAT
+#include "zenoh_log.h"
+#include <esp_timer.h>
+#include "zenoh_platform.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
 
 static const char *TAG = "Z_HEART";
 
-static z_owned_publisher_t heartbeat_publisher;
+#if ZENOH_HB_ADAPTIVE_ON && ZENOH_HB_MAX_SUPPRESSED >= ZENOH_HB_PEER_TIMEOUT_INTERVALS - 1
+#error "ZENOH_HB_MAX_SUPPRESSED must stay below ZENOH_HB_PEER_TIMEOUT_INTERVALS - 1, peers would time out"
+#endif
+
 static z_owned_subscriber_t subscriber_heartbeat;
 static TaskHandle_t heartbeat_task_handle = NULL;
+static SemaphoreHandle_t g_exit_sem = NULL; // given by the task when it leaves, see zenoh_heartbeat_stop()
+static volatile bool g_stopping = false;
+
+// Task notification bits of heartbeat_task
+#define HB_NOTIFY_WAKE 0x01 // heartbeat_boost() or zenoh_heartbeat_stop()
+#define HB_NOTIFY_ECHO 0x02 // echoes queued by the subscriber callback
+static z_id_t g_my_id;
+static char g_my_zid[ZENOH_HB_ZID_STR_LEN] = {0};
+
+/*
+ * Heartbeat text (ZENOH_HB_FORMAT_TEXT): "<HEARTBEAT_MESSAGE> #<counter> @<zid>";
+ * the binary layout is in zenoh_heartbeat.h. The legacy "<message> #<counter>"
+ * of older nodes is accepted too: such a peer is keyed by its message text and
+ * gets no echo. With
+ * ZENOH_HB_ECHO_ON each receiver sends "#<counter> @<own zid>" back on
+ * HEARTBEAT_CHANNEL "/echo/<sender zid>" and the sender matches the counter
+ * against its send times to get the RTT.
+ */
+#if ZENOH_HB_ECHO_ON
+static z_owned_subscriber_t subscriber_echo;
+static int64_t g_sent_us[ZENOH_HB_SEND_HISTORY];
+static uint32_t g_sent_seq[ZENOH_HB_SEND_HISTORY];
+
+// An echo owed to a peer; the read task queues it, the heartbeat task sends it
+typedef struct {
+    char zid[ZENOH_HB_ZID_STR_LEN];
+    uint32_t seq;
+} hb_echo_t;
+static QueueHandle_t g_echo_queue = NULL;
+#endif
+
+#if ZENOH_HB_ADAPTIVE_ON
+static volatile uint32_t g_last_publish_ms = 0; // last data put on KEYEXPR_PUB
+static volatile bool g_published = false;
+static volatile uint32_t g_fast_remaining = 0;  // heartbeats left at ZENOH_HB_FAST_INTERVAL_MS
+#endif
+
+static zenoh_hb_peer_t g_peers[ZENOH_HB_MAX_PEERS];
+static size_t g_peer_count = 0;
+static portMUX_TYPE g_peers_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Finds the entry of a ZID, creating it (or recycling the stalest one).
+ * Must be called with g_peers_lock held.
+ */
+static zenoh_hb_peer_t *peer_slot_locked(const char *zid) {
+    size_t oldest = 0;
+    for (size_t i = 0; i < g_peer_count; i++) {
+        if (strcmp(g_peers[i].zid, zid) == 0) { return &g_peers[i]; }
+        if (g_peers[i].last_seen_us < g_peers[oldest].last_seen_us) { oldest = i; }
+    }
+    size_t slot = g_peer_count < ZENOH_HB_MAX_PEERS ? g_peer_count++ : oldest;
+    zenoh_hb_peer_t *p = &g_peers[slot];
+    memset(p, 0, sizeof(*p));
+    strncpy(p->zid, zid, sizeof(p->zid) - 1);
+    p->rtt_us = ZENOH_HB_RTT_UNKNOWN;
+    p->cpu_load_pct = ZENOH_HB_CPU_UNKNOWN;
+    return p;
+}
+
+/**
+ * @brief Switches to the fast interval for the next ZENOH_HB_FAST_COUNT
+ * heartbeats and sends one right away.
+ */
+static void heartbeat_boost() {
+#if ZENOH_HB_ADAPTIVE_ON
+    g_fast_remaining = ZENOH_HB_FAST_COUNT;
+    if (heartbeat_task_handle != NULL) { xTaskNotify(heartbeat_task_handle, HB_NOTIFY_WAKE, eSetBits); }
+#endif
+}
+
+// One decoded heartbeat or echo, text or binary
+typedef struct {
+    char zid[ZENOH_HB_ZID_STR_LEN];
+    uint32_t seq;
+    uint8_t flags;
+    bool legacy;                    // "<message> #<counter>" without zid, zid holds the message
+    bool has_status;
+    uint64_t uptime_us;
+    uint32_t free_heap;
+    uint32_t min_free_heap;
+    uint16_t async_depth;
+    uint16_t dispatch_depth;
+    uint8_t cpu_load_pct;
+} hb_msg_t;
+
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t get_u32(const uint8_t *p) { return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16); }
+static uint64_t get_u64(const uint8_t *p) { return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32); }
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_u32(uint8_t *p, uint32_t v) { put_u16(p, (uint16_t)v); put_u16(p + 2, (uint16_t)(v >> 16)); }
+static void put_u64(uint8_t *p, uint64_t v) { put_u32(p, (uint32_t)v); put_u32(p + 4, (uint32_t)(v >> 32)); }
+
+/**
+ * @brief Extracts "#<counter>" and "@<zid>" from a heartbeat or echo text.
+ *
+ * Without "@<zid>" (legacy heartbeat) the text before " #" stands in for the
+ * zid and out->legacy is set.
+ * @return false if the counter is missing or the zid does not fit.
+ */
+static bool decode_text(const char *msg, size_t len, hb_msg_t *out) {
+    const char *hash = memchr(msg, '#', len);
+    if (hash == NULL || hash + 1 >= msg + len || hash[1] < '0' || hash[1] > '9') { return false; }
+    const char *at = memchr(hash, '@', len - (size_t)(hash - msg));
+    uint32_t seq = 0;
+    for (const char *c = hash + 1; c < msg + len && *c >= '0' && *c <= '9'; c++) { seq = seq * 10 + (uint32_t)(*c - '0'); }
+    const char *zid = at != NULL ? at + 1 : msg;
+    size_t zid_len = at != NULL ? len - (size_t)(zid - msg) : (size_t)(hash - msg);
+    while (at == NULL && zid_len > 0 && msg[zid_len - 1] == ' ') { zid_len--; }
+    if (zid_len == 0 || zid_len >= ZENOH_HB_ZID_STR_LEN) { return false; }
+    memset(out, 0, sizeof(*out));
+    memcpy(out->zid, zid, zid_len);
+    out->seq = seq;
+    out->legacy = at == NULL;
+    return true;
+}
+
+static bool decode_binary(const uint8_t *p, size_t len, hb_msg_t *out) {
+    if (len < ZENOH_HB_BINARY_LEN || p[0] != ZENOH_HB_MAGIC0 || p[1] != ZENOH_HB_MAGIC1 || p[2] != ZENOH_HB_VERSION) {
+        return false;
+    }
+    z_id_t zid;
+    memcpy(zid.id, p + 4, sizeof(zid.id));
+    format_zid(&zid, out->zid, sizeof(out->zid));
+    out->flags = p[3];
+    out->seq = get_u32(p + 20);
+    out->uptime_us = get_u64(p + 24);
+    out->free_heap = get_u32(p + 32);
+    out->min_free_heap = get_u32(p + 36);
+    out->async_depth = get_u16(p + 40);
+    out->dispatch_depth = get_u16(p + 42);
+    out->cpu_load_pct = p[44];
+    out->has_status = true;
+    return true;
+}
+
+/**
+ * @brief Decodes a heartbeat payload in place, without heap allocation.
+ *
+ * Reads the payload slice directly when it is contiguous, else copies at most
+ * one small frame to the stack.
+ */
+static bool decode_payload(const z_loaned_bytes_t *payload, hb_msg_t *out) {
+    uint8_t frame[64 + ZENOH_HB_ZID_STR_LEN];
+    size_t len;
+    const uint8_t *data = zenoh_bytes_data(payload, &len, frame, sizeof(frame));
+    if (len >= 2 && data[0] == ZENOH_HB_MAGIC0 && data[1] == ZENOH_HB_MAGIC1) {
+        return decode_binary(data, len, out);
+    }
+    return decode_text((const char *)data, len, out);
+}
+
+// Load of the core running the heartbeat task since the previous call, in percent
+static uint8_t cpu_load_pct() {
+#if configGENERATE_RUN_TIME_STATS
+    static configRUN_TIME_COUNTER_TYPE last_idle = 0, last_total = 0;
+    configRUN_TIME_COUNTER_TYPE idle = ulTaskGetIdleRunTimeCounter();
+    configRUN_TIME_COUNTER_TYPE total = portGET_RUN_TIME_COUNTER_VALUE();
+    configRUN_TIME_COUNTER_TYPE d_idle = idle - last_idle, d_total = total - last_total;
+    last_idle = idle;
+    last_total = total;
+    if (d_total == 0 || d_idle > d_total) { return 0; }
+    return (uint8_t)(100 - (uint64_t)d_idle * 100 / d_total);
+#else
+    return ZENOH_HB_CPU_UNKNOWN;
+#endif
+}
+
+static size_t encode_binary(uint8_t *buf, uint8_t flags, uint32_t seq, const z_id_t *zid) {
+    memset(buf, 0, ZENOH_HB_BINARY_LEN);
+    buf[0] = ZENOH_HB_MAGIC0;
+    buf[1] = ZENOH_HB_MAGIC1;
+    buf[2] = ZENOH_HB_VERSION;
+    buf[3] = flags;
+    memcpy(buf + 4, zid->id, sizeof(zid->id));
+    put_u32(buf + 20, seq);
+    put_u64(buf + 24, (uint64_t)esp_timer_get_time());
+    put_u32(buf + 32, zenoh_platform_free_heap());
+    put_u32(buf + 36, zenoh_platform_min_free_heap());
+#if ZENOH_ASYNC_PUBLISH_ON
+    zenoh_async_stats_t async_stats;
+    zenoh_async_get_stats(&async_stats);
+    put_u16(buf + 40, (uint16_t)async_stats.depth);
+#endif
+#if ZENOH_DISPATCH_ON
+    zenoh_dispatch_stats_t dispatch_stats;
+    zenoh_dispatch_get_stats(&dispatch_stats);
+    put_u16(buf + 42, (uint16_t)dispatch_stats.depth);
+#endif
+    buf[44] = (flags & ZENOH_HB_FLAG_ECHO) ? ZENOH_HB_CPU_UNKNOWN : cpu_load_pct();
+    return ZENOH_HB_BINARY_LEN;
+}
+
+static void track_heartbeat(const hb_msg_t *msg) {
+    int64_t now = esp_timer_get_time();
+    bool lost = false;
+    uint32_t last_seq = 0;
+    taskENTER_CRITICAL(&g_peers_lock);
+    zenoh_hb_peer_t *p = peer_slot_locked(msg->zid);
+    if (p->received == 0 || msg->seq <= p->last_seq) {
+        // First heartbeat or the sender restarted: start a new sequence
+        p->received = 0;
+        p->lost = 0;
+    } else {
+        p->lost += msg->seq - p->last_seq - 1;
+        lost = msg->seq - p->last_seq > 1;
+        last_seq = p->last_seq;
+    }
+    p->received++;
+    p->last_seq = msg->seq;
+    p->last_seen_us = now;
+    if (msg->has_status) {
+        p->has_status = true;
+        p->uptime_us = msg->uptime_us;
+        p->free_heap = msg->free_heap;
+        p->min_free_heap = msg->min_free_heap;
+        p->async_depth = msg->async_depth;
+        p->dispatch_depth = msg->dispatch_depth;
+        p->cpu_load_pct = msg->cpu_load_pct;
+    }
+    taskEXIT_CRITICAL(&g_peers_lock);
+    if (lost) {
+        ZLOG_EVENT(HB_LOSS, msg->seq - last_seq - 1, zenoh_log_key_hash(msg->zid, strlen(msg->zid)));
+        ZLOGD_HOT(TAG, "💓 heartbeats from %s lost, shortening interval", msg->zid);
+        heartbeat_boost();
+    }
+}
+
+#if ZENOH_HB_ECHO_ON
+// Heartbeat task only: goes through the manager's publish path, with the QoS profile of HEARTBEAT_CHANNEL
+static void send_echo(const char *zid, uint32_t seq) {
+    char key[sizeof(HEARTBEAT_CHANNEL) + sizeof("/echo/") + ZENOH_HB_ZID_STR_LEN];
+    snprintf(key, sizeof(key), "%s/echo/%s", HEARTBEAT_CHANNEL, zid);
+    z_owned_bytes_t payload;
+#if ZENOH_HB_FORMAT == ZENOH_HB_FORMAT_BINARY
+    uint8_t msg[ZENOH_HB_BINARY_LEN];
+    encode_binary(msg, ZENOH_HB_FLAG_ECHO, seq, &g_my_id);
+    z_bytes_from_static_buf(&payload, msg, sizeof(msg)); // the put serializes before returning
+#else
+    char msg[16 + ZENOH_HB_ZID_STR_LEN];
+    snprintf(msg, sizeof(msg), "#%lu @%s", (unsigned long)seq, g_my_zid);
+    z_bytes_copy_from_str(&payload, msg);
+#endif
+    zenoh_publish_bytes(key, &payload, NULL);
+}
+
+// Read task: hands the echo to the heartbeat task, dropped if ZENOH_HB_MAX_PEERS are pending
+static void queue_echo(const char *zid, uint32_t seq) {
+    hb_echo_t echo;
+    strcpy(echo.zid, zid);
+    echo.seq = seq;
+    TaskHandle_t task = heartbeat_task_handle;
+    if (task != NULL && xQueueSend(g_echo_queue, &echo, 0) == pdTRUE) {
+        xTaskNotify(task, HB_NOTIFY_ECHO, eSetBits);
+    }
+}
 
+static void send_queued_echoes() {
+    hb_echo_t echo;
+    while (!g_stopping && xQueueReceive(g_echo_queue, &echo, 0) == pdTRUE) { send_echo(echo.zid, echo.seq); }
+}
+
+static void sub_echo_handler(z_loaned_sample_t *sample, void *arg) {
+    (void)arg;
+    int64_t now = esp_timer_get_time();
+    hb_msg_t msg;
+    if (!decode_payload(z_sample_payload(sample), &msg) || msg.legacy) { return; }
+
+    size_t i = msg.seq % ZENOH_HB_SEND_HISTORY;
+    if (g_sent_seq[i] != msg.seq) { return; } // too old, slot reused
+    uint32_t rtt = (uint32_t)(now - g_sent_us[i]);
+    taskENTER_CRITICAL(&g_peers_lock);
+    zenoh_hb_peer_t *p = peer_slot_locked(msg.zid);
+    // Smoothed like TCP's SRTT: 7/8 old + 1/8 new
+    p->rtt_us = p->rtt_us == ZENOH_HB_RTT_UNKNOWN ? rtt : p->rtt_us - p->rtt_us / 8 + rtt / 8;
+    if (msg.has_status) {
+        // The echo was stamped halfway through the round trip, assuming a symmetric path.
+        // Low RTT samples have the least queuing error; aging the reference follows drift.
+        if (!p->has_clock_offset || rtt <= p->offset_rtt_us) {
+            p->clock_offset_us = (int64_t)msg.uptime_us - (g_sent_us[i] + now) / 2;
+            p->offset_rtt_us = rtt;
+            p->has_clock_offset = true;
+        } else {
+            p->offset_rtt_us += p->offset_rtt_us / 16 + 1;
+        }
+    }
+    taskEXIT_CRITICAL(&g_peers_lock);
+    ZLOGD_HOT(TAG, "💓 echo from %s: %lu us", msg.zid, (unsigned long)rtt);
+}
+#endif
+
+// Sleeps for interval_ms, sending queued echoes meanwhile; a wake notification ends it early
+static void heartbeat_wait(uint32_t interval_ms) {
+    TickType_t start = xTaskGetTickCount();
+    TickType_t ticks = pdMS_TO_TICKS(interval_ms);
+    TickType_t elapsed;
+    while (!g_stopping && (elapsed = xTaskGetTickCount() - start) < ticks) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, ticks - elapsed);
+#if ZENOH_HB_ECHO_ON
+        if (bits & HB_NOTIFY_ECHO) { send_queued_echoes(); }
+#endif
+        if (bits & HB_NOTIFY_WAKE) { return; }
+    }
+}
+
+// Runs until zenoh_heartbeat_stop() sets g_stopping, then gives g_exit_sem and deletes itself
 static void heartbeat_task(void *arg) {
     EventGroupHandle_t event_group = (EventGroupHandle_t)arg;
-    ESP_LOGD(TAG, "HEARTBEAT started. Waiting for Zenoh resources...");
+    ZLOGD(TAG, "HEARTBEAT started. Waiting for Zenoh resources...");
 
-    xEventGroupWaitBits(event_group, ZENOH_DECLARED_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
-    ESP_LOGD(TAG, "Zenoh resources ready. Starting heartbeat loop.");
+    while (!g_stopping && (xEventGroupWaitBits(event_group, ZENOH_DECLARED_BIT, pdFALSE, pdFALSE,
+                pdMS_TO_TICKS(100)) & ZENOH_DECLARED_BIT) == 0) {}
+    ZLOGD(TAG, "Zenoh resources ready. Starting heartbeat loop.");
 
-    uint32_t heartbeat_counter = 0;
-    char heartbeat_msg[64];
+    static uint32_t heartbeat_counter = 0; // keeps counting across reconnects, for loss tracking
+#if ZENOH_HB_FORMAT == ZENOH_HB_FORMAT_BINARY
+    static uint8_t heartbeat_msg[ZENOH_HB_BINARY_LEN];
+#else
+    char heartbeat_msg[64 + ZENOH_HB_ZID_STR_LEN];
+#endif
 
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(HEARTBEAT_INTERVAL_MS));
-        heartbeat_counter++;
-        snprintf(heartbeat_msg, sizeof(heartbeat_msg), "%s #%lu", HEARTBEAT_MESSAGE, heartbeat_counter);
+#if ZENOH_HB_ADAPTIVE_ON
+    uint32_t suppressed = 0;
+    uint32_t last_sent_ms = (uint32_t)(esp_timer_get_time() / 1000);
+#endif
 
-        // CORRECTED: Use the local heartbeat_publisher directly
-        ESP_LOGI("Z_MANAGER", "\033[38;5;214m🡆 OUT\033[0m:'%s' at '%s'", heartbeat_msg, HEARTBEAT_CHANNEL);
+    while (!g_stopping) {
+#if ZENOH_HB_ADAPTIVE_ON
+        uint32_t interval_ms = g_fast_remaining > 0 ? ZENOH_HB_FAST_INTERVAL_MS : zenoh_settings()->heartbeat_interval_ms;
+        heartbeat_wait(interval_ms); // heartbeat_boost() wakes it early
+        if (g_stopping) { break; }
+        uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        // Skipping must leave the next real heartbeat inside the peers' timeout window
+        uint32_t window_ms = ZENOH_HB_PEER_TIMEOUT_INTERVALS * zenoh_settings()->heartbeat_interval_ms;
+        if (g_fast_remaining > 0) {
+            g_fast_remaining--;
+        } else if (g_published && now_ms - g_last_publish_ms < interval_ms
+                && suppressed < ZENOH_HB_MAX_SUPPRESSED && now_ms - last_sent_ms + interval_ms < window_ms) {
+            // Data traffic on KEYEXPR_PUB already carries the liveness attachment
+            suppressed++;
+            continue;
+        }
+        suppressed = 0;
+        last_sent_ms = now_ms;
+#else
+        heartbeat_wait(zenoh_settings()->heartbeat_interval_ms);
+        if (g_stopping) { break; }
+#endif
+        heartbeat_counter++;
+#if ZENOH_HB_ECHO_ON
+        g_sent_seq[heartbeat_counter % ZENOH_HB_SEND_HISTORY] = heartbeat_counter;
+        g_sent_us[heartbeat_counter % ZENOH_HB_SEND_HISTORY] = esp_timer_get_time();
+#endif
         z_owned_bytes_t payload;
+#if ZENOH_HB_FORMAT == ZENOH_HB_FORMAT_BINARY
+        encode_binary(heartbeat_msg, 0, heartbeat_counter, &g_my_id);
+        ZLOGD_HOT(TAG, "💓 OUT #%lu at '%s'", heartbeat_counter, HEARTBEAT_CHANNEL);
+        z_bytes_from_static_buf(&payload, heartbeat_msg, sizeof(heartbeat_msg)); // the put serializes before returning
+#else
+        snprintf(heartbeat_msg, sizeof(heartbeat_msg), "%s #%lu @%s", HEARTBEAT_MESSAGE, heartbeat_counter, g_my_zid);
+        ZLOGD_HOT(TAG, "💓 OUT '%s' at '%s'", heartbeat_msg, HEARTBEAT_CHANNEL);
         z_bytes_copy_from_str(&payload, heartbeat_msg);
-        z_publisher_put(z_loan(heartbeat_publisher), z_move(payload), NULL);
+#endif
+        zenoh_publish_bytes(HEARTBEAT_CHANNEL, &payload, NULL);
+        ZLOG_EVENT(HB_OUT, heartbeat_counter, g_peer_count);
     }
+    xSemaphoreGive(g_exit_sem);
+    vTaskDelete(NULL);
 }
 
 static void sub_heartbeat_handler(z_loaned_sample_t* sample, void* arg) {
     (void)arg;
-    z_view_string_t keystr;
-    z_keyexpr_as_view_string(z_sample_keyexpr(sample), &keystr);
-    z_owned_string_t payload_str;
-    z_bytes_to_string(z_sample_payload(sample), &payload_str);
-
-    ESP_LOGI(TAG, "\033[38;5;199m💓 HB IN\033[0m: '%.*s' on '%.*s'",
-            (int)z_string_len(z_loan(payload_str)),
-            z_string_data(z_loan(payload_str)),
-            (int)z_string_len(z_loan(keystr)),
-            z_string_data(z_loan(keystr)));
-
-    z_drop(z_move(payload_str));
+    hb_msg_t msg;
+    if (!decode_payload(z_sample_payload(sample), &msg)) {
+        ZLOGD_HOT(TAG, "💓 HB IN: unrecognized payload (%u bytes)", (unsigned)z_bytes_len(z_sample_payload(sample)));
+        return;
+    }
+    ZLOGD_HOT(TAG, "💓 HB IN: #%lu from %s", (unsigned long)msg.seq, msg.zid);
+    ZLOG_EVENT(HB_IN, msg.seq, zenoh_log_key_hash(msg.zid, strlen(msg.zid)));
+    if (strcmp(msg.zid, g_my_zid) == 0) { return; }
+    track_heartbeat(&msg);
+#if ZENOH_HB_ECHO_ON
+    if (!msg.legacy) { queue_echo(msg.zid, msg.seq); } // a put here would wait for the session mutex in the read task
+#endif
 }
 
 void zenoh_heartbeat_init(z_loaned_session_t *session, EventGroupHandle_t event_group) {
-    ESP_LOGD(TAG, "Heartbeat Initializing...");
-
-    z_view_keyexpr_t hb_pub_key;
-    z_view_keyexpr_from_str_unchecked(&hb_pub_key, HEARTBEAT_CHANNEL);
-    if (z_declare_publisher(session, &heartbeat_publisher, z_loan(hb_pub_key), NULL) < 0) {
-        ESP_LOGE(TAG, "❗Unable to declare heartbeat publisher at '%s'❗", HEARTBEAT_CHANNEL);
-    } else {
-        ESP_LOGI(TAG, "📡 Heartbeat Publisher for 💓 at %s", HEARTBEAT_CHANNEL);
-    }
+    ZLOGD(TAG, "Heartbeat Initializing...");
+    g_my_id = z_info_zid(session);
+    format_zid(&g_my_id, g_my_zid, sizeof(g_my_zid));
 
     z_owned_closure_sample_t sub_closure_heartbeat;
     z_closure(&sub_closure_heartbeat, sub_heartbeat_handler, NULL, NULL);
     z_view_keyexpr_t ke_sub_heartbeat;
     z_view_keyexpr_from_str_unchecked(&ke_sub_heartbeat, HEARTBEAT_CHANNEL);
     if (z_declare_subscriber(session, &subscriber_heartbeat, z_loan(ke_sub_heartbeat), z_move(sub_closure_heartbeat), NULL) < 0) {
-        ESP_LOGE(TAG, "❗Unable to declare subscriber on '%s'❗", HEARTBEAT_CHANNEL);
+        ZLOGE(TAG, "❗Unable to declare subscriber on '%s'❗", HEARTBEAT_CHANNEL);
     } else {
-        ESP_LOGI(TAG, "📥 Subscriber for 💓 on '%s'", HEARTBEAT_CHANNEL);
+        ZLOGI(TAG, "📥 Subscriber for 💓 on '%s'", HEARTBEAT_CHANNEL);
     }
 
-    xTaskCreate(heartbeat_task, "heartbeat_task", 4096, event_group, 5, &heartbeat_task_handle);
+#if ZENOH_HB_ECHO_ON
+    char echo_key[sizeof(HEARTBEAT_CHANNEL) + sizeof("/echo/") + ZENOH_HB_ZID_STR_LEN];
+    snprintf(echo_key, sizeof(echo_key), "%s/echo/%s", HEARTBEAT_CHANNEL, g_my_zid);
+    z_owned_closure_sample_t sub_closure_echo;
+    z_closure(&sub_closure_echo, sub_echo_handler, NULL, NULL);
+    z_view_keyexpr_t ke_echo;
+    z_view_keyexpr_from_str_unchecked(&ke_echo, echo_key);
+    if (z_declare_subscriber(session, &subscriber_echo, z_loan(ke_echo), z_move(sub_closure_echo), NULL) < 0) {
+        ZLOGE(TAG, "❗Unable to declare subscriber on '%s'❗", echo_key);
+    }
+#endif
+
+#if ZENOH_HB_ADAPTIVE_ON
+    g_fast_remaining = ZENOH_HB_FAST_COUNT; // (re)connected: let peers know quickly
+#endif
+    if (g_exit_sem == NULL) { g_exit_sem = xSemaphoreCreateBinary(); }
+#if ZENOH_HB_ECHO_ON
+    if (g_echo_queue == NULL) { g_echo_queue = xQueueCreate(ZENOH_HB_MAX_PEERS, sizeof(hb_echo_t)); }
+#endif
+    g_stopping = false;
+    ZLOGI(TAG, "📡 Heartbeat for 💓 at %s", HEARTBEAT_CHANNEL);
+    xTaskCreatePinnedToCore(heartbeat_task, "heartbeat_task", ZENOH_HB_TASK_STACK, event_group, ZENOH_HB_TASK_PRIO,
+            &heartbeat_task_handle, ZENOH_HB_TASK_CORE);
+}
+
+void zenoh_heartbeat_note_publish() {
+#if ZENOH_HB_ADAPTIVE_ON
+    g_last_publish_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    g_published = true;
+#endif
+}
+
+void zenoh_heartbeat_note_alive(const z_id_t *zid) {
+    char zid_str[ZENOH_HB_ZID_STR_LEN] = {0};
+    format_zid(zid, zid_str, sizeof(zid_str));
+    if (strcmp(zid_str, g_my_zid) == 0) { return; }
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&g_peers_lock);
+    peer_slot_locked(zid_str)->last_seen_us = now;
+    taskEXIT_CRITICAL(&g_peers_lock);
+}
+
+bool zenoh_heartbeat_clock_offset(const z_id_t *zid, int64_t *offset_us) {
+    char zid_str[ZENOH_HB_ZID_STR_LEN] = {0};
+    format_zid(zid, zid_str, sizeof(zid_str));
+    bool found = false;
+    taskENTER_CRITICAL(&g_peers_lock);
+    for (size_t i = 0; i < g_peer_count && !found; i++) {
+        if (strcmp(g_peers[i].zid, zid_str) == 0 && g_peers[i].has_clock_offset) {
+            *offset_us = g_peers[i].clock_offset_us;
+            found = true;
+        }
+    }
+    taskEXIT_CRITICAL(&g_peers_lock);
+    return found;
 }
 
 void zenoh_heartbeat_stop() {
     if (heartbeat_task_handle != NULL) {
-        vTaskDelete(heartbeat_task_handle);
+        // The task may be inside a put holding the session mutex: let it finish
+        g_stopping = true;
+        xTaskNotify(heartbeat_task_handle, HB_NOTIFY_WAKE, eSetBits);
+        xSemaphoreTake(g_exit_sem, portMAX_DELAY);
         heartbeat_task_handle = NULL;
     }
-    z_drop(z_move(heartbeat_publisher));
+#if ZENOH_HB_ECHO_ON
+    if (g_echo_queue != NULL) { xQueueReset(g_echo_queue); }
+#endif
     z_drop(z_move(subscriber_heartbeat));
+#if ZENOH_HB_ECHO_ON
+    z_drop(z_move(subscriber_echo));
+#endif
+}
+
+size_t zenoh_heartbeat_peers(zenoh_hb_peer_t *out, size_t max) {
+    int64_t timeout_ms = (int64_t)ZENOH_HB_PEER_TIMEOUT_INTERVALS * zenoh_settings()->heartbeat_interval_ms;
+    int64_t oldest = esp_timer_get_time() - timeout_ms * 1000;
+    taskENTER_CRITICAL(&g_peers_lock);
+    size_t n = g_peer_count < max ? g_peer_count : max;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = g_peers[i];
+        out[i].alive = g_peers[i].last_seen_us >= oldest;
+    }
+    taskEXIT_CRITICAL(&g_peers_lock);
+    return n;
+}
+
+uint32_t zenoh_heartbeat_loss_permille(const zenoh_hb_peer_t *peer) {
+    uint32_t expected = peer->received + peer->lost;
+    return expected ? (uint32_t)((uint64_t)peer->lost * 1000 / expected) : 0;
+}
+
+bool zenoh_heartbeat_best_peer(zenoh_hb_peer_t *out) {
+    zenoh_hb_peer_t peers[ZENOH_HB_MAX_PEERS];
+    size_t n = zenoh_heartbeat_peers(peers, ZENOH_HB_MAX_PEERS);
+    const zenoh_hb_peer_t *best = NULL;
+    for (size_t i = 0; i < n; i++) {
+        const zenoh_hb_peer_t *p = &peers[i];
+        if (!p->alive) { continue; }
+        uint32_t loss = zenoh_heartbeat_loss_permille(p);
+        uint32_t best_loss = best != NULL ? zenoh_heartbeat_loss_permille(best) : 0;
+        if (best == NULL || p->rtt_us < best->rtt_us
+            || (p->rtt_us == best->rtt_us && loss < best_loss)
+            || (p->rtt_us == best->rtt_us && loss == best_loss && p->cpu_load_pct < best->cpu_load_pct)) {
+            best = p;
+        }
+    }
+    if (best == NULL) { return false; }
+    *out = *best;
+    return true;
 }
 
-#endif // HEARTBEAT_ON
\ No newline at end of file
+#endif // HEARTBEAT_ON
@@ -2,6 +2,8 @@
 #define ZENOH_HEARTBEAT_H
 
 #include <zenoh-pico.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include "zenoh_config.h"
 #include "freertos/event_groups.h"
 
@@ -11,21 +13,107 @@
 extern "C" {
 #endif
 
+#define ZENOH_HB_ZID_STR_LEN (sizeof(((z_id_t *)0)->id) * 2 + 1)
+#define ZENOH_HB_RTT_UNKNOWN UINT32_MAX
+#define ZENOH_HB_CPU_UNKNOWN 0xFF
+
+/*
+ * Binary heartbeat (ZENOH_HB_FORMAT_BINARY), little endian, 48 bytes:
+ *   'Z' 'H' <version=1> <flags>   u8 zid[16]   u32 counter   u64 uptime_us
+ *   u32 free_heap   u32 min_free_heap   u16 async_depth   u16 dispatch_depth
+ *   u8 cpu_load_pct   u8 reserved[3]
+ * Echoes reuse the layout with ZENOH_HB_FLAG_ECHO set, the responder's zid and
+ * the echoed counter. Receivers accept both the binary and the text format.
+ */
+#define ZENOH_HB_MAGIC0 'Z'
+#define ZENOH_HB_MAGIC1 'H'
+#define ZENOH_HB_VERSION 1
+#define ZENOH_HB_FLAG_ECHO 0x01
+#define ZENOH_HB_BINARY_LEN 48
+
+// What is known about a node from its heartbeats
+typedef struct {
+    char zid[ZENOH_HB_ZID_STR_LEN]; // sender ZID, hex
+    int64_t last_seen_us;           // esp_timer time of the last heartbeat
+    uint32_t last_seq;              // last '#counter' received
+    uint32_t received;              // heartbeats received since the sequence (re)started
+    uint32_t lost;                  // counter gaps since the sequence (re)started
+    uint32_t rtt_us;                // smoothed echo RTT, ZENOH_HB_RTT_UNKNOWN without echo
+    bool alive;                     // seen within ZENOH_HB_PEER_TIMEOUT_INTERVALS heartbeat intervals
+    // Clock of the peer minus ours, from binary echoes (NTP style, lowest RTT sample wins)
+    bool has_clock_offset;
+    int64_t clock_offset_us;
+    uint32_t offset_rtt_us;         // RTT of the sample the offset came from, aged upwards
+    // Node status, only filled by binary heartbeats
+    bool has_status;
+    uint64_t uptime_us;
+    uint32_t free_heap;
+    uint32_t min_free_heap;
+    uint16_t async_depth;           // publish queue depth of the sender
+    uint16_t dispatch_depth;        // subscriber dispatch queue depth of the sender
+    uint8_t cpu_load_pct;           // ZENOH_HB_CPU_UNKNOWN without run time stats
+} zenoh_hb_peer_t;
+
 /**
- * @brief Initializes the heartbeat publisher, subscriber, and task.
- * @param session A loan to the active Zenoh session.
+ * @brief Initializes the heartbeat subscribers and task.
+ *
+ * Heartbeats and echoes are published through zenoh_publish_bytes(), under the
+ * manager's session lock.
+ * @param session A loan to the session the subscribers are declared on.
  * @param event_group The application event group to wait on for resource declaration.
  */
 void zenoh_heartbeat_init(z_loaned_session_t *session, EventGroupHandle_t event_group);
 
 /**
- * @brief Stops the heartbeat task and cleans up its resources.
+ * @brief Stops the heartbeat task and cleans up its resources. The peer table is kept.
+ *
+ * Waits for a put in flight, so the caller must not hold the session mutex.
  */
 void zenoh_heartbeat_stop();
 
+/**
+ * @brief Tells the heartbeat that data went out on KEYEXPR_PUB.
+ *
+ * With ZENOH_HB_ADAPTIVE_ON, heartbeats are skipped (up to
+ * ZENOH_HB_MAX_SUPPRESSED in a row) while such traffic proves liveness.
+ * Called by the manager after each successful put.
+ */
+void zenoh_heartbeat_note_publish();
+
+/**
+ * @brief Refreshes the last-seen time of a peer from a piggybacked liveness attachment.
+ */
+void zenoh_heartbeat_note_alive(const z_id_t *zid);
+
+/**
+ * @brief Clock offset of a peer: its esp_timer time minus ours.
+ *
+ * Needs ZENOH_HB_ECHO_ON and the binary format on both sides. A timestamp t
+ * taken by the peer corresponds to t - offset on the local clock.
+ * @return false if no estimate is available yet.
+ */
+bool zenoh_heartbeat_clock_offset(const z_id_t *zid, int64_t *offset_us);
+
+/**
+ * @brief Copies up to max entries of the peer table into out.
+ * @return Number of entries copied.
+ */
+size_t zenoh_heartbeat_peers(zenoh_hb_peer_t *out, size_t max);
+
+/**
+ * @brief Picks the closest live peer: lowest RTT, then lowest loss rate, then lowest CPU load.
+ * @return true if a live peer was copied into *out.
+ */
+bool zenoh_heartbeat_best_peer(zenoh_hb_peer_t *out);
+
+/**
+ * @brief Loss rate of a peer in parts per thousand.
+ */
+uint32_t zenoh_heartbeat_loss_permille(const zenoh_hb_peer_t *peer);
+
 #ifdef __cplusplus
 }
 #endif
 
 #endif // HEARTBEAT_ON
-#endif // ZENOH_HEARTBEAT_H
\ No newline at end of file
+#endif // ZENOH_HEARTBEAT_H
@@ -0,0 +1,134 @@
+/*
+ * zenoh_log.c
+ *
+ * Deferred event log: the data path stores fixed-size records in a ring and a
+ * low priority task formats and prints them, off the publish/receive paths.
+ */
+
+#include "zenoh_log.h"
+
+#include <stdio.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+uint32_t zenoh_log_key_hash(const char *keyexpr, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)keyexpr[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+#if ZENOH_LOG_DEFERRED_ON
+
+static const char *TAG = "Z_EVENTS";
+
+typedef struct {
+    int64_t time_us;
+    uint32_t a;
+    uint32_t b;
+    uint8_t event;
+} log_record_t;
+
+static const char *const g_formats[ZENOH_EV_COUNT] = {
+#define ZENOH_LOG_EVENT(name, fmt) fmt,
+    ZENOH_LOG_EVENTS
+#undef ZENOH_LOG_EVENT
+};
+
+static log_record_t g_ring[ZENOH_LOG_RING_SIZE];
+static uint32_t g_head = 0; // next record to write
+static uint32_t g_tail = 0; // next record to print
+static uint32_t g_dropped = 0;
+static portMUX_TYPE g_ring_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t g_drain_task = NULL;
+static SemaphoreHandle_t g_exit_sem = NULL; // given by the drain task when it leaves, see zenoh_log_stop()
+static volatile bool g_stopping = false;
+
+void zenoh_log_event(zenoh_log_event_t event, uint32_t a, uint32_t b) {
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&g_ring_lock);
+    if (g_head - g_tail < ZENOH_LOG_RING_SIZE) {
+        log_record_t *r = &g_ring[g_head % ZENOH_LOG_RING_SIZE];
+        r->time_us = now;
+        r->a = a;
+        r->b = b;
+        r->event = (uint8_t)event;
+        g_head++;
+    } else {
+        g_dropped++;
+    }
+    taskEXIT_CRITICAL(&g_ring_lock);
+}
+
+static void drain() {
+    log_record_t r;
+    char line[96];
+    while (1) {
+        taskENTER_CRITICAL(&g_ring_lock);
+        bool have = g_tail != g_head;
+        if (have) { r = g_ring[g_tail++ % ZENOH_LOG_RING_SIZE]; }
+        taskEXIT_CRITICAL(&g_ring_lock);
+        if (!have) { break; }
+        if (r.event >= ZENOH_EV_COUNT) { continue; }
+        snprintf(line, sizeof(line), g_formats[r.event], (unsigned long)r.a, (unsigned long)r.b);
+        ESP_LOGI(TAG, "[%lld.%06lld] %s", (long long)(r.time_us / 1000000), (long long)(r.time_us % 1000000), line);
+    }
+}
+
+// Runs until zenoh_log_stop() sets g_stopping, then gives g_exit_sem and deletes itself
+static void drain_task(void *arg) {
+    (void)arg;
+    uint32_t reported_drops = 0;
+    while (!g_stopping) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ZENOH_LOG_DRAIN_PERIOD_MS)); // zenoh_log_stop() wakes it
+        drain();
+        uint32_t dropped = zenoh_log_dropped();
+        if (dropped != reported_drops) {
+            ESP_LOGW(TAG, "%lu events dropped (ZENOH_LOG_RING_SIZE)", (unsigned long)(dropped - reported_drops));
+            reported_drops = dropped;
+        }
+    }
+    xSemaphoreGive(g_exit_sem);
+    vTaskDelete(NULL);
+}
+
+void zenoh_log_start() {
+    if (g_drain_task != NULL) { return; }
+    if (g_exit_sem == NULL) { g_exit_sem = xSemaphoreCreateBinary(); }
+    g_stopping = false;
+    if (xTaskCreatePinnedToCore(drain_task, "zenoh_log", ZENOH_LOG_TASK_STACK, NULL, ZENOH_LOG_TASK_PRIO,
+            &g_drain_task, ZENOH_LOG_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "❗Failed to create log drain task❗");
+        g_drain_task = NULL;
+    }
+}
+
+void zenoh_log_stop() {
+    if (g_drain_task == NULL) { return; }
+    // Deleting it mid-print could leave the console lock held: let it finish
+    g_stopping = true;
+    xTaskNotifyGive(g_drain_task);
+    xSemaphoreTake(g_exit_sem, portMAX_DELAY);
+    g_drain_task = NULL;
+    drain();
+}
+
+uint32_t zenoh_log_dropped() {
+    taskENTER_CRITICAL(&g_ring_lock);
+    uint32_t dropped = g_dropped;
+    taskEXIT_CRITICAL(&g_ring_lock);
+    return dropped;
+}
+
+#else
+
+void zenoh_log_event(zenoh_log_event_t event, uint32_t a, uint32_t b) { (void)event; (void)a; (void)b; }
+void zenoh_log_start() { }
+void zenoh_log_stop() { }
+uint32_t zenoh_log_dropped() { return 0; }
+
+#endif // ZENOH_LOG_DEFERRED_ON
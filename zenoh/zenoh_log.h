@@ -0,0 +1,104 @@
+#ifndef ZENOH_LOG_H
+#define ZENOH_LOG_H
+
+#include <esp_log.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "zenoh_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compile-time log levels per subsystem. A module defines ZENOH_LOG_SUBSYSTEM
+ * (MANAGER, HEARTBEAT, SCOUT, SELFTEST, ASYNC, BATCH, COMPRESS, DISPATCH,
+ * ENDPOINTS, POOL, SETTINGS, TRACE, TRANSFER or UTILS) before including this
+ * header and logs with ZLOGE..ZLOGV at ZENOH_LOG_LEVEL_<subsystem>. Per message
+ * logs of the data path use ZLOGI_HOT / ZLOGD_HOT at ZENOH_LOG_LEVEL_HOT. A call
+ * above its level is dead code, so the call, its arguments and its format
+ * string compile away.
+ * The runtime esp_log level still applies on top.
+ */
+#define ZENOH_LOG_NONE 0
+#define ZENOH_LOG_ERROR 1
+#define ZENOH_LOG_WARN 2
+#define ZENOH_LOG_INFO 3
+#define ZENOH_LOG_DEBUG 4
+#define ZENOH_LOG_VERBOSE 5
+
+#define ZENOH_LOG_LEVEL_OF_(sub) ZENOH_LOG_LEVEL_##sub
+#define ZENOH_LOG_LEVEL_OF(sub) ZENOH_LOG_LEVEL_OF_(sub)
+#define ZENOH_LOG_IF(level, limit, esp_log, tag, fmt, ...) \
+    do { if ((limit) >= (level)) { esp_log(tag, fmt, ##__VA_ARGS__); } } while (0)
+
+#define ZLOGE(tag, fmt, ...) ZENOH_LOG_IF(ZENOH_LOG_ERROR, ZENOH_LOG_LEVEL_OF(ZENOH_LOG_SUBSYSTEM), ESP_LOGE, tag, fmt, ##__VA_ARGS__)
+#define ZLOGW(tag, fmt, ...) ZENOH_LOG_IF(ZENOH_LOG_WARN, ZENOH_LOG_LEVEL_OF(ZENOH_LOG_SUBSYSTEM), ESP_LOGW, tag, fmt, ##__VA_ARGS__)
+#define ZLOGI(tag, fmt, ...) ZENOH_LOG_IF(ZENOH_LOG_INFO, ZENOH_LOG_LEVEL_OF(ZENOH_LOG_SUBSYSTEM), ESP_LOGI, tag, fmt, ##__VA_ARGS__)
+#define ZLOGD(tag, fmt, ...) ZENOH_LOG_IF(ZENOH_LOG_DEBUG, ZENOH_LOG_LEVEL_OF(ZENOH_LOG_SUBSYSTEM), ESP_LOGD, tag, fmt, ##__VA_ARGS__)
+#define ZLOGV(tag, fmt, ...) ZENOH_LOG_IF(ZENOH_LOG_VERBOSE, ZENOH_LOG_LEVEL_OF(ZENOH_LOG_SUBSYSTEM), ESP_LOGV, tag, fmt, ##__VA_ARGS__)
+
+#define ZLOGI_HOT(tag, fmt, ...) ZENOH_LOG_IF(ZENOH_LOG_INFO, ZENOH_LOG_LEVEL_HOT, ESP_LOGI, tag, fmt, ##__VA_ARGS__)
+#define ZLOGD_HOT(tag, fmt, ...) ZENOH_LOG_IF(ZENOH_LOG_DEBUG, ZENOH_LOG_LEVEL_HOT, ESP_LOGD, tag, fmt, ##__VA_ARGS__)
+
+/*
+ * Deferred events: ZLOG_EVENT(name, a, b) only stores {time, event, a, b} in a
+ * ring (no formatting); a low priority task prints them every
+ * ZENOH_LOG_DRAIN_PERIOD_MS. Events beyond ZENOH_LOG_RING_SIZE are counted and
+ * dropped. Keys are logged as zenoh_log_key_hash(), printed next to the key
+ * when publishers are declared.
+ *   ZENOH_LOG_EVENT(name, format of the two u32 arguments)
+ */
+#define ZENOH_LOG_EVENTS \
+    ZENOH_LOG_EVENT(PUT_FAIL,  "put failed (-%lu) on key #%08lx") \
+    ZENOH_LOG_EVENT(QUERY,     "GET served on key #%08lx in %lu us") \
+    ZENOH_LOG_EVENT(HB_OUT,    "💓 OUT #%lu, %lu peers") \
+    ZENOH_LOG_EVENT(HB_IN,     "💓 IN #%lu from %08lx") \
+    ZENOH_LOG_EVENT(HB_LOSS,   "💓 %lu heartbeats lost from %08lx")
+
+typedef enum {
+#define ZENOH_LOG_EVENT(name, fmt) ZENOH_EV_##name,
+    ZENOH_LOG_EVENTS
+#undef ZENOH_LOG_EVENT
+    ZENOH_EV_COUNT
+} zenoh_log_event_t;
+
+#if ZENOH_LOG_DEFERRED_ON
+#define ZLOG_EVENT(name, a, b) zenoh_log_event(ZENOH_EV_##name, (uint32_t)(a), (uint32_t)(b))
+#else
+#define ZLOG_EVENT(name, a, b) do { } while (0)
+#endif
+
+/**
+ * @brief Records an event in the ring. Never blocks, safe from any task.
+ */
+void zenoh_log_event(zenoh_log_event_t event, uint32_t a, uint32_t b);
+
+/**
+ * @brief Starts the drain task. Called by the manager on init.
+ */
+void zenoh_log_start();
+
+/**
+ * @brief Prints what is left in the ring and stops the drain task.
+ */
+void zenoh_log_stop();
+
+/**
+ * @brief Events dropped because the ring was full.
+ */
+uint32_t zenoh_log_dropped();
+
+/**
+ * @brief 32-bit FNV-1a hash identifying a key expression in deferred events.
+ *
+ * The one key hash of the component: the publisher registry and the queryable
+ * tree use it too, so logged hashes match theirs.
+ */
+uint32_t zenoh_log_key_hash(const char *keyexpr, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_LOG_H
@@ -14,14 +14,41 @@
 
 #include "zenoh_manager.h"
 #include "zenoh_scout.h"
+#include "zenoh_selftest.h"
+#include "zenoh_compress.h"
 #include "zenoh_utils.h"
 #include "zenoh_heartbeat.h"
-#include <esp_log.h>
+#include "zenoh_async.h"
+#include "zenoh_pool.h"
+#include "zenoh_batch.h"
+#include "zenoh_transfer.h"
+#include "zenoh_dispatch.h"
+#include "zenoh_endpoints.h"
+#include "zenoh_attachment.h"
+#include "zenoh_settings.h"
+#include "zenoh_stats.h"
+#include "zenoh_trace.h"
+#define ZENOH_LOG_SUBSYSTEM MANAGER
+#include "zenoh_log.h"
 #include <string.h>
 #include <unistd.h>
 #include <stdio.h>
-#include "esp_heap_caps.h"
+#include <atomic>
+#include "zenoh_platform.h"
+#if !ZENOH_PLATFORM_HOST
 #include "esp_netif.h"
+#include "esp_event.h"
+#endif
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+
+#if ZENOH_LOCAL_DELIVERY_ON && (!defined(Z_FEATURE_LOCAL_SUBSCRIBER) || Z_FEATURE_LOCAL_SUBSCRIBER == 0)
+#error "ZENOH_LOCAL_DELIVERY_ON needs zenoh-pico built with Z_FEATURE_LOCAL_SUBSCRIBER=1"
+#endif
+#if ZENOH_LOCAL_DELIVERY_ON && !ZENOH_DISPATCH_ON
+#error "ZENOH_LOCAL_DELIVERY_ON needs ZENOH_DISPATCH_ON: local samples arrive inside the put"
+#endif
 
 // Provider callback (set by main). See zenoh_manager.h for typedef.
 static zenoh_query_provider_t g_query_provider = NULL;
@@ -36,82 +63,805 @@ void zenoh_set_queryable_data(void *data) {
     (void)data; // legacy stub, storage belongs to application
 }
 
+// Streaming provider (set by main). See zenoh_manager.h for typedef.
+static zenoh_query_stream_provider_t g_query_stream_provider = NULL;
+static void *g_query_stream_provider_ctx = NULL;
+
+void zenoh_register_query_stream_provider(zenoh_query_stream_provider_t cb, void *ctx) {
+    g_query_stream_provider = cb;
+    g_query_stream_provider_ctx = ctx;
+}
+
+// Per-GET state handed to a streaming provider
+struct zenoh_query_ctx {
+    const z_loaned_query_t *query;
+    const char *key;
+    size_t key_len;
+    const char *params;
+    size_t params_len;
+    uint32_t calls;
+    uint32_t replies;
+    uintptr_t state;
+};
+
 #if ZENOH_ENABLED
 
 static const char *TAG = "Z_MNGR";
 
+// QoS profiles from zenoh_config.h
+typedef struct {
+    const char *prefix;
+    size_t prefix_len;
+    z_congestion_control_t congestion_control;
+    z_priority_t priority;
+    bool is_express;
+} qos_profile_t;
+
+#define ZENOH_QOS(prefix, cc, prio, express) { prefix, sizeof(prefix) - 1, cc, prio, express },
+static const qos_profile_t g_qos_profiles[] = { ZENOH_QOS_PROFILES };
+#undef ZENOH_QOS
+static const qos_profile_t g_qos_default = { "", 0, ZENOH_QOS_DEFAULT_CONGESTION,
+        ZENOH_QOS_DEFAULT_PRIORITY, ZENOH_QOS_DEFAULT_EXPRESS };
+
+/**
+ * @brief Returns the QoS profile for a key expression.
+ *
+ * A profile matches when the key equals its prefix or is a sub-key of it.
+ */
+static const qos_profile_t *qos_profile_for(const char *keyexpr) {
+    for (size_t i = 0; i < sizeof(g_qos_profiles) / sizeof(g_qos_profiles[0]); i++) {
+        const qos_profile_t *p = &g_qos_profiles[i];
+        if (strncmp(keyexpr, p->prefix, p->prefix_len) == 0 &&
+            (keyexpr[p->prefix_len] == '\0' || keyexpr[p->prefix_len] == '/')) {
+            return p;
+        }
+    }
+    return &g_qos_default;
+}
+
+// Reply options for data served by the queryable, from the KEYEXPR_DATA_QUERY profile
+static void data_reply_options(z_query_reply_options_t *options) {
+    const qos_profile_t *qos = qos_profile_for(KEYEXPR_DATA_QUERY);
+    z_query_reply_options_default(options);
+    options->congestion_control = qos->congestion_control;
+    options->priority = qos->priority;
+    options->is_express = qos->is_express;
+}
+
+/*
+ * Queryable dispatch table: a prefix tree over key expression segments.
+ * Each node stores its segment with the segment's FNV-1a hash and length, so
+ * a GET is routed by hashing its key once, segment by segment, and comparing
+ * bytes only on hash matches; the deepest node with a provider wins. Node 0 is
+ * the root; nodes emptied by an unregistration go back to a free list.
+ */
+typedef struct {
+    uint32_t hash;
+    uint16_t len;
+    int16_t parent;
+    int16_t child;   // first child, -1 if none
+    int16_t sibling; // next sibling (next free node once released), -1 if none
+    char seg[ZENOH_QUERYABLE_SEGMENT_MAX_LEN];
+    zenoh_query_stream_provider_t provider;
+    void *ctx;
+} query_node_t;
+
+static query_node_t g_query_nodes[ZENOH_QUERYABLE_TRIE_NODES] = { { 0, 0, -1, -1, -1, { 0 }, NULL, NULL } };
+static size_t g_query_nodes_used = 1;
+static int g_query_nodes_free = -1;
+static portMUX_TYPE g_query_nodes_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Hashes the segment starting at key, stopping at '/' or end; returns its length
+static size_t segment_hash(const char *key, size_t len, uint32_t *hash) {
+    const char *slash = (const char *)memchr(key, '/', len);
+    size_t n = slash != NULL ? (size_t)(slash - key) : len;
+    *hash = zenoh_log_key_hash(key, n);
+    return n;
+}
+
+static int find_child(int parent, const char *seg, uint32_t hash, size_t len) {
+    for (int i = g_query_nodes[parent].child; i >= 0; i = g_query_nodes[i].sibling) {
+        const query_node_t *c = &g_query_nodes[i];
+        if (c->hash == hash && c->len == len && memcmp(c->seg, seg, len) == 0) { return i; }
+    }
+    return -1;
+}
+
+// Takes a node from the free list, else from the unused tail; -1 if the tree is full
+static int query_node_alloc(void) {
+    int i = g_query_nodes_free;
+    if (i >= 0) {
+        g_query_nodes_free = g_query_nodes[i].sibling;
+    } else if (g_query_nodes_used < ZENOH_QUERYABLE_TRIE_NODES) {
+        i = (int)g_query_nodes_used++;
+    }
+    return i;
+}
+
+// Releases node and its ancestors while they hold neither a provider nor children
+static void query_node_prune(int node) {
+    while (node > 0 && g_query_nodes[node].provider == NULL && g_query_nodes[node].child < 0) {
+        int parent = g_query_nodes[node].parent;
+        int16_t *link = &g_query_nodes[parent].child;
+        while (*link != node) { link = &g_query_nodes[*link].sibling; }
+        *link = g_query_nodes[node].sibling;
+        g_query_nodes[node].sibling = (int16_t)g_query_nodes_free;
+        g_query_nodes_free = node;
+        node = parent;
+    }
+}
+
+/**
+ * @brief Finds the provider of the longest registered prefix of key.
+ *
+ * Wildcard segments end the walk, so "a/b/**" is served like "a/b".
+ * @return true if a provider was found.
+ */
+static bool query_route(const char *key, size_t len, zenoh_query_stream_provider_t *provider, void **ctx) {
+    bool found = false;
+    taskENTER_CRITICAL(&g_query_nodes_lock);
+    int node = 0;
+    size_t off = 0;
+    while (off < len) {
+        uint32_t h;
+        size_t n = segment_hash(key + off, len - off, &h);
+        if (n > ZENOH_QUERYABLE_SEGMENT_MAX_LEN || memchr(key + off, '*', n) != NULL) { break; }
+        node = find_child(node, key + off, h, n);
+        if (node < 0) { break; }
+        if (g_query_nodes[node].provider != NULL) {
+            *provider = g_query_nodes[node].provider;
+            *ctx = g_query_nodes[node].ctx;
+            found = true;
+        }
+        off += n + 1;
+    }
+    taskEXIT_CRITICAL(&g_query_nodes_lock);
+    return found;
+}
+
+/**
+ * @brief Sets (or clears, with provider NULL) the provider of a key expression.
+ *
+ * Clearing releases the nodes left without a provider or children.
+ * @return 0 on success, -1 if the tree is full or a segment is too long.
+ */
+static int query_route_set(const char *keyexpr, zenoh_query_stream_provider_t provider, void *ctx) {
+    size_t len = strlen(keyexpr);
+    int res = 0;
+    taskENTER_CRITICAL(&g_query_nodes_lock);
+    int node = 0;
+    size_t off = 0;
+    while (off < len) {
+        uint32_t h;
+        size_t n = segment_hash(keyexpr + off, len - off, &h);
+        int next = n > ZENOH_QUERYABLE_SEGMENT_MAX_LEN ? -1 : find_child(node, keyexpr + off, h, n);
+        if (next < 0) {
+            if (provider == NULL) { node = -1; break; } // nothing to clear
+            if (n > ZENOH_QUERYABLE_SEGMENT_MAX_LEN || (next = query_node_alloc()) < 0) { res = -1; break; }
+            query_node_t *c = &g_query_nodes[next];
+            *c = { h, (uint16_t)n, (int16_t)node, -1, g_query_nodes[node].child, { 0 }, NULL, NULL };
+            memcpy(c->seg, keyexpr + off, n);
+            g_query_nodes[node].child = (int16_t)next;
+        }
+        node = next;
+        off += n + 1;
+    }
+    if (res == 0 && node > 0) {
+        g_query_nodes[node].provider = provider;
+        g_query_nodes[node].ctx = ctx;
+    }
+    if (provider == NULL || res < 0) { query_node_prune(node); } // also drops a partial path
+    taskEXIT_CRITICAL(&g_query_nodes_lock);
+    return res;
+}
+
+void zenoh_qos_publisher_options(const char *keyexpr, z_publisher_options_t *options) {
+    const qos_profile_t *p = qos_profile_for(keyexpr);
+    z_publisher_options_default(options);
+    options->congestion_control = p->congestion_control;
+    options->priority = p->priority;
+    options->is_express = p->is_express;
+}
+
 extern "C" {
     /**
      * @brief Frees payload memory using either heap_caps or malloc/free depending on context.
      *
-     * If context is NULL, the memory is freed using heap caps.
-     * Otherwise, the memory is freed using malloc/free.
+     * Blocks of the payload pool are always returned to the pool.
+     * Otherwise, if context is NULL, the memory is freed using heap caps,
+     * else the memory is freed using malloc/free.
      *
      * @param data Pointer to the memory block to be freed.
      * @param context Context determining whether to use heap caps or malloc/free. 
      * If NULL, uses heap caps. Otherwise, uses malloc/free.
      */
     static void payload_deleter(void *data, void *context) {
-        ESP_LOGD("PAYLOAD_DELETER", "Freeing payload at address %p", data);
+        ZLOGD_HOT("PAYLOAD_DELETER", "Freeing payload at address %p", data);
+#if ZENOH_PAYLOAD_POOL_ON
+        if (zenoh_payload_pool_owns(data)) {
+            zenoh_payload_release(data);
+            return;
+        }
+#endif
         if (context != NULL) {
             free(data);
         } else {
-            heap_caps_free(data);
+            zenoh_psram_free(data);
         }
     }
 
+#if ZENOH_COMPRESSION_ON
     /**
-     * @brief Handle incoming GET queries from the network.
+     * @brief Replaces *payload by its compressed form if the key asks for it and it pays off.
      *
-     * This function is called when an incoming GET query is received from the network.
-     * It will first check if a query provider callback is registered. If so, it will
-     * call the callback with the context provided during registration. If the callback
-     * returns success, the payload will be transmitted back to the querying device.
-     * If no query provider callback is registered, or if the callback returns an error,
-     * an error response will be sent back to the querying device.
+     * Only single-slice payloads are compressed, multi-slice ones go as is.
+     */
+    static void compress_payload(const char *key, size_t key_len, z_owned_bytes_t *payload) {
+        zenoh_bytes_view_t view;
+        if (!zenoh_bytes_view(z_loan(*payload), &view) || !zenoh_compress_wants(key, key_len, view.len)) { return; }
+        uint8_t *packed;
+        size_t len = zenoh_compress(view.data, view.len, &packed);
+        if (len == 0) { return; }
+        z_owned_bytes_t compressed;
+        if (z_bytes_from_buf(&compressed, packed, len, zenoh_compress_free, NULL) != Z_OK) {
+            zenoh_compress_free(packed, NULL);
+            return;
+        }
+        z_drop(z_move(*payload));
+        *payload = compressed;
+    }
+#endif
+
+    /**
+     * @brief Runs the streaming provider for a GET until it is done.
      *
-     * @param query Pointer to the incoming query structure.
-     * @param context Context passed during registration of the query provider callback.
+     * The provider is called at most ZENOH_QUERY_STREAM_MAX_CALLS times; an
+     * error reply is sent if it fails before replying anything.
      */
-    static void client_query_handler(const z_loaned_query_t *query, void *context) {
+    static void run_stream_provider(const z_loaned_query_t *query, const z_view_string_t *key_view,
+            zenoh_query_stream_provider_t provider, void *provider_ctx) {
+        zenoh_query_ctx_t qctx;
+        memset(&qctx, 0, sizeof(qctx));
+        qctx.query = query;
+        qctx.key = z_string_data(z_loan(*key_view));
+        qctx.key_len = z_string_len(z_loan(*key_view));
+        z_view_string_t params_view;
+        z_query_parameters(query, &params_view);
+        qctx.params = z_string_data(z_loan(params_view));
+        qctx.params_len = z_string_len(z_loan(params_view));
+
+        int res = ZENOH_STREAM_MORE;
+        while (res == ZENOH_STREAM_MORE && qctx.calls < ZENOH_QUERY_STREAM_MAX_CALLS) {
+            res = provider(provider_ctx, &qctx);
+            qctx.calls++;
+        }
+        if (res == ZENOH_STREAM_MORE) {
+            ZLOGW(TAG, "Stream provider still busy after %d calls, reply truncated", ZENOH_QUERY_STREAM_MAX_CALLS);
+        }
+        if (res < 0 && qctx.replies == 0) {
+            z_owned_bytes_t err_payload;
+            z_bytes_empty(&err_payload);
+            z_query_reply_err(query, z_move(err_payload), NULL);
+        }
+        ZLOGD_HOT(TAG, "Stream provider sent %lu replies in %lu calls",
+                (unsigned long)qctx.replies, (unsigned long)qctx.calls);
+    }
+
+    // Routes a GET to the first handler that serves it, see client_query_handler
+    static void serve_query(const z_loaned_query_t *query) {
         z_view_string_t key_view;
         z_keyexpr_as_view_string(z_query_keyexpr(query), &key_view);
-        ESP_LOGI(TAG, "💡 Queryable received GET for '%.*s'", (int)z_string_len(z_loan(key_view)), z_string_data(z_loan(key_view)));
+        ZLOGI_HOT(TAG, "💡 Queryable received GET for '%.*s'", (int)z_string_len(z_loan(key_view)), z_string_data(z_loan(key_view)));
+
+#if ZENOH_TRANSFER_ON
+        if (zenoh_transfer_handle_query(query)) { return; } // chunk protocol
+#endif
 
-        if (g_query_provider != NULL) {
+        zenoh_query_stream_provider_t provider = NULL;
+        void *provider_ctx = NULL;
+        if (query_route(z_string_data(z_loan(key_view)), z_string_len(z_loan(key_view)), &provider, &provider_ctx)) {
+            run_stream_provider(query, &key_view, provider, provider_ctx);
+        } else if (g_query_stream_provider != NULL) {
+            run_stream_provider(query, &key_view, g_query_stream_provider, g_query_stream_provider_ctx);
+        } else if (g_query_provider != NULL) {
             z_owned_bytes_t payload;
             if (g_query_provider(g_query_provider_ctx, &payload) == 0) {
-                z_query_reply(query, z_query_keyexpr(query), z_move(payload), NULL);
+#if ZENOH_COMPRESSION_ON
+                compress_payload(z_string_data(z_loan(key_view)), z_string_len(z_loan(key_view)), &payload);
+#endif
+                z_query_reply_options_t reply_opts;
+                data_reply_options(&reply_opts);
+                z_query_reply(query, z_query_keyexpr(query), z_move(payload), &reply_opts);
             } else {
                 z_owned_bytes_t err_payload;
                 z_bytes_empty(&err_payload);
                 z_query_reply_err(query, z_move(err_payload), NULL);
             }
         } else {
-            ESP_LOGE(TAG, "Query received but no data is staged for transfer!");
+            ZLOGE(TAG, "Query received but no data is staged for transfer!");
             z_owned_bytes_t err_payload;
             z_bytes_empty(&err_payload);
             z_query_reply_err(query, z_move(err_payload), NULL);
         }
     }
+
+    /**
+     * @brief Handle incoming GET queries from the network.
+     *
+     * This function is called when an incoming GET query is received from the network.
+     * Chunk protocol queries go to the transfer module, then the provider
+     * registered for the longest matching prefix of the key (zenoh_register_queryable)
+     * and then a streaming provider, preferred over the single-buffer one. Otherwise it will first
+     * check if a query provider callback is registered. If so, it will
+     * call the callback with the context provided during registration. If the callback
+     * returns success, the payload will be transmitted back to the querying device.
+     * If no query provider callback is registered, or if the callback returns an error,
+     * an error response will be sent back to the querying device.
+     *
+     * @param query Pointer to the incoming query structure.
+     * @param context Context passed during registration of the query provider callback.
+     */
+    static void client_query_handler(const z_loaned_query_t *query, void *context) {
+        int64_t started_us = esp_timer_get_time();
+        serve_query(query);
+        uint32_t served_us = (uint32_t)(esp_timer_get_time() - started_us);
+#if ZENOH_STATS_ON
+        zenoh_stats_record_latency(ZENOH_STATS_QUERY, served_us);
+#endif
+#if ZENOH_LOG_DEFERRED_ON
+        z_view_string_t key_view;
+        z_keyexpr_as_view_string(z_query_keyexpr(query), &key_view);
+        ZLOG_EVENT(QUERY, zenoh_log_key_hash(z_string_data(z_loan(key_view)), z_string_len(z_loan(key_view))), served_us);
+#endif
+        (void)served_us;
+    }
+
+    int zenoh_query_reply_bytes(zenoh_query_ctx_t *query, z_owned_bytes_t *payload) {
+#if ZENOH_COMPRESSION_ON
+        compress_payload(query->key, query->key_len, payload);
+#endif
+        z_query_reply_options_t reply_opts;
+        data_reply_options(&reply_opts);
+        int res = z_query_reply(query->query, z_query_keyexpr(query->query), z_move(*payload), &reply_opts);
+        if (res < 0) {
+            ZLOGW(TAG, "z_query_reply failed (%d)", res);
+        } else {
+            query->replies++;
+        }
+        return res;
+    }
+
+    int zenoh_query_reply_data(zenoh_query_ctx_t *query, const uint8_t *data, size_t len) {
+        z_owned_bytes_t payload;
+        if (z_bytes_from_static_buf(&payload, data, len) != Z_OK) { return _Z_ERR_GENERIC; }
+        return zenoh_query_reply_bytes(query, &payload);
+    }
+
+    uint32_t zenoh_query_call_index(const zenoh_query_ctx_t *query) { return query->calls; }
+
+    uintptr_t *zenoh_query_state(zenoh_query_ctx_t *query) { return &query->state; }
+
+    const char *zenoh_query_key(const zenoh_query_ctx_t *query, size_t *len) {
+        *len = query->key_len;
+        return query->key;
+    }
+
+    bool zenoh_query_param(const zenoh_query_ctx_t *query, const char *key, const char **value, size_t *len) {
+        return zenoh_utils_param_get(query->params, query->params_len, key, value, len);
+    }
+
+    bool zenoh_query_param_u32(const zenoh_query_ctx_t *query, const char *key, uint32_t *out) {
+        const char *value;
+        size_t len;
+        return zenoh_query_param(query, key, &value, &len) && zenoh_utils_param_u32(value, len, out);
+    }
+
+    size_t zenoh_query_param_u32_list(const zenoh_query_ctx_t *query, const char *key, uint32_t *out, size_t max) {
+        const char *value;
+        size_t len;
+        if (!zenoh_query_param(query, key, &value, &len)) { return 0; }
+        size_t n = 0, start = 0;
+        for (size_t i = 0; i <= len && n < max; i++) {
+            if (i == len || value[i] == ',') {
+                if (!zenoh_utils_param_u32(&value[start], i - start, &out[n])) { break; }
+                n++;
+                start = i + 1;
+            }
+        }
+        return n;
+    }
 } // extern "C"
 
 // Module-local static variables
 static z_owned_session_t session;
+static SemaphoreHandle_t g_session_mutex = NULL; // held while the session is opened or closed and during puts
+static bool g_session_open = false;
+static std::atomic<uint32_t> g_put_failures(0); // consecutive failed puts, see session_lost()
+
+#if ZENOH_LOCAL_DELIVERY_ON
+// Task inside a put, set under g_session_mutex. zenoh-pico calls local
+// subscribers from within the put, so a callback in this task got a local sample.
+static std::atomic<TaskHandle_t> g_local_put_task(NULL);
+
+static bool sample_is_local() {
+    return g_local_put_task.load(std::memory_order_relaxed) == xTaskGetCurrentTaskHandle();
+}
+#endif
+
+#if ZENOH_HYBRID_ON
+// Multicast session of the hybrid transport, next to the TCP one. Opened and
+// closed by the supervisor only; g_mcast_open is written under g_session_mutex.
+static z_owned_session_t g_mcast_session;
+static bool g_mcast_open = false;
+static std::atomic<uint32_t> g_mcast_put_failures(0); // like g_put_failures, see hybrid_supervise()
+
+#define ZENOH_HYBRID_KEY(keyexpr) keyexpr,
+static const char *const g_hybrid_keys[] = { ZENOH_HYBRID_UDP_KEYEXPRS NULL };
+#undef ZENOH_HYBRID_KEY
+
+// Puts on a listed key or a sub-key of one go out on multicast
+static bool hybrid_routes_udp(const char *keyexpr) {
+    for (size_t i = 0; g_hybrid_keys[i] != NULL; i++) {
+        size_t n = strlen(g_hybrid_keys[i]);
+        if (strncmp(keyexpr, g_hybrid_keys[i], n) == 0 && (keyexpr[n] == '\0' || keyexpr[n] == '/')) { return true; }
+    }
+    return false;
+}
+
+#if SUBSCRIBER_ON
+// A subscription is declared on multicast too if it can match a routed key
+static bool hybrid_overlaps_udp(const char *keyexpr) {
+    z_view_keyexpr_t ke;
+    if (z_view_keyexpr_from_str(&ke, keyexpr) < 0) { return false; }
+    char tree[ZENOH_KEYEXPR_MAX_LEN];
+    for (size_t i = 0; g_hybrid_keys[i] != NULL; i++) {
+        snprintf(tree, sizeof(tree), "%s/**", g_hybrid_keys[i]);
+        z_view_keyexpr_t key, sub;
+        z_view_keyexpr_from_str_unchecked(&key, g_hybrid_keys[i]);
+        z_view_keyexpr_from_str_unchecked(&sub, tree);
+        if (z_keyexpr_intersects(z_loan(ke), z_loan(key)) || z_keyexpr_intersects(z_loan(ke), z_loan(sub))) { return true; }
+    }
+    return false;
+}
+#endif
+#endif // ZENOH_HYBRID_ON
+
+// Endpoint cache: the config resolved from the active interface, reused by every
+// reconnect attempt until an IP_EVENT marks it stale
+static z_owned_config_t g_cached_config;
+static bool g_config_cached = false;
+static char g_cached_endpoint[ZENOH_SCOUT_LOCATOR_MAX_LEN] = ""; // endpoint the cached config connects to
+
+#if SCOUT_ON
+static char g_scouted_endpoint[ZENOH_SCOUT_LOCATOR_MAX_LEN];
+static bool g_have_scouted = false; // the current connect pass starts with g_scouted_endpoint
+#endif
+static std::atomic<bool> g_config_stale(false);
+#if !ZENOH_PLATFORM_HOST
+static esp_event_handler_instance_t g_ip_event_instance = NULL;
+#endif
 static TaskHandle_t zenoh_task_handle = NULL;
 static EventGroupHandle_t app_event_group = NULL;
 
 #if SUBSCRIBER_ON
 static z_owned_subscriber_t main_subscriber;
+static bool g_main_subscriber_declared = false;
+#if ZENOH_HYBRID_ON
+static z_owned_subscriber_t g_mcast_main_subscriber;
+static bool g_mcast_main_subscriber_declared = false;
+#endif
+static z_data_handler_t g_data_handler = NULL;
+
+// Subscriptions made with zenoh_subscribe(). The handle packs the slot index
+// and a generation, so a handle kept after zenoh_unsubscribe() matches nothing.
+typedef struct {
+    bool in_use;
+    bool declared;
+    uint16_t generation;
+    char keyexpr[ZENOH_KEYEXPR_MAX_LEN];
+    z_data_handler_t handler;
+    void *ctx;
+    z_owned_subscriber_t subscriber;
+#if ZENOH_HYBRID_ON
+    bool mcast_declared;
+    z_owned_subscriber_t mcast_subscriber; // same slot on the multicast session
+#endif
+} subscription_t;
+
+static subscription_t g_subscriptions[ZENOH_MAX_SUBSCRIPTIONS];
+static portMUX_TYPE g_subscriptions_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#define SUBSCRIPTION_HANDLE(index, generation) ((zenoh_subscription_t)(((uint32_t)(generation) << 8) | (index)))
+#define SUBSCRIPTION_INDEX(handle) ((uint32_t)(handle) & 0xff)
+#define SUBSCRIPTION_GENERATION(handle) ((uint16_t)((uint32_t)(handle) >> 8))
+
+/**
+ * @brief Feeds the attachment of a sample to the heartbeat peer table and the tracer.
+ */
+static void note_sample_attachment(const z_loaned_sample_t *sample) {
+#if ZENOH_TRACE_ON
+    zenoh_trace_note_sample(sample);
+#endif
+#if HEARTBEAT_ON && ZENOH_HB_PIGGYBACK_ON
+    z_id_t zid;
+    size_t zid_len = sizeof(zid.id);
+    if (zenoh_attachment_find(z_sample_attachment(sample), ZENOH_ATTACH_LIVENESS, zid.id, &zid_len)
+        && zid_len == sizeof(zid.id)) {
+        zenoh_heartbeat_note_alive(&zid);
+    }
+#else
+    (void)sample;
+#endif
+}
+
+// Decompresses or unbatches a received sample as needed, then calls handler
+static void unwrap_sample(z_loaned_sample_t *sample, z_data_handler_t handler, void *arg) {
+#if ZENOH_COMPRESSION_ON
+    if (zenoh_compress_dispatch(sample, handler, arg)) { return; }
+#endif
+#if ZENOH_BATCHING_ON
+    zenoh_batch_dispatch(sample, handler, arg);
+#else
+    handler(sample, arg);
+#endif
+}
+
+/**
+ * @brief Delivers a sample to the application, decompressing or unbatching it first.
+ */
+static void deliver_sample(z_loaned_sample_t *sample, void *arg) {
+#if ZENOH_STATS_ON
+    int64_t started_us = esp_timer_get_time();
+#endif
+    unwrap_sample(sample, g_data_handler, arg);
+#if ZENOH_STATS_ON
+    zenoh_stats_record_latency(ZENOH_STATS_HANDLER, (uint32_t)(esp_timer_get_time() - started_us));
+#endif
+}
+
+/**
+ * @brief Subscriber callback, runs in the zenoh read task.
+ *
+ * With ZENOH_DISPATCH_ON the sample is only queued here and a worker calls
+ * the application handler, so slow handlers cannot stall socket reads.
+ */
+static void subscriber_trampoline(z_loaned_sample_t *sample, void *arg) {
+#if ZENOH_LOCAL_DELIVERY_ON
+    if (sample_is_local()) { return; } // this board's own publication
+#endif
+    note_sample_attachment(sample);
+#if ZENOH_DISPATCH_ON
+    (void)arg;
+    zenoh_dispatch_sample(sample);
+#else
+    deliver_sample(sample, arg);
+#endif
+}
+
+/**
+ * @brief Looks up the handler of a live subscription.
+ * @return false if the handle was unsubscribed (or its slot reused).
+ */
+static bool subscription_resolve(uintptr_t handle, z_data_handler_t *handler, void **ctx) {
+    uint32_t index = SUBSCRIPTION_INDEX(handle);
+    if (index >= ZENOH_MAX_SUBSCRIPTIONS) { return false; }
+    taskENTER_CRITICAL(&g_subscriptions_lock);
+    subscription_t *s = &g_subscriptions[index];
+    bool live = s->in_use && s->generation == SUBSCRIPTION_GENERATION(handle);
+    if (live) {
+        *handler = s->handler;
+        *ctx = s->ctx;
+    }
+    taskEXIT_CRITICAL(&g_subscriptions_lock);
+    return live;
+}
+
+/**
+ * @brief Delivers a sample to the handler of one subscription, decompressing or unbatching it first.
+ *
+ * Resolved at delivery time, so samples still queued for dispatch when the
+ * subscription goes away are dropped instead of reaching a stale ctx.
+ */
+static void deliver_subscription(z_loaned_sample_t *sample, void *arg) {
+    z_data_handler_t handler;
+    void *ctx;
+    if (!subscription_resolve((uintptr_t)arg, &handler, &ctx)) { return; }
+#if ZENOH_STATS_ON
+    int64_t started_us = esp_timer_get_time();
+#endif
+    unwrap_sample(sample, handler, ctx);
+#if ZENOH_STATS_ON
+    zenoh_stats_record_latency(ZENOH_STATS_HANDLER, (uint32_t)(esp_timer_get_time() - started_us));
+#endif
+}
+
+#if ZENOH_LOCAL_DELIVERY_ON
+/**
+ * @brief Queues a local sample with its own copy of payload and attachment.
+ *
+ * The publisher's buffers (Codec<T> values, stack and static buffers, the
+ * trace and liveness attachments) are only valid until its put returns,
+ * while the queued sample is handled later by a dispatch worker. A refcounted
+ * z_bytes_clone() would still point at them, hence the copy: one allocation
+ * and memcpy of payload and attachment per matching local subscription.
+ */
+static void dispatch_local_copy(const z_loaned_sample_t *sample, void *arg) {
+    z_owned_bytes_t payload;
+    if (!zenoh_utils_bytes_copy(z_sample_payload(sample), &payload)) {
+        ZLOGE(TAG, "❗No memory to copy a local sample, dropped❗");
+        return;
+    }
+    z_loaned_sample_t copy;
+    zenoh_utils_sample_with_payload(sample, z_loan(payload), &copy);
+    const z_loaned_bytes_t *attachment = z_sample_attachment(sample);
+    z_owned_bytes_t attachment_copy;
+    if (attachment != NULL) {
+        if (!zenoh_utils_bytes_copy(attachment, &attachment_copy)) {
+            ZLOGE(TAG, "❗No memory to copy a local sample, dropped❗");
+            z_drop(z_move(payload));
+            return;
+        }
+        zenoh_utils_sample_with_attachment(&copy, z_loan(attachment_copy), &copy);
+    }
+    zenoh_dispatch_sample_to(&copy, deliver_subscription, arg); // the queued clone keeps the copies alive
+    z_drop(z_move(payload));
+    if (attachment != NULL) { z_drop(z_move(attachment_copy)); }
+}
+#endif
+
+// Callback of a zenoh_subscribe() subscriber, arg is the handle
+static void subscription_trampoline(z_loaned_sample_t *sample, void *arg) {
+#if ZENOH_LOCAL_DELIVERY_ON
+    // Local: queued, as the publisher still holds g_session_mutex
+    if (sample_is_local()) {
+        dispatch_local_copy(sample, arg);
+        return;
+    }
+#endif
+    note_sample_attachment(sample);
+#if ZENOH_DISPATCH_ON
+    zenoh_dispatch_sample_to(sample, deliver_subscription, arg);
+#else
+    deliver_subscription(sample, arg);
+#endif
+}
+
+// Declares a subscriber for slot index on zs, delivering through subscription_trampoline
+static bool subscribe_slot_on(const z_loaned_session_t *zs, size_t index, z_owned_subscriber_t *out) {
+    subscription_t *s = &g_subscriptions[index];
+    z_owned_closure_sample_t closure;
+    z_closure(&closure, subscription_trampoline, NULL,
+            (void *)(uintptr_t)SUBSCRIPTION_HANDLE(index, s->generation));
+    z_view_keyexpr_t ke;
+    if (z_view_keyexpr_from_str(&ke, s->keyexpr) < 0) {
+        z_drop(z_move(closure));
+        ZLOGE(TAG, "❗Invalid subscription key expression '%s'❗", s->keyexpr);
+        return false;
+    }
+    if (z_declare_subscriber(zs, out, z_loan(ke), z_move(closure), NULL) < 0) {
+        ZLOGE(TAG, "❗Unable to declare subscriber on '%s'❗", s->keyexpr);
+        return false;
+    }
+    return true;
+}
+
+#if ZENOH_HYBRID_ON
+/**
+ * @brief Declares slot index on the multicast session as well, if it is open
+ * and the key can match a routed key. Caller holds g_session_mutex.
+ */
+static void declare_mcast_subscription(size_t index) {
+    subscription_t *s = &g_subscriptions[index];
+    if (!g_mcast_open || s->mcast_declared || !hybrid_overlaps_udp(s->keyexpr)) { return; }
+    s->mcast_declared = subscribe_slot_on(z_loan(g_mcast_session), index, &s->mcast_subscriber);
+    if (s->mcast_declared) { ZLOGI(TAG, "📥 Subscriber on '%s' (multicast)", s->keyexpr); }
+}
+#endif
+
+/**
+ * @brief Declares the zenoh subscriber of slot index. Caller holds g_session_mutex.
+ * @return false if zenoh refused the subscriber.
+ */
+static bool declare_subscription(size_t index) {
+    subscription_t *s = &g_subscriptions[index];
+    if (!subscribe_slot_on(z_loan(session), index, &s->subscriber)) { return false; }
+    s->declared = true;
+    ZLOGI(TAG, "📥 Subscriber on '%s'", s->keyexpr);
+#if ZENOH_HYBRID_ON
+    declare_mcast_subscription(index);
+#endif
+    return true;
+}
 #endif
 
 #if PUBLISHER_ON
 static z_owned_publisher_t main_publisher;
 static bool g_publisher_declared = false;
+
+// Publisher registry, one lazily declared publisher per concrete key expression
+typedef struct {
+    bool in_use;
+    uint32_t hash;
+    char keyexpr[ZENOH_KEYEXPR_MAX_LEN];
+    z_owned_publisher_t publisher;
+} publisher_entry_t;
+
+static publisher_entry_t g_publishers[ZENOH_PUBLISHER_REGISTRY_SIZE];
+static SemaphoreHandle_t g_publishers_mutex = NULL;
 #endif
 
 #if QUERYABLE_ON
 static z_owned_queryable_t queryable;
+
+// Registered keys outside KEYEXPR_QUERYABLE get a queryable of their own
+typedef struct {
+    bool in_use;
+    bool declared;
+    char keyexpr[ZENOH_KEYEXPR_MAX_LEN];
+    z_owned_queryable_t queryable;
+} extra_queryable_t;
+
+static extra_queryable_t g_extra_queryables[ZENOH_EXTRA_QUERYABLES];
+static bool g_queryables_declared = false;
+#endif
+
+#if QUERYABLE_ON
+/**
+ * @brief Declares a queryable on keyexpr "/**" routed through client_query_handler.
+ * @return The zenoh result code (< 0 on failure).
+ */
+static int declare_queryable_helper(z_owned_queryable_t *out, const char *keyexpr) {
+    char ke_buf[ZENOH_KEYEXPR_MAX_LEN + 4];
+    snprintf(ke_buf, sizeof(ke_buf), "%s/**", keyexpr);
+    z_owned_closure_query_t query_closure;
+    z_closure(&query_closure, (void (*)(z_loaned_query_t *, void*))client_query_handler, NULL, NULL);
+    z_view_keyexpr_t ke_queryable;
+    z_view_keyexpr_from_str_unchecked(&ke_queryable, ke_buf);
+    int res = z_declare_queryable(z_loan(session), out, z_loan(ke_queryable), z_move(query_closure), NULL);
+    if (res < 0) {
+        ZLOGE(TAG, "❗Unable to declare queryable on '%s'❗", ke_buf);
+    } else {
+        ZLOGI(TAG, "💡 Queryable on '%s'", ke_buf);
+    }
+    return res;
+}
+
+// True if keyexpr is KEYEXPR_QUERYABLE or below it, i.e. served by the main queryable
+static bool under_main_queryable(const char *keyexpr) {
+    size_t n = strlen(KEYEXPR_QUERYABLE);
+    return strncmp(keyexpr, KEYEXPR_QUERYABLE, n) == 0 && (keyexpr[n] == '\0' || keyexpr[n] == '/');
+}
+
+static int extra_queryable_add(const char *keyexpr) {
+    extra_queryable_t *free_entry = NULL;
+    for (size_t i = 0; i < ZENOH_EXTRA_QUERYABLES; i++) {
+        extra_queryable_t *e = &g_extra_queryables[i];
+        if (e->in_use && strcmp(e->keyexpr, keyexpr) == 0) { return 0; }
+        if (!e->in_use && free_entry == NULL) { free_entry = e; }
+    }
+    if (free_entry == NULL) {
+        ZLOGE(TAG, "❗No queryable slot left for '%s' (ZENOH_EXTRA_QUERYABLES)❗", keyexpr);
+        return -1;
+    }
+    free_entry->in_use = true;
+    free_entry->declared = false;
+    strcpy(free_entry->keyexpr, keyexpr);
+    if (g_queryables_declared) {
+        free_entry->declared = declare_queryable_helper(&free_entry->queryable, keyexpr) >= 0;
+    }
+    return 0;
+}
+
+static void extra_queryable_remove(const char *keyexpr) {
+    for (size_t i = 0; i < ZENOH_EXTRA_QUERYABLES; i++) {
+        extra_queryable_t *e = &g_extra_queryables[i];
+        if (e->in_use && strcmp(e->keyexpr, keyexpr) == 0) {
+            if (e->declared) { z_drop(z_move(e->queryable)); }
+            e->in_use = false;
+            e->declared = false;
+        }
+    }
+}
 #endif
 
 /**
@@ -126,10 +876,10 @@ static z_owned_queryable_t queryable;
 #define PRINT_CONFIG_VALUE(cfg, key_macro, key_name) \
     do { \
         const char *value = zp_config_get(cfg, key_macro); \
-        ESP_LOGI("Z_CNFG", "  %-24s: %s", key_name, value ? value : "(not set)"); \
+        ZLOGI("Z_CNFG", "  %-24s: %s", key_name, value ? value : "(not set)"); \
     } while(0)
 static void print_zenoh_config(const z_loaned_config_t *config) {
-    ESP_LOGI("ZENOH_CONFIG", "--- Zenoh Configuration (queried values) ---");
+    ZLOGI("ZENOH_CONFIG", "--- Zenoh Configuration (queried values) ---");
     PRINT_CONFIG_VALUE(config, Z_CONFIG_MODE_KEY, "Mode");
     PRINT_CONFIG_VALUE(config, Z_CONFIG_CONNECT_KEY, "Connect Endpoints");
     PRINT_CONFIG_VALUE(config, Z_CONFIG_LISTEN_KEY, "Listen Endpoints");
@@ -141,7 +891,7 @@ static void print_zenoh_config(const z_loaned_config_t *config) {
     PRINT_CONFIG_VALUE(config, Z_CONFIG_SCOUTING_WHAT_KEY, "Scouting What");
     PRINT_CONFIG_VALUE(config, Z_CONFIG_SESSION_ZID_KEY, "Session ZID");
     PRINT_CONFIG_VALUE(config, Z_CONFIG_ADD_TIMESTAMP_KEY, "Add Timestamp");
-    ESP_LOGI("ZENOH_CONFIG", "------------------------------------------");
+    ZLOGI("ZENOH_CONFIG", "------------------------------------------");
 }
 
 /**
@@ -149,10 +899,10 @@ static void print_zenoh_config(const z_loaned_config_t *config) {
  * 
  * This function takes a reference to a Zenoh session, a pointer to a
  * Zenoh publisher object, and a key expression string. It declares a
- * publisher on the session with the given key expression. If the
- * declaration is successful, it logs a success message with the key
- * expression. If the declaration fails, it logs an error message with
- * the key expression.
+ * publisher on the session with the key's QoS profile (congestion control,
+ * priority, express). If the declaration is successful, it logs a success
+ * message with the key expression. If the declaration fails, it logs an
+ * error message with the key expression.
  * 
  * @param s Reference to the Zenoh session to declare the publisher on.
  * @param pub Pointer to the Zenoh publisher object to declare.
@@ -163,119 +913,464 @@ static z_result_t declare_publisher_helper(const z_loaned_session_t* s,
         z_owned_publisher_t *pub, const char *keyexpr) {
     z_view_keyexpr_t ke;
     z_view_keyexpr_from_str_unchecked(&ke, keyexpr);
-    z_result_t res = z_declare_publisher(s, pub, z_loan(ke), NULL);
-    if (res < 0) { ESP_LOGE(TAG, "❗Unable to declare publisher on '%s'❗", keyexpr); } 
-    else { ESP_LOGI(TAG, "📡 Publisher on '%s'", keyexpr); }
+    z_publisher_options_t opts;
+    zenoh_qos_publisher_options(keyexpr, &opts);
+    z_result_t res = z_declare_publisher(s, pub, z_loan(ke), &opts);
+    if (res < 0) { ZLOGE(TAG, "❗Unable to declare publisher on '%s'❗", keyexpr); } 
+    else { ZLOGI(TAG, "📡 Publisher on '%s' (#%08lx)", keyexpr, (unsigned long)zenoh_log_key_hash(keyexpr, strlen(keyexpr))); }
     return res;
 }
 
-
+#if PUBLISHER_ON
 /**
- * @brief Task function for the Zenoh client.
+ * @brief Finds the registry publisher for a key expression, declaring it on first use.
  *
- * This function is responsible for creating the Zenoh session, declaring
- * the necessary resources (e.g. subscriber, publisher, queryable), and
- * starting the read and lease tasks.
+ * Must be called with g_publishers_mutex held.
  *
- * @param arg Pointer to a z_data_handler_t function which will be called
- * whenever a new sample is received from a publisher.
+ * @param keyexpr Concrete key expression to publish on.
+ * @return Loaned publisher, or NULL when the key is too long, the registry is
+ * full or the declaration failed (callers then fall back to z_put).
  */
-static void zenoh_client_task(void *arg) {
-    z_data_handler_t data_handler = (z_data_handler_t)arg;
-    network_info_t net_info = active_network_interface("Z_IFACE");
-
-    bool sesson_opened = false;
-    while (!sesson_opened) { 
-        // Create a new config for EVERY attempt!
-        z_owned_config_t config;
-        z_config_default(&config);
-        /* Use the mode from config: "peer" or "client" */
-        zp_config_insert(z_loan_mut(config), Z_CONFIG_MODE_KEY, ZENOH_MODE);
-
-        /* 
-         * For UDP peer (multicast listen only) 
-         * The device MUST listen on the multicast address and attach
-         * the interface name (e.g. "#iface=st1"). 
-         * The multicast listener is the only locator required!
-         */
-        if (strcmp(ZENOH_PROTOCOL, "udp") == 0) {
-            const char *ip_to_use = NULL;
-            if (strlen(ZENOH_LISTEN_BROADCAST_IP) > 0) {
-                ip_to_use = ZENOH_LISTEN_BROADCAST_IP;
-            } else if (strlen(net_info.ip_address) > 0) {
-                ip_to_use = net_info.ip_address;
-            } else {
-                ip_to_use = "0.0.0.0";
-            }
-            /* Build listener: protocol/ip:port#iface=<iface> */
-            zenoh_utils_set_primary_listener(ZENOH_PROTOCOL, ip_to_use, ZENOH_PORT, net_info.interface_name);
-            zp_config_insert(z_loan_mut(config), Z_CONFIG_LISTEN_KEY, zenoh_utils_get_primary_listener());
-            ESP_LOGI(TAG, "🌐 PEER LISTENS on: %s (UDP)", zenoh_utils_get_primary_listener());
-
-        /* TCP unicast (consumer/server)  */ 
-        } else if (strcmp(ZENOH_PROTOCOL, "tcp") == 0) {
-            zp_config_insert(z_loan_mut(config), Z_CONFIG_MULTICAST_SCOUTING_KEY, "false");
-#if I_AM_CONSUMER_OR_SERVER == 1 // consumer: connect to server IP
-            char connect_endpoint[64];
-            snprintf(connect_endpoint, sizeof(connect_endpoint), "tcp/%s:%s", 
-                    ZENOH_SERVER_IP, ZENOH_PORT);
-            zp_config_insert(z_loan_mut(config), Z_CONFIG_CONNECT_KEY, connect_endpoint);
-            ESP_LOGI(TAG, "🔗 CONSUMER CONNECTS to: %s (TCP)", connect_endpoint);
-#else // server: listen on its own IP and attach iface
-            /* Use device IP + iface for TCP server listener. zenoh expects the iface
-            * appended (e.g. "#iface=st1"). Use zenoh_utils to build the listener.
-            */
-            zenoh_utils_set_primary_listener(ZENOH_PROTOCOL, net_info.ip_address, 
-                        ZENOH_PORT, net_info.interface_name);
-            zp_config_insert(z_loan_mut(config), Z_CONFIG_LISTEN_KEY, 
-                             zenoh_utils_get_primary_listener());
-            ESP_LOGI(TAG, "🌐 SERVER LISTENS on: %s (TCP)", 
-                        zenoh_utils_get_primary_listener());
-#endif
-        }
-        print_zenoh_config(z_loan(config)); // can be disabled
-        z_result_t res = z_open(&session, z_move(config), NULL);
-        if (res < 0) {
-            // Map common zenoh-pico error codes to readable strings. DEBUGGING peer TCP
-            const char *res_str = "UNKNOWN_ERROR";
-            switch (res) {
-                case _Z_ERR_TRANSPORT_NOT_AVAILABLE: res_str = "TRANSPORT_NOT_AVAILABLE"; break;
-                case _Z_ERR_TRANSPORT_OPEN_FAILED: res_str = "TRANSPORT_OPEN_FAILED"; break;
-                case _Z_ERR_TRANSPORT_OPEN_SN_RESOLUTION: res_str = "TRANSPORT_OPEN_SN_RESOLUTION"; break;
-                case _Z_ERR_CONFIG_LOCATOR_INVALID: res_str = "CONFIG_LOCATOR_INVALID"; break;
-                case _Z_ERR_CONFIG_UNSUPPORTED_CLIENT_MULTICAST: res_str = "CONFIG_UNSUPPORTED_CLIENT_MULTICAST"; break;
-                case _Z_ERR_CONFIG_UNSUPPORTED_PEER_UNICAST: res_str = "CONFIG_UNSUPPORTED_PEER_UNICAST"; break;
-                case _Z_ERR_GENERIC: res_str = "GENERIC_ERROR"; break;
-                default: break;
-            }
-            ESP_LOGE(TAG, "❗Zenoh session failed: %d (%s), retry...❗", res, res_str);
-            vTaskDelay(15000 / portTICK_PERIOD_MS); // Retry after 15 sec
-        } else {
-            sesson_opened = true;
+static const z_loaned_publisher_t *publisher_registry_get(const char *keyexpr) {
+    uint32_t h = zenoh_log_key_hash(keyexpr, strlen(keyexpr)); // lookups mostly compare integers
+    publisher_entry_t *free_slot = NULL;
+    for (size_t i = 0; i < ZENOH_PUBLISHER_REGISTRY_SIZE; i++) {
+        publisher_entry_t *e = &g_publishers[i];
+        if (!e->in_use) {
+            if (free_slot == NULL) { free_slot = e; }
+        } else if (e->hash == h && strcmp(e->keyexpr, keyexpr) == 0) {
+            return z_loan(e->publisher);
         }
     }
+    if (free_slot == NULL || strlen(keyexpr) >= sizeof(free_slot->keyexpr)) {
+        return NULL;
+    }
+    if (declare_publisher_helper(z_loan(session), &free_slot->publisher, keyexpr) < 0) {
+        return NULL;
+    }
+    strcpy(free_slot->keyexpr, keyexpr);
+    free_slot->hash = h;
+    free_slot->in_use = true;
+    return z_loan(free_slot->publisher);
+}
 
-    ESP_LOGI(TAG, "✅ Zenoh Session Opened Successfully!✅");
-    xEventGroupSetBits(app_event_group, ZENOH_CONNECTED_BIT);
-
-    char session_zid_str[sizeof(z_id_t) * 2 + 1] = {0};
-    z_id_t sid = z_info_zid(z_loan(session));
-    format_zid(&sid, session_zid_str, sizeof(session_zid_str));
-    ESP_LOGI(TAG, "My Zenoh ID is: %s", session_zid_str);
-    
-    zp_start_read_task(z_loan_mut(session), NULL);
-    zp_start_lease_task(z_loan_mut(session), NULL);
+/**
+ * @brief Undeclares every registry publisher. Safe to call when empty.
+ */
+static void publisher_registry_clear() {
+    if (g_publishers_mutex == NULL) { return; }
+    xSemaphoreTake(g_publishers_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < ZENOH_PUBLISHER_REGISTRY_SIZE; i++) {
+        if (g_publishers[i].in_use) {
+            z_drop(z_move(g_publishers[i].publisher));
+            g_publishers[i].in_use = false;
+        }
+    }
+    xSemaphoreGive(g_publishers_mutex);
+}
+#endif //PUBLISHER_ON
 
-#if SUBSCRIBER_ON
-    z_owned_closure_sample_t sub_closure; 
-    z_closure(&sub_closure, data_handler, NULL, app_event_group);
+// Publication that never reached zenoh (no session or publisher, no memory)
+static void note_publish_dropped() {
+#if ZENOH_STATS_ON
+    zenoh_stats_record_drop();
+#endif
+}
+
+// True for keys on KEYEXPR_PUB, the node's data traffic
+static bool is_data_key(const char *keyexpr) {
+    size_t n = sizeof(KEYEXPR_PUB) - 1;
+    return strncmp(keyexpr, KEYEXPR_PUB, n) == 0 && (keyexpr[n] == '\0' || keyexpr[n] == '/');
+}
+
+// Feeds the supervisor's lost-session detection (failures of the session put on),
+// the adaptive heartbeat and the stats
+static void note_put_result(z_result_t res, bool is_data, size_t bytes, int64_t started_us,
+        std::atomic<uint32_t> &failures) {
+#if ZENOH_STATS_ON
+    zenoh_stats_record_put(bytes, res, (uint32_t)(esp_timer_get_time() - started_us));
+#else
+    (void)bytes;
+    (void)started_us;
+#endif
+    if (res < 0) {
+        failures.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        failures.store(0, std::memory_order_relaxed);
+#if HEARTBEAT_ON
+        if (is_data) { zenoh_heartbeat_note_publish(); }
+#endif
+    }
+}
+
+// Session put with the key's QoS profile; payload and attachment are consumed
+static z_result_t put_on(const z_loaned_session_t *zs, const char *keyexpr, z_owned_bytes_t *payload,
+        const z_publisher_put_options_t *put_opts) {
+    const qos_profile_t *qos = qos_profile_for(keyexpr);
+    z_put_options_t opts;
+    z_put_options_default(&opts);
+    opts.congestion_control = qos->congestion_control;
+    opts.priority = qos->priority;
+    opts.is_express = qos->is_express;
+    opts.encoding = put_opts->encoding;
+    opts.timestamp = put_opts->timestamp;
+    opts.attachment = put_opts->attachment;
     z_view_keyexpr_t ke;
-    z_view_keyexpr_from_str_unchecked(&ke, KEYEXPR_SUB "/**"); 
-    if (z_declare_subscriber(z_loan(session), &main_subscriber, z_loan(ke), z_move(sub_closure), NULL) < 0) {
-        ESP_LOGE(TAG, "❗Unable to declare subscriber on '%s/**'❗", KEYEXPR_SUB);
+    z_view_keyexpr_from_str_unchecked(&ke, keyexpr);
+    return z_put(zs, z_loan(ke), z_move(*payload), &opts);
+}
+
+// Releases the g_session_mutex publish_owned_bytes() took for a put
+static void publish_unlock() {
+#if ZENOH_LOCAL_DELIVERY_ON
+    g_local_put_task.store(NULL, std::memory_order_relaxed);
+#endif
+    xSemaphoreGive(g_session_mutex);
+}
+
+/**
+ * @brief Publishes an already built payload on a key expression.
+ *
+ * Goes through the publisher registry so the key is resolved and declared
+ * once; falls back to z_put when no registry publisher is available, carrying
+ * the key's QoS profile and the caller's put options over to z_put_options_t.
+ * The payload (and any moved option fields) is always consumed.
+ *
+ * @param keyexpr Key expression to publish on.
+ * @param payload Owned payload, moved into zenoh.
+ * @param options Optional put options (encoding, attachment, timestamp), may be NULL.
+ * @return Zenoh result code of the put.
+ */
+static z_result_t publish_owned_bytes(const char *keyexpr, z_owned_bytes_t *payload,
+        const z_publisher_put_options_t *options) {
+    z_result_t res = _Z_ERR_GENERIC;
+    xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+    if (!g_session_open) {
+        xSemaphoreGive(g_session_mutex);
+        z_drop(z_move(*payload));
+        note_publish_dropped();
+        return _Z_ERR_TRANSPORT_NOT_AVAILABLE;
+    }
+#if ZENOH_LOCAL_DELIVERY_ON
+    g_local_put_task.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+#endif
+    size_t bytes = z_bytes_len(z_loan(*payload));
+    z_publisher_put_options_t put_opts;
+    if (options != NULL) {
+        put_opts = *options;
     } else {
-        ESP_LOGI(TAG, "📥 Subscriber on '%s/**'", KEYEXPR_SUB);
+        z_publisher_put_options_default(&put_opts);
+    }
+    bool is_data = is_data_key(keyexpr);
+#if ZENOH_TRACE_ON
+    // Stamped under g_session_mutex, so sequence numbers follow the wire order.
+    // The put serializes before returning and local samples get a copy, see
+    // dispatch_local_copy(), so the buffer can live on the stack.
+    uint8_t trace_buf[ZENOH_ATTACH_MAX_LEN];
+    z_owned_bytes_t traced;
+    size_t trace_len;
+    if (is_data && put_opts.attachment == NULL && (trace_len = zenoh_trace_stamp(trace_buf, sizeof(trace_buf), NULL)) > 0
+        && z_bytes_from_static_buf(&traced, trace_buf, trace_len) == Z_OK) {
+        put_opts.attachment = z_move(traced);
+    }
+#endif
+#if HEARTBEAT_ON && ZENOH_HB_PIGGYBACK_ON
+    // Liveness rides on data traffic unless the caller brings its own attachment
+    z_owned_bytes_t liveness;
+    if (is_data && put_opts.attachment == NULL && zenoh_attachment_liveness(&liveness)) {
+        put_opts.attachment = z_move(liveness);
+    }
+#endif
+    int64_t started_us = esp_timer_get_time();
+#if ZENOH_HYBRID_ON
+    if (g_mcast_open && hybrid_routes_udp(keyexpr)) {
+        res = put_on(z_loan(g_mcast_session), keyexpr, payload, &put_opts);
+        note_put_result(res, is_data, bytes, started_us, g_mcast_put_failures);
+        publish_unlock();
+        return res;
+    }
+#endif
+#if PUBLISHER_ON
+    xSemaphoreTake(g_publishers_mutex, portMAX_DELAY);
+    const z_loaned_publisher_t *pub = publisher_registry_get(keyexpr);
+    if (pub != NULL) {
+        res = z_publisher_put(pub, z_move(*payload), &put_opts);
+        xSemaphoreGive(g_publishers_mutex);
+        note_put_result(res, is_data, bytes, started_us, g_put_failures);
+        publish_unlock();
+        return res;
+    }
+    xSemaphoreGive(g_publishers_mutex);
+#endif
+    res = put_on(z_loan(session), keyexpr, payload, &put_opts);
+    note_put_result(res, is_data, bytes, started_us, g_put_failures);
+    publish_unlock();
+    return res;
+}
+
+/**
+ * @brief Resolves the active interface and builds the session config from it.
+ *
+ * Only called when the endpoint cache is empty or stale, see open_session().
+ * connect_endpoint is the locator a TCP consumer connects to.
+ */
+static void build_config(z_owned_config_t *out, const char *connect_endpoint) {
+    network_info_t net_info = active_network_interface("Z_IFACE");
+    z_owned_config_t &config = *out;
+    z_config_default(&config);
+    /* Use the mode from config: "peer" or "client" */
+    const zenoh_settings_t *cfg = zenoh_settings();
+    zp_config_insert(z_loan_mut(config), Z_CONFIG_MODE_KEY, cfg->mode);
+
+    /* 
+     * For UDP peer (multicast listen only) 
+     * The device MUST listen on the multicast address and attach
+     * the interface name (e.g. "#iface=st1"). 
+     * The multicast listener is the only locator required!
+     */
+    if (strcmp(cfg->protocol, "udp") == 0) {
+        const char *ip_to_use = NULL;
+        if (strlen(cfg->listen_ip) > 0) {
+            ip_to_use = cfg->listen_ip;
+        } else if (strlen(net_info.ip_address) > 0) {
+            ip_to_use = net_info.ip_address;
+        } else {
+            ip_to_use = "0.0.0.0";
+        }
+        /* Build listener: protocol/ip:port#iface=<iface> */
+        zenoh_utils_set_primary_listener(cfg->protocol, ip_to_use, cfg->port, net_info.interface_name);
+        zp_config_insert(z_loan_mut(config), Z_CONFIG_LISTEN_KEY, zenoh_utils_get_primary_listener());
+        ZLOGI(TAG, "🌐 PEER LISTENS on: %s (UDP)", zenoh_utils_get_primary_listener());
+
+    /* TCP unicast (consumer/server)  */ 
+    } else if (strcmp(cfg->protocol, "tcp") == 0) {
+        zp_config_insert(z_loan_mut(config), Z_CONFIG_MULTICAST_SCOUTING_KEY, "false");
+#if I_AM_CONSUMER_OR_SERVER == 1 // consumer: connect to the selected endpoint
+        zp_config_insert(z_loan_mut(config), Z_CONFIG_CONNECT_KEY, connect_endpoint);
+        ZLOGI(TAG, "🔗 CONSUMER CONNECTS to: %s (TCP)", connect_endpoint);
+#else // server: listen on its own IP and attach iface
+        /* Use device IP + iface for TCP server listener. zenoh expects the iface
+        * appended (e.g. "#iface=st1"). Use zenoh_utils to build the listener.
+        */
+        zenoh_utils_set_primary_listener(cfg->protocol, net_info.ip_address, 
+                    cfg->port, net_info.interface_name);
+        zp_config_insert(z_loan_mut(config), Z_CONFIG_LISTEN_KEY, 
+                         zenoh_utils_get_primary_listener());
+        ZLOGI(TAG, "🌐 SERVER LISTENS on: %s (TCP)", 
+                    zenoh_utils_get_primary_listener());
+#endif
+    }
+    print_zenoh_config(z_loan(config)); // can be disabled
+}
+
+#if !ZENOH_PLATFORM_HOST
+// IP_EVENT handler: any address change makes the cached endpoints stale
+static void ip_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    (void)arg; (void)base; (void)data;
+    ZLOGD(TAG, "IP event %ld, endpoint cache invalidated", (long)id);
+    g_config_stale.store(true, std::memory_order_relaxed);
+}
+#endif
+
+/**
+ * @brief Opens the session from a copy of the cached config.
+ *
+ * z_open consumes its config, so every attempt opens a clone; the config is
+ * only resolved again after an IP_EVENT or when the endpoint changes.
+ * @return The z_open result code (< 0 on failure).
+ */
+static z_result_t open_session(const char *connect_endpoint) {
+    const char *endpoint_key = connect_endpoint != NULL ? connect_endpoint : "";
+    if (!g_config_cached || g_config_stale.exchange(false) || strcmp(g_cached_endpoint, endpoint_key) != 0) {
+        if (g_config_cached) { z_drop(z_move(g_cached_config)); }
+        build_config(&g_cached_config, connect_endpoint);
+        snprintf(g_cached_endpoint, sizeof(g_cached_endpoint), "%s", endpoint_key);
+        g_config_cached = true;
+    }
+    z_owned_config_t config;
+    if (z_config_clone(&config, z_loan(g_cached_config)) != Z_OK) {
+        ZLOGE(TAG, "❗Failed to copy the cached config❗");
+        return _Z_ERR_SYSTEM_OUT_OF_MEMORY;
+    }
+    z_result_t res = z_open(&session, z_move(config), NULL);
+    if (res < 0) {
+        // Map common zenoh-pico error codes to readable strings. DEBUGGING peer TCP
+        const char *res_str = "UNKNOWN_ERROR";
+        switch (res) {
+            case _Z_ERR_TRANSPORT_NOT_AVAILABLE: res_str = "TRANSPORT_NOT_AVAILABLE"; break;
+            case _Z_ERR_TRANSPORT_OPEN_FAILED: res_str = "TRANSPORT_OPEN_FAILED"; break;
+            case _Z_ERR_TRANSPORT_OPEN_SN_RESOLUTION: res_str = "TRANSPORT_OPEN_SN_RESOLUTION"; break;
+            case _Z_ERR_CONFIG_LOCATOR_INVALID: res_str = "CONFIG_LOCATOR_INVALID"; break;
+            case _Z_ERR_CONFIG_UNSUPPORTED_CLIENT_MULTICAST: res_str = "CONFIG_UNSUPPORTED_CLIENT_MULTICAST"; break;
+            case _Z_ERR_CONFIG_UNSUPPORTED_PEER_UNICAST: res_str = "CONFIG_UNSUPPORTED_PEER_UNICAST"; break;
+            case _Z_ERR_GENERIC: res_str = "GENERIC_ERROR"; break;
+            default: break;
+        }
+        ZLOGE(TAG, "❗Zenoh session failed: %d (%s), retry...❗", res, res_str);
+    }
+    return res;
+}
+
+/**
+ * @brief Starts the read and lease tasks of a session.
+ *
+ * ZENOH_READ_TASK_* / ZENOH_LEASE_TASK_* set their stack and priority. The
+ * host port takes pthread attributes, so it keeps zenoh-pico's defaults.
+ */
+static void start_session_tasks(z_loaned_session_t *zs) {
+#if ZENOH_PLATFORM_HOST
+    zp_start_read_task(zs, NULL);
+    zp_start_lease_task(zs, NULL);
+#else
+    // Static in case the port reads them after the call returns
+    static z_task_attr_t read_attr;
+    static z_task_attr_t lease_attr;
+    memset(&read_attr, 0, sizeof(read_attr));
+    read_attr.name = "zenoh_read";
+    read_attr.priority = ZENOH_READ_TASK_PRIO;
+    read_attr.stack_depth = ZENOH_READ_TASK_STACK;
+    memset(&lease_attr, 0, sizeof(lease_attr));
+    lease_attr.name = "zenoh_lease";
+    lease_attr.priority = ZENOH_LEASE_TASK_PRIO;
+    lease_attr.stack_depth = ZENOH_LEASE_TASK_STACK;
+    zp_task_read_options_t read_opts;
+    zp_task_read_options_default(&read_opts);
+    read_opts.task_attributes = &read_attr;
+    zp_start_read_task(zs, &read_opts);
+    zp_task_lease_options_t lease_opts;
+    zp_task_lease_options_default(&lease_opts);
+    lease_opts.task_attributes = &lease_attr;
+    zp_start_lease_task(zs, &lease_opts);
+#endif
+}
+
+#if ZENOH_HYBRID_ON
+/**
+ * @brief Opens the multicast session and declares the subscribers that can
+ * match a routed key on it. Only meaningful next to a TCP session.
+ * @return true if the session is open.
+ */
+static bool mcast_open() {
+    network_info_t net_info = active_network_interface("Z_MCAST");
+    char listen[ZENOH_SCOUT_LOCATOR_MAX_LEN];
+    snprintf(listen, sizeof(listen), "udp/%s:%s#iface=%s", ZENOH_UDP_MULTICAST_IP, ZENOH_HYBRID_PORT,
+            net_info.interface_name);
+    z_owned_config_t config;
+    z_config_default(&config);
+    zp_config_insert(z_loan_mut(config), Z_CONFIG_MODE_KEY, "peer");
+    zp_config_insert(z_loan_mut(config), Z_CONFIG_LISTEN_KEY, listen);
+    zp_config_insert(z_loan_mut(config), Z_CONFIG_MULTICAST_SCOUTING_KEY, "false");
+    z_result_t res = z_open(&g_mcast_session, z_move(config), NULL);
+    if (res < 0) {
+        ZLOGW(TAG, "⚠️ Multicast session on %s failed: %d, keys stay on TCP ⚠️", listen, res);
+        return false;
+    }
+    start_session_tasks(z_loan_mut(g_mcast_session));
+
+    xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+    g_mcast_open = true;
+    g_mcast_put_failures = 0;
+#if SUBSCRIBER_ON
+    if (g_data_handler != NULL && hybrid_overlaps_udp(KEYEXPR_SUB "/**")) {
+        z_owned_closure_sample_t sub_closure;
+        z_closure(&sub_closure, subscriber_trampoline, NULL, app_event_group);
+        z_view_keyexpr_t ke;
+        z_view_keyexpr_from_str_unchecked(&ke, KEYEXPR_SUB "/**");
+        g_mcast_main_subscriber_declared = z_declare_subscriber(z_loan(g_mcast_session), &g_mcast_main_subscriber,
+                z_loan(ke), z_move(sub_closure), NULL) >= 0;
+    }
+    for (size_t i = 0; i < ZENOH_MAX_SUBSCRIPTIONS; i++) {
+        if (g_subscriptions[i].in_use) { declare_mcast_subscription(i); }
+    }
+#endif
+    xSemaphoreGive(g_session_mutex);
+    ZLOGI(TAG, "🛰️ Multicast session on %s", listen);
+    return true;
+}
+
+/**
+ * @brief Takes the multicast session out of routing, first step of closing it.
+ * Caller holds g_session_mutex; puts and declarations stop using the session.
+ * @return true if it was open, then mcast_close_finish() must follow.
+ */
+static bool mcast_detach_locked() {
+    bool was_open = g_mcast_open;
+    g_mcast_open = false;
+    return was_open;
+}
+
+/**
+ * @brief Stops the multicast session tasks, drops its subscribers and closes it.
+ *
+ * Called without g_session_mutex: the read task may be in a callback waiting
+ * for it. The heartbeat must have been stopped if it is on this session.
+ */
+static void mcast_close_finish() {
+    zp_stop_read_task(z_loan_mut(g_mcast_session));
+    zp_stop_lease_task(z_loan_mut(g_mcast_session));
+    xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+#if SUBSCRIBER_ON
+    for (size_t i = 0; i < ZENOH_MAX_SUBSCRIPTIONS; i++) {
+        if (g_subscriptions[i].mcast_declared) { z_drop(z_move(g_subscriptions[i].mcast_subscriber)); }
+        g_subscriptions[i].mcast_declared = false;
+    }
+    if (g_mcast_main_subscriber_declared) { z_drop(z_move(g_mcast_main_subscriber)); }
+    g_mcast_main_subscriber_declared = false;
+#endif
+    z_drop(z_move(g_mcast_session));
+    xSemaphoreGive(g_session_mutex);
+}
+#endif // ZENOH_HYBRID_ON
+
+#if HEARTBEAT_ON
+#if ZENOH_HYBRID_ON
+// The heartbeat subscribers are on g_mcast_session, see heartbeat_session()
+static bool g_heartbeat_on_mcast = false;
+#endif
+
+// The session HEARTBEAT_CHANNEL is routed to, for zenoh_heartbeat_init()
+static z_loaned_session_t *heartbeat_session() {
+#if ZENOH_HYBRID_ON
+    g_heartbeat_on_mcast = g_mcast_open && hybrid_routes_udp(HEARTBEAT_CHANNEL);
+    if (g_heartbeat_on_mcast) { return z_loan_mut(g_mcast_session); }
+#endif
+    return z_loan_mut(session);
+}
+#endif
+
+/**
+ * @brief Declares everything that lives on the session: subscriber, publishers,
+ * queryables and heartbeat. Called after every (re)open.
+ */
+static void declare_resources(z_data_handler_t data_handler) {
+#if ZENOH_TRANSFER_ON
+    zenoh_transfer_init(app_event_group);
+#endif
+
+#if SUBSCRIBER_ON
+    z_owned_closure_sample_t sub_closure; 
+    g_data_handler = data_handler;
+#if ZENOH_DISPATCH_ON
+    zenoh_dispatch_start(deliver_sample, app_event_group);
+#endif
+    if (data_handler != NULL) {
+        z_closure(&sub_closure, subscriber_trampoline, NULL, app_event_group);
+        z_view_keyexpr_t ke;
+        z_view_keyexpr_from_str_unchecked(&ke, KEYEXPR_SUB "/**"); 
+        if (z_declare_subscriber(z_loan(session), &main_subscriber, z_loan(ke), z_move(sub_closure), NULL) < 0) {
+            ZLOGE(TAG, "❗Unable to declare subscriber on '%s/**'❗", KEYEXPR_SUB);
+        } else {
+            g_main_subscriber_declared = true;
+            ZLOGI(TAG, "📥 Subscriber on '%s/**'", KEYEXPR_SUB);
+        }
+    }
+
+    // Subscriptions made before the session (re)opened; new ones declare themselves
+    xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < ZENOH_MAX_SUBSCRIPTIONS; i++) {
+        if (g_subscriptions[i].in_use && !g_subscriptions[i].declared) { declare_subscription(i); }
     }
+    xSemaphoreGive(g_session_mutex);
 #endif //SUBSCRIBER_ON
 
 #if PUBLISHER_ON
@@ -285,70 +1380,619 @@ static void zenoh_client_task(void *arg) {
 #endif //PUBLISHER_ON
 
 #if QUERYABLE_ON && I_AM_CONSUMER_OR_SERVER == 1
-    z_owned_closure_query_t query_closure;
-    z_closure(&query_closure, (void (*)(z_loaned_query_t *, void*))client_query_handler, NULL, NULL);
-    z_view_keyexpr_t ke_queryable;
-    z_view_keyexpr_from_str_unchecked(&ke_queryable, KEYEXPR_QUERYABLE "/**");
-    if (z_declare_queryable(z_loan(session), &queryable, z_loan(ke_queryable), z_move(query_closure), NULL) < 0) {
-        ESP_LOGE(TAG, "❗Unable to declare queryable on '%s/**'❗", KEYEXPR_QUERYABLE);
-    } else {
-        ESP_LOGI(TAG, "💡 Queryable on '%s/**'", KEYEXPR_QUERYABLE);
+    // Under the lock zenoh_register_queryable() takes for the extra table
+    xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+    if (declare_queryable_helper(&queryable, KEYEXPR_QUERYABLE) >= 0) {
+        for (size_t i = 0; i < ZENOH_EXTRA_QUERYABLES; i++) {
+            if (g_extra_queryables[i].in_use) {
+                g_extra_queryables[i].declared = declare_queryable_helper(&g_extra_queryables[i].queryable,
+                        g_extra_queryables[i].keyexpr) >= 0;
+            }
+        }
+        g_queryables_declared = true;
     }
+    xSemaphoreGive(g_session_mutex);
+#endif
+
+#if ZENOH_HYBRID_ON
+    if (zenoh_settings_is_tcp()) { mcast_open(); } // a UDP session is multicast already
 #endif
 
 #if HEARTBEAT_ON
-    zenoh_heartbeat_init(z_loan_mut(session), app_event_group);
+    zenoh_heartbeat_init(heartbeat_session(), app_event_group);
+#endif
+}
+
+/**
+ * @brief Undeclares every session resource and closes the session.
+ *
+ * g_session_open is cleared first, so new publishes are dropped. The heartbeat,
+ * read and lease tasks are stopped without g_session_mutex, since a callback of
+ * the read task or a heartbeat put may be waiting for it; the resources are
+ * dropped under it again.
+ */
+static void close_session() {
+    xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+    bool was_open = g_session_open;
+    g_session_open = false;
+#if ZENOH_HYBRID_ON
+    bool mcast_was_open = mcast_detach_locked();
+#endif
+    xSemaphoreGive(g_session_mutex);
+    if (!was_open) { return; }
+#if HEARTBEAT_ON
+    zenoh_heartbeat_stop(); // before either session it is declared on closes
+#endif
+#if ZENOH_HYBRID_ON
+    if (mcast_was_open) { mcast_close_finish(); }
 #endif
-    
-    ESP_LOGD(TAG, "All Zenoh resources declared.");
+    zp_stop_read_task(z_loan_mut(session));
+    zp_stop_lease_task(z_loan_mut(session));
+
+    xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+#if PUBLISHER_ON
+    publisher_registry_clear();
+    if (g_publisher_declared) { z_drop(z_move(main_publisher)); }
+    g_publisher_declared = false;
+#endif
+
+#if QUERYABLE_ON
+    if (g_queryables_declared) {
+        for (size_t i = 0; i < ZENOH_EXTRA_QUERYABLES; i++) {
+            if (g_extra_queryables[i].declared) { z_drop(z_move(g_extra_queryables[i].queryable)); }
+            g_extra_queryables[i].declared = false;
+        }
+        z_drop(z_move(queryable));
+        g_queryables_declared = false;
+    }
+#endif
+
+#if SUBSCRIBER_ON
+    for (size_t i = 0; i < ZENOH_MAX_SUBSCRIPTIONS; i++) {
+        if (g_subscriptions[i].declared) { z_drop(z_move(g_subscriptions[i].subscriber)); }
+        g_subscriptions[i].declared = false;
+    }
+    if (g_main_subscriber_declared) { z_drop(z_move(main_subscriber)); }
+    g_main_subscriber_declared = false;
+#endif
+    z_drop(z_move(session));
+    g_put_failures = 0;
+    xSemaphoreGive(g_session_mutex);
+}
+
+#if I_AM_CONSUMER_OR_SERVER == 1
+/**
+ * @brief Endpoint to try at a given position of a connect pass.
+ *
+ * A fixed endpoint from the runtime settings is the only one tried. Otherwise
+ * rank 0 starts a pass: the configured endpoints are probed and, with
+ * SCOUT_ON, the best scouted locator goes first. If no configured endpoint
+ * answered and the first scout round is still running, it is waited for.
+ * @return NULL once the pass is over.
+ */
+static const char *connect_endpoint_at(size_t rank) {
+    const char *fixed = zenoh_settings()->connect;
+    if (fixed[0] != '\0') { return rank == 0 ? fixed : NULL; } // set in the field, no probing
+    if (rank == 0) {
+        zenoh_endpoints_probe();
+#if SCOUT_ON
+        if (!zenoh_endpoint_get(0)->reachable) {
+            xEventGroupWaitBits(app_event_group, ZENOH_SCOUT_DONE_BIT, pdFALSE, pdFALSE,
+                    pdMS_TO_TICKS(ZENOH_SCOUT_TIMEOUT_MS));
+        }
+        g_have_scouted = zenoh_scout_best_locator(g_scouted_endpoint, sizeof(g_scouted_endpoint));
+#endif
+    }
+#if SCOUT_ON
+    if (g_have_scouted) {
+        if (rank == 0) { return g_scouted_endpoint; }
+        rank--;
+    }
+#endif
+    const zenoh_endpoint_t *ep = zenoh_endpoint_get(rank);
+    return ep != NULL ? ep->locator : NULL;
+}
+#endif
+
+#if ZENOH_STATS_ON && ZENOH_STATS_PUBLISH_PERIOD_MS > 0
+/**
+ * @brief Publishes zenoh_get_stats() as JSON on key. Runs in the supervisor task.
+ */
+static void publish_stats(const char *key) {
+    zenoh_stats_t stats;
+    zenoh_get_stats(&stats);
+    char *json = (char *)malloc(ZENOH_STATS_PAYLOAD_MAX);
+    if (json == NULL) { return; }
+    int len = zenoh_stats_format(&stats, json, ZENOH_STATS_PAYLOAD_MAX);
+    if (len >= ZENOH_STATS_PAYLOAD_MAX) {
+        ZLOGW(TAG, "Stats truncated, raise ZENOH_STATS_PAYLOAD_MAX to %d", len + 1);
+        free(json);
+        return;
+    }
+    z_owned_bytes_t payload;
+    if (z_bytes_from_buf(&payload, (uint8_t *)json, (size_t)len, payload_deleter, (void *)1) != Z_OK) {
+        free(json);
+        return;
+    }
+    publish_owned_bytes(key, &payload, NULL);
+}
+#endif
+
+// Equal jitter: half the backoff plus a random share of the other half
+static uint32_t jittered_ms(uint32_t backoff_ms) {
+    return backoff_ms / 2 + zenoh_platform_random() % (backoff_ms / 2 + 1);
+}
+
+// The session is gone when zenoh closed its transport or puts keep failing
+static bool session_lost() {
+    return z_session_is_closed(z_loan(session)) || g_put_failures >= ZENOH_SUPERVISOR_PUT_FAILURES;
+}
+
+// Supervisor state kept between runs of zenoh_client_task, see supervisor_tick()
+static z_data_handler_t g_client_data_handler = NULL;
+static TimerHandle_t g_supervisor_timer = NULL;
+static std::atomic<bool> g_supervisor_stopping(false);
+static std::atomic<bool> g_supervisor_busy(false); // a round is spawned or running
+static SemaphoreHandle_t g_supervisor_exit = NULL; // given as a round ends, see zenoh_client_stop()
+#if ZENOH_STATS_ON && ZENOH_STATS_PUBLISH_PERIOD_MS > 0
+static char g_stats_key[ZENOH_KEYEXPR_MAX_LEN];
+static TickType_t g_stats_due;
+#endif
+#if ZENOH_HYBRID_ON
+static TickType_t g_mcast_retry_due;
+#endif
+
+// Deadline reached, in ticks modulo wrap around
+static bool tick_reached(TickType_t due) {
+    return (int32_t)(xTaskGetTickCount() - due) >= 0;
+}
+
+#if ZENOH_HYBRID_ON
+// The multicast session needs closing (lost) or reopening (retry period over)
+static bool hybrid_due() {
+    if (!zenoh_settings_is_tcp()) { return false; }
+    if (g_mcast_open) {
+        return z_session_is_closed(z_loan(g_mcast_session)) || g_mcast_put_failures >= ZENOH_SUPERVISOR_PUT_FAILURES;
+    }
+    return tick_reached(g_mcast_retry_due);
+}
+
+/**
+ * @brief Closes a lost multicast session or retries a closed one.
+ *
+ * A lost multicast session is closed and its keys fall back to TCP (the
+ * heartbeat moves with them); it is reopened every ZENOH_HYBRID_RETRY_MS.
+ * The TCP session keeps running either way.
+ */
+static void hybrid_supervise() {
+    if (!hybrid_due()) { return; }
+    g_mcast_retry_due = xTaskGetTickCount() + pdMS_TO_TICKS(ZENOH_HYBRID_RETRY_MS);
+    if (g_mcast_open) {
+        ZLOGW(TAG, "⚠️ Multicast session lost, its keys fall back to TCP ⚠️");
+        xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+        bool was_open = mcast_detach_locked();
+        xSemaphoreGive(g_session_mutex);
+#if HEARTBEAT_ON
+        // Its subscribers are on the multicast session, stopped before it closes
+        bool move_heartbeat = g_heartbeat_on_mcast;
+        if (move_heartbeat) { zenoh_heartbeat_stop(); }
+#endif
+        if (was_open) { mcast_close_finish(); }
+#if HEARTBEAT_ON
+        if (move_heartbeat) { zenoh_heartbeat_init(heartbeat_session(), app_event_group); }
+#endif
+        return;
+    }
+    if (mcast_open()) {
+#if HEARTBEAT_ON
+        if (hybrid_routes_udp(HEARTBEAT_CHANNEL)) {
+            zenoh_heartbeat_stop();
+            zenoh_heartbeat_init(heartbeat_session(), app_event_group);
+        }
+#endif
+    }
+}
+#endif
+
+/**
+ * @brief Opens the session and declares all resources.
+ *
+ * z_open is retried with jittered exponential backoff; a TCP consumer walks
+ * the probed endpoint list first and backs off once every endpoint failed.
+ * Gives up between attempts once zenoh_client_stop() is called.
+ */
+static void supervisor_connect() {
+    uint32_t backoff_ms = ZENOH_RECONNECT_BACKOFF_MIN_MS;
+    size_t rank = 0; // next endpoint to try, in probe order
+
+    while (1) {
+        if (g_supervisor_stopping) { return; }
+        const char *endpoint = NULL;
+#if I_AM_CONSUMER_OR_SERVER == 1
+        if (zenoh_settings_is_tcp()) {
+            endpoint = connect_endpoint_at(rank);
+        }
+#endif
+        z_result_t res = open_session(endpoint);
+        if (res >= 0) { break; }
+#if I_AM_CONSUMER_OR_SERVER == 1
+        if (endpoint != NULL && connect_endpoint_at(++rank) != NULL) { continue; } // fail over to the next one
+#endif
+        rank = 0;
+        uint32_t delay_ms = jittered_ms(backoff_ms);
+        ZLOGW(TAG, "Next attempt in %lu ms", (unsigned long)delay_ms);
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+        backoff_ms = backoff_ms * 2 > ZENOH_RECONNECT_BACKOFF_MAX_MS ? ZENOH_RECONNECT_BACKOFF_MAX_MS : backoff_ms * 2;
+    }
+    xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+    g_session_open = true;
+    xSemaphoreGive(g_session_mutex);
+#if ZENOH_STATS_ON
+    zenoh_stats_session_up();
+#endif
+
+    ZLOGI(TAG, "✅ Zenoh Session Opened Successfully!✅");
+    xEventGroupSetBits(app_event_group, ZENOH_CONNECTED_BIT);
+
+    char session_zid_str[sizeof(z_id_t) * 2 + 1] = {0};
+    z_id_t sid = z_info_zid(z_loan(session));
+    format_zid(&sid, session_zid_str, sizeof(session_zid_str));
+    ZLOGI(TAG, "My Zenoh ID is: %s", session_zid_str);
+
+    start_session_tasks(z_loan_mut(session));
+    zenoh_attachment_init(&sid);
+
+    declare_resources(g_client_data_handler);
+    ZLOGD(TAG, "All Zenoh resources declared.");
     xEventGroupSetBits(app_event_group, ZENOH_DECLARED_BIT);
 
-    while (1) { vTaskDelay(portMAX_DELAY); }
+#if ZENOH_STATS_ON && ZENOH_STATS_PUBLISH_PERIOD_MS > 0
+    snprintf(g_stats_key, sizeof(g_stats_key), "%s/%s/stats", ZENOH_STATS_KEYEXPR, session_zid_str);
+    g_stats_due = xTaskGetTickCount() + pdMS_TO_TICKS(ZENOH_STATS_PUBLISH_PERIOD_MS);
+#endif
+#if ZENOH_HYBRID_ON
+    g_mcast_retry_due = xTaskGetTickCount() + pdMS_TO_TICKS(ZENOH_HYBRID_RETRY_MS);
+#endif
+}
+
+static bool supervisor_spawn();
+
+/**
+ * @brief Connection supervisor task.
+ *
+ * Runs one round of work and deletes itself: (re)connects when there is no
+ * session or it was lost (the bits are cleared and everything is torn down
+ * first), otherwise does the periodic work that fell due. In between,
+ * supervisor_tick() watches the session, so no stack is held while it is up.
+ */
+static void zenoh_client_task(void *arg) {
+    (void)arg;
+    if (g_session_open && session_lost()) {
+#if ZENOH_STATS_ON
+        zenoh_stats_session_down();
+#endif
+        ZLOGW(TAG, "⚠️ Zenoh session lost, reconnecting... ⚠️");
+        xEventGroupClearBits(app_event_group, ZENOH_CONNECTED_BIT | ZENOH_DECLARED_BIT);
+        close_session();
+    }
+    if (!g_session_open) {
+        supervisor_connect();
+    } else {
+#if ZENOH_HYBRID_ON
+        hybrid_supervise();
+#endif
+#if ZENOH_STATS_ON && ZENOH_STATS_PUBLISH_PERIOD_MS > 0
+        if (tick_reached(g_stats_due)) {
+            g_stats_due += pdMS_TO_TICKS(ZENOH_STATS_PUBLISH_PERIOD_MS);
+            publish_stats(g_stats_key);
+        }
+#endif
+    }
+    zenoh_task_handle = NULL;
+    if (!g_supervisor_stopping) { xTimerStart(g_supervisor_timer, portMAX_DELAY); }
+    g_supervisor_busy = false; // from here the timer may spawn the next round
+    xSemaphoreGive(g_supervisor_exit);
+    vTaskDelete(NULL);
+}
+
+// Timer callback: only checks, the supervisor task does the (blocking) work
+static void supervisor_tick(TimerHandle_t timer) {
+    bool idle = false;
+    if (!g_supervisor_busy.compare_exchange_strong(idle, true)) { return; } // a round is running
+    if (g_supervisor_stopping) { // checked after the claim, zenoh_client_stop() waits for it to go
+        g_supervisor_busy = false;
+        return;
+    }
+    bool due = session_lost();
+#if ZENOH_HYBRID_ON
+    due = due || hybrid_due();
+#endif
+#if ZENOH_STATS_ON && ZENOH_STATS_PUBLISH_PERIOD_MS > 0
+    due = due || tick_reached(g_stats_due);
+#endif
+    if (!due) {
+        g_supervisor_busy = false;
+        return;
+    }
+    xTimerStop(timer, 0);
+    if (!supervisor_spawn()) { // try again on the next tick
+        g_supervisor_busy = false;
+        xTimerStart(timer, 0);
+    }
+}
+
+static bool supervisor_spawn() {
+    if (xTaskCreatePinnedToCore(zenoh_client_task, "zenoh_client_task", ZENOH_CLIENT_TASK_STACK, NULL,
+            ZENOH_CLIENT_TASK_PRIO, &zenoh_task_handle, ZENOH_CLIENT_TASK_CORE) != pdPASS) {
+        ZLOGE(TAG, "❗Failed to create the supervisor task❗");
+        zenoh_task_handle = NULL;
+        return false;
+    }
+    return true;
 }
 
 extern "C" {
     void zenoh_client_init_and_start(EventGroupHandle_t event_group, z_data_handler_t data_handler) {
-        ESP_LOGI(TAG, "Calling zenoh_client_init_and_start");
-        if (zenoh_task_handle) {
-            ESP_LOGW(TAG, "⚠️ Task already running. ⚠️");
+        zenoh_client_init_with_settings(event_group, data_handler, NULL);
+    }
+
+    void zenoh_client_init_with_settings(EventGroupHandle_t event_group, z_data_handler_t data_handler,
+            const zenoh_settings_t *settings) {
+        ZLOGI(TAG, "Calling zenoh_client_init_and_start");
+        if (g_supervisor_timer != NULL) {
+            ZLOGW(TAG, "⚠️ Task already running. ⚠️");
+            return;
+        }
+        // Created first: it marks the client as started, nothing is started without it
+        g_supervisor_timer = xTimerCreate("zenoh_supervisor", pdMS_TO_TICKS(ZENOH_SUPERVISOR_PERIOD_MS),
+                pdTRUE, NULL, supervisor_tick);
+        if (g_supervisor_timer == NULL) {
+            ZLOGE(TAG, "❗Failed to create the supervisor timer, client not started❗");
             return;
         }
+        if (settings != NULL) {
+            zenoh_settings_apply(settings);
+        } else {
+            zenoh_settings_t loaded;
+#if ZENOH_SETTINGS_NVS_ON
+            zenoh_settings_load(&loaded);
+#else
+            zenoh_settings_defaults(&loaded);
+#endif
+            zenoh_settings_apply(&loaded);
+        }
         app_event_group = event_group;
+#if ZENOH_LOG_DEFERRED_ON
+        zenoh_log_start();
+#endif
+        if (g_session_mutex == NULL) { g_session_mutex = xSemaphoreCreateMutex(); }
+#if !ZENOH_PLATFORM_HOST
+        if (g_ip_event_instance == NULL) {
+            esp_event_handler_instance_register(IP_EVENT, ESP_EVENT_ANY_ID, ip_event_handler, NULL, &g_ip_event_instance);
+        }
+#endif
+#if ZENOH_PAYLOAD_POOL_ON
+        zenoh_payload_pool_init();
+#endif
+#if ZENOH_BATCHING_ON
+        zenoh_batch_init();
+#endif
+#if PUBLISHER_ON
+        if (g_publishers_mutex == NULL) { g_publishers_mutex = xSemaphoreCreateMutex(); }
+#endif
+#if ZENOH_ASYNC_PUBLISH_ON
+        zenoh_async_start(event_group);
+#endif
         #if SCOUT_ON
-            run_scout();
+            zenoh_scout_start(event_group); // runs in the background, never delays startup
         #endif
-        xTaskCreate(zenoh_client_task, "zenoh_client_task", 8192, (void*)data_handler, 5, &zenoh_task_handle);
+#if ZENOH_SELFTEST_ON
+        zenoh_selftest_start(event_group);
+#endif
+        g_client_data_handler = data_handler;
+        if (g_supervisor_exit == NULL) { g_supervisor_exit = xSemaphoreCreateBinary(); }
+        g_supervisor_stopping = false;
+        g_supervisor_busy = true;
+        if (!supervisor_spawn()) { // the ticks retry it, as after a failed spawn in supervisor_tick()
+            g_supervisor_busy = false;
+            xTimerStart(g_supervisor_timer, portMAX_DELAY);
+        }
     }
 
     void zenoh_client_stop() {
-        ESP_LOGI(TAG, "Calling zenoh_client_stop");
-#if HEARTBEAT_ON
-            zenoh_heartbeat_stop();
+        ZLOGI(TAG, "Calling zenoh_client_stop");
+#if ZENOH_BATCHING_ON
+            zenoh_batch_stop();
 #endif
-        if (zenoh_task_handle != NULL) { vTaskDelete(zenoh_task_handle); 
-                zenoh_task_handle = NULL; }
-#if PUBLISHER_ON
-            if(g_publisher_declared) { z_drop(z_move(main_publisher)); }
+#if ZENOH_TRANSFER_ON
+            zenoh_transfer_stop();
+#endif
+#if ZENOH_ASYNC_PUBLISH_ON
+            zenoh_async_stop();
 #endif
+#if SCOUT_ON
+        zenoh_scout_stop();
+#endif
+#if ZENOH_SELFTEST_ON
+        zenoh_selftest_stop();
+#endif
+        // A running round may hold the session mutex or be mid-connect: let it end on its own
+        g_supervisor_stopping = true;
+        while (g_supervisor_busy) { xSemaphoreTake(g_supervisor_exit, pdMS_TO_TICKS(ZENOH_SUPERVISOR_PERIOD_MS)); }
+        if (g_supervisor_timer != NULL) {
+            xTimerDelete(g_supervisor_timer, portMAX_DELAY);
+            g_supervisor_timer = NULL;
+        }
+        xEventGroupClearBits(app_event_group, ZENOH_CONNECTED_BIT | ZENOH_DECLARED_BIT);
+        close_session();
+#if ZENOH_DISPATCH_ON
+        zenoh_dispatch_stop();
+#endif
+#if !ZENOH_PLATFORM_HOST
+        if (g_ip_event_instance != NULL) {
+            esp_event_handler_instance_unregister(IP_EVENT, ESP_EVENT_ANY_ID, g_ip_event_instance);
+            g_ip_event_instance = NULL;
+        }
+#endif
+        if (g_config_cached) {
+            z_drop(z_move(g_cached_config));
+            g_config_cached = false;
+        }
+        ZLOGI(TAG, "Zenoh client stopped and resources released.");
+#if ZENOH_LOG_DEFERRED_ON
+        zenoh_log_stop();
+#endif
+    }
 
+    int zenoh_register_queryable(const char *keyexpr, zenoh_query_stream_provider_t provider, void *ctx) {
+        if (provider == NULL || strlen(keyexpr) >= ZENOH_KEYEXPR_MAX_LEN) { return -1; }
+        if (strchr(keyexpr, '*') != NULL) {
+            // query_route() matches segments literally, the provider would never be reached
+            ZLOGE(TAG, "❗Wildcard key '%s' cannot be registered, use literal segments❗", keyexpr);
+            return -1;
+        }
+        if (query_route_set(keyexpr, provider, ctx) < 0) {
+            ZLOGE(TAG, "❗Queryable table full or segment too long, cannot register '%s' "
+                  "(ZENOH_QUERYABLE_TRIE_NODES, ZENOH_QUERYABLE_SEGMENT_MAX_LEN)❗", keyexpr);
+            return -1;
+        }
 #if QUERYABLE_ON
-            z_drop(z_move(queryable));
+        if (!under_main_queryable(keyexpr)) {
+            // The session mutex keeps declare_resources/close_session off the table meanwhile
+            if (g_session_mutex != NULL) { xSemaphoreTake(g_session_mutex, portMAX_DELAY); }
+            int res = extra_queryable_add(keyexpr);
+            if (g_session_mutex != NULL) { xSemaphoreGive(g_session_mutex); }
+            if (res < 0) {
+                query_route_set(keyexpr, NULL, NULL);
+                return -1;
+            }
+        }
 #endif
+        ZLOGI(TAG, "💡 Registered queryable handler for '%s'", keyexpr);
+        return 0;
+    }
+
+    void zenoh_unregister_queryable(const char *keyexpr) {
+        query_route_set(keyexpr, NULL, NULL);
+#if QUERYABLE_ON
+        if (g_session_mutex != NULL) { xSemaphoreTake(g_session_mutex, portMAX_DELAY); }
+        extra_queryable_remove(keyexpr);
+        if (g_session_mutex != NULL) { xSemaphoreGive(g_session_mutex); }
+#endif
+    }
 
 #if SUBSCRIBER_ON
-            z_drop(z_move(main_subscriber));
+    zenoh_subscription_t zenoh_subscribe(const char *keyexpr, z_data_handler_t handler, void *ctx) {
+        if (handler == NULL || strlen(keyexpr) >= ZENOH_KEYEXPR_MAX_LEN) { return -1; }
+        if (g_session_mutex == NULL) {
+            ZLOGE(TAG, "❗zenoh_subscribe before zenoh_client_init_and_start❗");
+            return -1;
+        }
+        xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+        size_t index = ZENOH_MAX_SUBSCRIPTIONS;
+        for (size_t i = 0; i < ZENOH_MAX_SUBSCRIPTIONS && index == ZENOH_MAX_SUBSCRIPTIONS; i++) {
+            if (!g_subscriptions[i].in_use) { index = i; }
+        }
+        if (index == ZENOH_MAX_SUBSCRIPTIONS) {
+            xSemaphoreGive(g_session_mutex);
+            ZLOGE(TAG, "❗No subscription slot left for '%s' (ZENOH_MAX_SUBSCRIPTIONS)❗", keyexpr);
+            return -1;
+        }
+        subscription_t *s = &g_subscriptions[index];
+        taskENTER_CRITICAL(&g_subscriptions_lock);
+        s->generation = (uint16_t)((s->generation + 1) & 0x7fff); // keeps handles positive
+        s->handler = handler;
+        s->ctx = ctx;
+        s->declared = false;
+#if ZENOH_HYBRID_ON
+        s->mcast_declared = false;
 #endif
-        z_drop(z_move(session));
-        ESP_LOGI(TAG, "Zenoh client stopped and resources released.");
+        strcpy(s->keyexpr, keyexpr);
+        s->in_use = true;
+        taskEXIT_CRITICAL(&g_subscriptions_lock);
+        if (g_session_open && !declare_subscription(index)) {
+            // Live session refused it (e.g. bad key): a retry on reconnect would fail the same way
+            taskENTER_CRITICAL(&g_subscriptions_lock);
+            s->in_use = false;
+            taskEXIT_CRITICAL(&g_subscriptions_lock);
+            xSemaphoreGive(g_session_mutex);
+            return -1;
+        }
+        zenoh_subscription_t handle = SUBSCRIPTION_HANDLE(index, s->generation);
+        xSemaphoreGive(g_session_mutex);
+        return handle;
     }
 
+    void zenoh_unsubscribe(zenoh_subscription_t handle) {
+        uint32_t index = SUBSCRIPTION_INDEX(handle);
+        if (handle < 0 || index >= ZENOH_MAX_SUBSCRIPTIONS || g_session_mutex == NULL) { return; }
+        xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+        subscription_t *s = &g_subscriptions[index];
+        taskENTER_CRITICAL(&g_subscriptions_lock);
+        bool live = s->in_use && s->generation == SUBSCRIPTION_GENERATION(handle);
+        if (live) { s->in_use = false; }
+        taskEXIT_CRITICAL(&g_subscriptions_lock);
+        if (live) {
+            if (s->declared) { z_drop(z_move(s->subscriber)); }
+            s->declared = false;
+#if ZENOH_HYBRID_ON
+            if (s->mcast_declared) { z_drop(z_move(s->mcast_subscriber)); }
+            s->mcast_declared = false;
+#endif
+            ZLOGI(TAG, "📤 Unsubscribed from '%s'", s->keyexpr);
+        }
+        xSemaphoreGive(g_session_mutex);
+    }
+#endif
+
 #if I_AM_CONSUMER_OR_SERVER == 0
+    typedef struct {
+        zenoh_reply_handler_t handler;
+        void *arg;
+    } reply_target_t;
 
+    // Calls the application handler with the reply's payload, decompressed if it was compressed
+    static void reply_trampoline(z_loaned_reply_t *reply, void *ctx) {
+        reply_target_t *target = (reply_target_t *)ctx;
+        if (!z_reply_is_ok(reply)) {
+            target->handler(reply, NULL, target->arg);
+            return;
+        }
+        const z_loaned_sample_t *sample = z_reply_ok(reply);
+        const z_loaned_bytes_t *payload = z_sample_payload(sample);
+#if ZENOH_COMPRESSION_ON
+        z_view_string_t key;
+        z_keyexpr_as_view_string(z_sample_keyexpr(sample), &key);
+        z_owned_bytes_t plain;
+        if (zenoh_compress_key_listed(z_string_data(z_loan(key)), z_string_len(z_loan(key)))
+            && zenoh_decompress(payload, &plain)) {
+            target->handler(reply, z_loan(plain), target->arg);
+            z_drop(z_move(plain)); // a payload the handler retained stays alive
+            return;
+        }
+#endif
+        target->handler(reply, payload, target->arg);
+    }
+
+    static void reply_target_drop(void *ctx) { free(ctx); }
+
+    // Reply closure for handler; false if there is no memory for it
+    static bool reply_closure_for(z_owned_closure_reply_t *closure, zenoh_reply_handler_t handler, void *arg) {
+        reply_target_t *target = (reply_target_t *)malloc(sizeof(reply_target_t));
+        if (target == NULL) {
+            ZLOGE(TAG, "❗No memory for a GET reply closure❗");
+            return false;
+        }
+        target->handler = handler;
+        target->arg = arg;
+        z_closure(closure, reply_trampoline, reply_target_drop, target);
+        return true;
+    }
 
-    void zenoh_get_data(const char *keyexpr, void (*handler)(z_loaned_reply_t*, void*), void *arg) {
-        ESP_LOGI(TAG, "➡️ GET request for '%s'", keyexpr);
-        z_owned_closure_reply_t reply_closure; 
-        z_closure(&reply_closure, handler, NULL, arg);
+    void zenoh_get_data(const char *keyexpr, zenoh_reply_handler_t handler, void *arg) {
+        ZLOGI(TAG, "➡️ GET request for '%s'", keyexpr);
+        z_owned_closure_reply_t reply_closure;
+        if (!reply_closure_for(&reply_closure, handler, arg)) { return; }
         
         z_get_options_t options;
         z_get_options_default(&options);
@@ -356,46 +2000,252 @@ extern "C" {
         z_view_keyexpr_t ke;
         z_view_keyexpr_from_str_unchecked(&ke, keyexpr);
         
-        if (z_get(z_loan(session), z_loan(ke), "", z_move(reply_closure), &options) < 0) {
-            ESP_LOGE(TAG, "❗Failed to send GET request for '%s'❗", keyexpr);
+        xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+        if (!g_session_open) {
+            z_drop(z_move(reply_closure));
+            ZLOGE(TAG, "❗No session, GET for '%s' not sent❗", keyexpr);
+        } else if (z_get(z_loan(session), z_loan(ke), "", z_move(reply_closure), &options) < 0) {
+            ZLOGE(TAG, "❗Failed to send GET request for '%s'❗", keyexpr);
         }
+        xSemaphoreGive(g_session_mutex);
+    }
+
+    void zenoh_get_data_params(const char *keyexpr, const char *parameters, zenoh_reply_handler_t handler, void *arg) {
+        ZLOGI(TAG, "➡️ GET request for '%s?%s'", keyexpr, parameters ? parameters : "");
+        z_owned_closure_reply_t reply_closure;
+        if (!reply_closure_for(&reply_closure, handler, arg)) { return; }
+
+        z_get_options_t options;
+        z_get_options_default(&options);
+        // Streaming providers answer with several replies on the same key
+        options.consolidation = z_query_consolidation_none();
+
+        z_view_keyexpr_t ke;
+        z_view_keyexpr_from_str_unchecked(&ke, keyexpr);
+
+        xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+        if (!g_session_open) {
+            z_drop(z_move(reply_closure));
+            ZLOGE(TAG, "❗No session, GET for '%s' not sent❗", keyexpr);
+        } else if (z_get(z_loan(session), z_loan(ke), parameters ? parameters : "", z_move(reply_closure), &options) < 0) {
+            ZLOGE(TAG, "❗Failed to send GET request for '%s'❗", keyexpr);
+        }
+        xSemaphoreGive(g_session_mutex);
+    }
+
+    int zenoh_get_with_closure(const char *keyexpr, const char *parameters, z_owned_closure_reply_t *closure,
+            z_get_options_t *options) {
+        z_view_keyexpr_t ke;
+        z_view_keyexpr_from_str_unchecked(&ke, keyexpr);
+        int res = -1;
+        xSemaphoreTake(g_session_mutex, portMAX_DELAY);
+        bool open = g_session_open;
+        if (open) {
+            res = z_get(z_loan(session), z_loan(ke), parameters ? parameters : "", z_move(*closure), options) < 0 ? -1 : 0;
+        }
+        xSemaphoreGive(g_session_mutex);
+        if (!open) { z_drop(z_move(*closure)); } // its drop callback may block, keep it outside the lock
+        return res;
     }
 #endif //I_AM_CONSUMER_OR_SERVER == 0
 
+    bool zenoh_bytes_view(const z_loaned_bytes_t *bytes, zenoh_bytes_view_t *out) {
+        z_view_slice_t view;
+        if (z_bytes_get_contiguous_view(bytes, &view) != Z_OK) {
+            out->data = NULL;
+            out->len = z_bytes_len(bytes);
+            return false;
+        }
+        out->data = z_slice_data(z_loan(view));
+        out->len = z_slice_len(z_loan(view));
+        return true;
+    }
+
+    const uint8_t *zenoh_bytes_data(const z_loaned_bytes_t *bytes, size_t *len, uint8_t *scratch, size_t scratch_len) {
+        zenoh_bytes_view_t view;
+        if (zenoh_bytes_view(bytes, &view)) {
+            *len = view.len;
+            return view.data;
+        }
+        *len = zenoh_bytes_read_at(bytes, 0, scratch, scratch_len);
+        return scratch;
+    }
+
+    size_t zenoh_bytes_read_at(const z_loaned_bytes_t *bytes, size_t offset, uint8_t *dst, size_t len) {
+        z_bytes_reader_t reader = z_bytes_get_reader(bytes);
+        if (offset > 0 && z_bytes_reader_seek(&reader, (int64_t)offset, SEEK_SET) != Z_OK) { return 0; }
+        return z_bytes_reader_read(&reader, dst, len);
+    }
+
+    size_t zenoh_bytes_for_each_slice(const z_loaned_bytes_t *bytes, zenoh_slice_visitor_t visit, void *arg) {
+        z_bytes_slice_iterator_t it = z_bytes_get_slice_iterator(bytes);
+        z_view_slice_t slice;
+        size_t visited = 0;
+        while (z_bytes_slice_iterator_next(&it, &slice)) {
+            visited++;
+            if (!visit(z_slice_data(z_loan(slice)), z_slice_len(z_loan(slice)), arg)) { break; }
+        }
+        return visited;
+    }
+
+    int zenoh_sample_retain_payload(const z_loaned_sample_t *sample, z_owned_bytes_t *out) {
+        return z_bytes_clone(out, z_sample_payload(sample));
+    }
+
     void zenoh_publish(const char *keyexpr, const char *payload_str) {
         if (g_publisher_declared) {
-            z_view_keyexpr_t ke;
-            z_view_keyexpr_from_str_unchecked(&ke, keyexpr);
+#if ZENOH_BATCHING_ON
+            size_t len = strlen(payload_str);
+            if (zenoh_batch_wants(keyexpr, len)) {
+                zenoh_publish_batched(keyexpr, (const uint8_t *)payload_str, len);
+                return;
+            }
+#endif
             z_owned_bytes_t payload;
             z_bytes_copy_from_str(&payload, payload_str);
-            ESP_LOGD(TAG, "\033[38;5;214m🡆 OUT\033[0m:'%s' at '%s'", payload_str, keyexpr);
-            z_put(z_loan(session), z_loan(ke), z_move(payload), NULL);
+            ZLOGD_HOT(TAG, "🡆 OUT: %u bytes at '%s'", (unsigned)strlen(payload_str), keyexpr);
+            publish_owned_bytes(keyexpr, &payload, NULL);
         } else {
-            ESP_LOGE(TAG, "Publisher not declared. Cannot publish.");
+            ZLOGE(TAG, "Publisher not declared. Cannot publish.");
+            note_publish_dropped();
         }
     }
 
+    int zenoh_publish_bytes(const char *keyexpr, z_owned_bytes_t *payload, const z_publisher_put_options_t *options) {
+        if (!g_publisher_declared) {
+            ZLOGE(TAG, "Publisher not declared. Cannot publish.");
+            note_publish_dropped();
+            z_drop(z_move(*payload));
+            return _Z_ERR_GENERIC;
+        }
+        int res = publish_owned_bytes(keyexpr, payload, options);
+        if (res < 0) {
+#if ZENOH_LOG_DEFERRED_ON
+            ZLOG_EVENT(PUT_FAIL, (uint32_t)-res, zenoh_log_key_hash(keyexpr, strlen(keyexpr)));
+#else
+            ZLOGW(TAG, "z_put failed or dropped! (key: %s)", keyexpr);
+#endif
+        }
+        return res;
+    }
+
     void zenoh_publish_binary(const char *keyexpr, const uint8_t *payload, size_t len, const z_publisher_put_options_t *options) {
-        (void)options; // options currently unused; keep for API compatibility
         if (!g_publisher_declared) {
-            ESP_LOGE(TAG, "Publisher not declared. Cannot publish.");
-            free((void *)payload);
+            ZLOGE(TAG, "Publisher not declared. Cannot publish.");
+            note_publish_dropped();
+            payload_deleter((void *)payload, (void *)1);
             return;
         }
-        z_view_keyexpr_t ke;
-        z_view_keyexpr_from_str_unchecked(&ke, keyexpr);
+#if ZENOH_BATCHING_ON
+        if (options == NULL && zenoh_batch_wants(keyexpr, len)) {
+            zenoh_publish_batched(keyexpr, payload, len); // small, copied into the batch
+            payload_deleter((void *)payload, (void *)1);
+            return;
+        }
+#endif
+#if ZENOH_COMPRESSION_ON
+        uint8_t *packed;
+        size_t packed_len;
+        if (zenoh_compress_wants(keyexpr, strlen(keyexpr), len)
+            && (packed_len = zenoh_compress(payload, len, &packed)) > 0) {
+            payload_deleter((void *)payload, (void *)1); // packed is malloc'd or a pool block too
+            payload = packed;
+            len = packed_len;
+        }
+#endif
         z_owned_bytes_t z_payload;
         if (z_bytes_from_buf(&z_payload, (uint8_t *)payload, len, payload_deleter, (void*)1) != Z_OK) {
-            ESP_LOGE(TAG, "Failed to create zenoh payload from buffer");
-            free((void *)payload);
+            ZLOGE(TAG, "Failed to create zenoh payload from buffer");
+            note_publish_dropped();
+            payload_deleter((void *)payload, (void *)1);
             return;
         }
-        // NOTE: The z_put call expects a z_put_options_t pointer. We currently
-        // don't convert the publisher options; pass NULL to use defaults.
-        int res = z_put(z_loan(session), z_loan(ke), z_move(z_payload), NULL);
+        int res = publish_owned_bytes(keyexpr, &z_payload, options);
+        if (res < 0) {
+            ZLOGW(TAG, "z_put failed or dropped! (key: %s)", keyexpr);
+        }
+    }
+
+    /**
+     * @brief Publishes header + keypoints + image as one multi-slice payload.
+     *
+     * The header and keypoints are small and are copied into the bytes writer.
+     * The image is appended as its own slice wrapping the caller's buffer, so
+     * the frame is never copied into a contiguous staging buffer. Ownership of
+     * image_buffer passes to the manager: it is released by payload_deleter
+     * (zenoh_psram_free) once zenoh drops the last reference to the slice, i.e.
+     * after the transport has serialized it. This also happens on every error path.
+     *
+     * @param keyexpr Key expression to publish on.
+     * @param header Face payload header; sizes are read via FACE_PAYLOAD_* accessors.
+     * @param keypoints Array of FACE_PAYLOAD_KEYPOINT_COUNT(header) int32 (may be NULL if 0).
+     * @param image_buffer zenoh_psram_malloc'd image of FACE_PAYLOAD_IMAGE_LEN(header) bytes (may be NULL if 0).
+     * @return -1 if a part the header announces is missing, else the zenoh result code.
+     */
+    int zenoh_publish_face_payload(const char *keyexpr,
+                                   const face_payload_header_t *header,
+                                   const int32_t *keypoints,
+                                   const uint8_t *image_buffer) {
+        size_t kp_len = header ? FACE_PAYLOAD_KEYPOINT_COUNT(header) * sizeof(int32_t) : 0;
+        size_t img_len = header ? FACE_PAYLOAD_IMAGE_LEN(header) : 0;
+        // Receivers size the parts from the header: never announce data that does not follow
+        if (header == NULL || (kp_len > 0 && keypoints == NULL) || (img_len > 0 && image_buffer == NULL)) {
+            ZLOGE(TAG, "Face payload with a missing header, keypoints or image. Dropped.");
+            note_publish_dropped();
+            if (image_buffer) { payload_deleter((void *)image_buffer, NULL); }
+            return -1;
+        }
+        if (img_len == 0 && image_buffer != NULL) {
+            payload_deleter((void *)image_buffer, NULL); // owned but not announced, nothing to send
+        }
+
+        // Wrap the image first so that every later failure releases it via its deleter.
+        z_owned_bytes_t image;
+        bool has_image = img_len > 0;
+        if (has_image && z_bytes_from_buf(&image, (uint8_t *)image_buffer, img_len, payload_deleter, NULL) != Z_OK) {
+            ZLOGE(TAG, "Failed to wrap face image buffer");
+            payload_deleter((void *)image_buffer, NULL);
+            return -1;
+        }
+
+        if (!g_publisher_declared) {
+            ZLOGE(TAG, "Publisher not declared. Cannot publish.");
+            note_publish_dropped();
+            if (has_image) { z_drop(z_move(image)); }
+            return -1;
+        }
+
+        z_owned_bytes_writer_t writer;
+        if (z_bytes_writer_empty(&writer) != Z_OK) {
+            ZLOGE(TAG, "Failed to create face payload writer");
+            if (has_image) { z_drop(z_move(image)); }
+            return -1;
+        }
+        bool ok = z_bytes_writer_write_all(z_loan_mut(writer), (const uint8_t *)header, sizeof(*header)) == Z_OK;
+        if (ok && kp_len > 0) {
+            ok = z_bytes_writer_write_all(z_loan_mut(writer), (const uint8_t *)keypoints, kp_len) == Z_OK;
+        }
+        if (has_image) {
+            // append() takes the image slice by reference, no copy.
+            if (ok) {
+                ok = z_bytes_writer_append(z_loan_mut(writer), z_move(image)) == Z_OK;
+            } else {
+                z_drop(z_move(image));
+            }
+        }
+        if (!ok) {
+            ZLOGE(TAG, "Failed to assemble face payload (key: %s)", keyexpr);
+            z_drop(z_move(writer));
+            return -1;
+        }
+
+        z_owned_bytes_t z_payload;
+        z_bytes_writer_finish(z_move(writer), &z_payload);
+        int res = publish_owned_bytes(keyexpr, &z_payload, NULL);
         if (res < 0) {
-            ESP_LOGW(TAG, "z_put failed or dropped! (key: %s)", keyexpr);
+            ZLOGW(TAG, "z_put failed or dropped! (key: %s)", keyexpr);
         }
+        return res;
     }
 } // extern "C"
 
@@ -6,8 +6,16 @@
 #include <zenoh-pico.h>
 #include <stddef.h> 
 #include <stdint.h> 
+#include <stdbool.h>
 
 #include "zenoh_config.h"
+#include "zenoh_async.h"
+#include "zenoh_pool.h"
+#include "zenoh_transfer.h"
+#include "zenoh_dispatch.h"
+#include "zenoh_settings.h"
+#include "zenoh_stats.h"
+#include "zenoh_trace.h"
 #include "shared_payload.h"
 
 #ifdef __cplusplus
@@ -18,21 +26,68 @@ extern "C" {
 typedef void (*z_data_handler_t)(z_loaned_sample_t* sample, void* arg);
 
 // The init function now accepts a pointer to the application's data handler.
+// With ZENOH_DISPATCH_ON the handler runs in a dispatch worker, not in the
+// zenoh read task; the sample is valid for the duration of the call either way.
+// Settings come from NVS (ZENOH_SETTINGS_NVS_ON) on top of the zenoh_config.h defaults.
 void zenoh_client_init_and_start(EventGroupHandle_t event_group, z_data_handler_t data_handler);
 
+// Same with explicit runtime settings (see zenoh_settings.h); NULL behaves like above.
+void zenoh_client_init_with_settings(EventGroupHandle_t event_group, z_data_handler_t data_handler,
+        const zenoh_settings_t *settings);
+
 void zenoh_client_stop();
 
 // Publishes a simple string
 void zenoh_publish(const char *keyexpr, const char *payload_str);
 
-// Publishes a raw binary buffer, accepting options for non-blocking sends
+// Publishes a raw binary buffer and takes ownership of it: malloc'd buffers are
+// freed, blocks from zenoh_payload_acquire() go back to the pool. The options (encoding, attachment, timestamp) are
+// passed to the put; congestion control, priority and express come from the
+// key's QoS profile in zenoh_config.h.
 void zenoh_publish_binary(const char *keyexpr, const uint8_t *payload, size_t len, const z_publisher_put_options_t *options);
 
-// Efficiently builds and publishes the complete face payload from its separate parts
-void zenoh_publish_face_payload(const char *keyexpr,
-                                const face_payload_header_t *header,
-                                const int *keypoints,
-                                const uint8_t *image_buffer);
+// Publishes an already built zenoh payload. The payload is always consumed.
+// options may be NULL. Returns the zenoh result code (< 0 on failure).
+int zenoh_publish_bytes(const char *keyexpr, z_owned_bytes_t *payload, const z_publisher_put_options_t *options);
+
+// Efficiently builds and publishes the complete face payload from its separate parts.
+// The parts go out as one multi-slice payload without a staging copy. Ownership of
+// image_buffer (zenoh_psram_malloc allocated) passes to the manager, which frees it
+// once sent or on error. Returns -1 without publishing if the header announces
+// keypoints or image bytes whose buffer is NULL, else the zenoh result code.
+int zenoh_publish_face_payload(const char *keyexpr,
+                               const face_payload_header_t *header,
+                               const int32_t *keypoints,
+                               const uint8_t *image_buffer);
+
+// Receive helpers
+// Read sample payloads (z_sample_payload) in place instead of copying them out
+// with z_bytes_to_string. Views and slices point into the received buffers and
+// are only valid for the duration of the handler call.
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+} zenoh_bytes_view_t;
+
+// True if the payload is a single slice, *out then covers all of it. Otherwise
+// out->data is NULL and out->len the total length: use a reader or the slices.
+bool zenoh_bytes_view(const z_loaned_bytes_t *bytes, zenoh_bytes_view_t *out);
+// Contiguous data when possible, else up to scratch_len bytes copied into scratch.
+// *len is the number of bytes available at the returned pointer.
+const uint8_t *zenoh_bytes_data(const z_loaned_bytes_t *bytes, size_t *len, uint8_t *scratch, size_t scratch_len);
+// Copies up to len bytes starting at offset; returns the number of bytes copied
+size_t zenoh_bytes_read_at(const z_loaned_bytes_t *bytes, size_t offset, uint8_t *dst, size_t len);
+// Calls visit for every slice in order, without copying; visit returns false to stop.
+// Returns the number of slices visited.
+typedef bool (*zenoh_slice_visitor_t)(const uint8_t *data, size_t len, void *arg);
+size_t zenoh_bytes_for_each_slice(const z_loaned_bytes_t *bytes, zenoh_slice_visitor_t visit, void *arg);
+// Keeps the payload beyond the handler call: the buffers are reference counted,
+// nothing is copied. Drop *out (z_drop) when done. Returns 0 on success.
+int zenoh_sample_retain_payload(const z_loaned_sample_t *sample, z_owned_bytes_t *out);
+
+// Fills publisher options with the QoS profile matching keyexpr (see ZENOH_QOS_PROFILES).
+// Used by the manager and by modules that declare their own publishers.
+void zenoh_qos_publisher_options(const char *keyexpr, z_publisher_options_t *options);
 
 // Queryable data provider API
 // The application can register a callback that fills a z_owned_bytes_t payload
@@ -43,6 +98,81 @@ typedef int (*zenoh_query_provider_t)(void *ctx, z_owned_bytes_t *out);
 void zenoh_register_query_provider(zenoh_query_provider_t cb, void *ctx);
 void zenoh_set_queryable_data(void *data); // legacy: store an opaque pointer
 
+// Streaming query provider API
+// Instead of one buffer, a streaming provider is called repeatedly for the same
+// GET and may emit any number of replies per call (e.g. one per ROI or chunk),
+// straight out of the frame buffer. Return ZENOH_STREAM_MORE to be called again,
+// ZENOH_STREAM_DONE when finished, or a negative value on error (an error reply
+// is sent if nothing was replied yet). It takes precedence over the provider above.
+// Callers should disable consolidation (zenoh_get_data_params does) since all
+// replies share the query's key expression.
+#define ZENOH_STREAM_DONE 0
+#define ZENOH_STREAM_MORE 1
+typedef struct zenoh_query_ctx zenoh_query_ctx_t;
+typedef int (*zenoh_query_stream_provider_t)(void *ctx, zenoh_query_ctx_t *query);
+void zenoh_register_query_stream_provider(zenoh_query_stream_provider_t cb, void *ctx);
+
+// Replies with len bytes of data by reference. zenoh-pico serializes before
+// returning, so data only has to stay valid for the duration of the call.
+int zenoh_query_reply_data(zenoh_query_ctx_t *query, const uint8_t *data, size_t len);
+// Replies with a prebuilt payload, which is always consumed.
+int zenoh_query_reply_bytes(zenoh_query_ctx_t *query, z_owned_bytes_t *payload);
+
+// Number of previous calls of the provider for this query (0 on the first call)
+uint32_t zenoh_query_call_index(const zenoh_query_ctx_t *query);
+// Scratch value kept across calls for the same query (e.g. next offset), starts at 0
+uintptr_t *zenoh_query_state(zenoh_query_ctx_t *query);
+// Key expression of the GET as a view (not NUL terminated)
+const char *zenoh_query_key(const zenoh_query_ctx_t *query, size_t *len);
+
+// Selector parameters ("?roi=10,20,64,64;res=320"), see zenoh_utils_param_get
+bool zenoh_query_param(const zenoh_query_ctx_t *query, const char *key, const char **value, size_t *len);
+bool zenoh_query_param_u32(const zenoh_query_ctx_t *query, const char *key, uint32_t *out);
+// Parses a comma separated list ("x,y,w,h"); returns how many values were read
+size_t zenoh_query_param_u32_list(const zenoh_query_ctx_t *query, const char *key, uint32_t *out, size_t max);
+
+// Queryable dispatch table
+// Serves GETs on keyexpr and below with a dedicated streaming provider, e.g.
+// KEYEXPR_QUERYABLE "/thumb" next to KEYEXPR_QUERYABLE "/meta". The provider of
+// the longest registered prefix wins; unmatched keys go to the providers above.
+// Keys outside KEYEXPR_QUERYABLE get a queryable of their own (ZENOH_EXTRA_QUERYABLES).
+// Segments are matched literally: keys with '*' / '**' segments are refused.
+// Returns 0 on success, -1 if the key has a wildcard or the tables are full.
+int zenoh_register_queryable(const char *keyexpr, zenoh_query_stream_provider_t provider, void *ctx);
+void zenoh_unregister_queryable(const char *keyexpr);
+
+#if SUBSCRIBER_ON
+// Subscriptions
+// Each subscription is a zenoh subscriber of its own, so zenoh matches the key
+// expression (wildcards allowed, e.g. "camera/*/faces") and only the matching
+// handler is called, with ctx as its arg. They survive reconnects and may be
+// made before the session is up. Samples also reach the main data handler if
+// they match KEYEXPR_SUB "/**"; pass a NULL data handler to the init function to
+// use subscriptions only. Returns a handle (>= 0), or -1 if the table is full or
+// the open session refused the subscriber.
+typedef int32_t zenoh_subscription_t;
+zenoh_subscription_t zenoh_subscribe(const char *keyexpr, z_data_handler_t handler, void *ctx);
+// Once it returns no new call starts; one already running may still finish.
+void zenoh_unsubscribe(zenoh_subscription_t handle);
+#endif
+
+#if I_AM_CONSUMER_OR_SERVER == 0
+// Reply handler of zenoh_get_data*: payload is the payload of an ok reply (NULL
+// for an error reply), decompressed if the replier compressed it (see
+// ZENOH_COMPRESSION_ON). The reply itself keeps the payload as received.
+typedef void (*zenoh_reply_handler_t)(z_loaned_reply_t *reply, const z_loaned_bytes_t *payload, void *arg);
+// Sends a GET on keyexpr; handler is called once per reply
+void zenoh_get_data(const char *keyexpr, zenoh_reply_handler_t handler, void *arg);
+// Same with selector parameters (e.g. "roi=0,0,64,64") and consolidation disabled,
+// so every reply of a streaming provider reaches handler
+void zenoh_get_data_params(const char *keyexpr, const char *parameters, zenoh_reply_handler_t handler, void *arg);
+// Sends a GET with the caller's own reply closure and options (drop callback,
+// timeout), under the session lock. The closure is consumed; without a session
+// it is dropped right away. Returns 0 if the GET went out, -1 otherwise.
+int zenoh_get_with_closure(const char *keyexpr, const char *parameters, z_owned_closure_reply_t *closure,
+        z_get_options_t *options);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,89 @@
+#ifndef ZENOH_PLATFORM_H
+#define ZENOH_PLATFORM_H
+
+/*
+ * The few calls that differ between the ESP32 and a host build. The host build
+ * is the ESP-IDF linux target (idf.py --preview set-target linux): FreeRTOS,
+ * esp_log, esp_timer and NVS come from IDF's POSIX ports, zenoh-pico uses its
+ * unix backend, and what only exists on the chip (PSRAM, esp_netif, the RNG,
+ * Wi-Fi IP events) is mapped here. See bench/ for the benchmark built that way.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+#define ZENOH_PLATFORM_HOST 1
+#else
+#define ZENOH_PLATFORM_HOST 0
+#endif
+
+#if ZENOH_PLATFORM_HOST
+#include <stdlib.h>
+#else
+#include "esp_heap_caps.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PSRAM (psram true) or internal RAM; the host has one heap for both
+static inline void *zenoh_platform_malloc(size_t size, bool psram) {
+#if ZENOH_PLATFORM_HOST
+    (void)psram;
+    return malloc(size);
+#else
+    return heap_caps_malloc(size, psram ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : MALLOC_CAP_8BIT);
+#endif
+}
+
+// Large buffers: PSRAM when there is some, internal RAM otherwise
+static inline void *zenoh_psram_malloc(size_t size) {
+    void *p = zenoh_platform_malloc(size, true);
+    return p != NULL ? p : zenoh_platform_malloc(size, false);
+}
+
+// Frees zenoh_psram_malloc() and heap_caps_malloc() buffers
+static inline void zenoh_psram_free(void *p) {
+#if ZENOH_PLATFORM_HOST
+    free(p);
+#else
+    heap_caps_free(p);
+#endif
+}
+
+static inline uint32_t zenoh_platform_random() {
+#if ZENOH_PLATFORM_HOST
+    return (uint32_t)random();
+#else
+    return esp_random();
+#endif
+}
+
+// Heap figures reported in heartbeats; 0 on the host
+static inline uint32_t zenoh_platform_free_heap() {
+#if ZENOH_PLATFORM_HOST
+    return 0;
+#else
+    return (uint32_t)esp_get_free_heap_size();
+#endif
+}
+
+static inline uint32_t zenoh_platform_min_free_heap() {
+#if ZENOH_PLATFORM_HOST
+    return 0;
+#else
+    return (uint32_t)esp_get_minimum_free_heap_size();
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_PLATFORM_H
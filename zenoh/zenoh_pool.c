@@ -0,0 +1,147 @@
+#include "zenoh_pool.h"
+
+#if ZENOH_PAYLOAD_POOL_ON // The entire file is conditionally compiled
+
+#define ZENOH_LOG_SUBSYSTEM POOL
+#include "zenoh_log.h"
+#include "zenoh_platform.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "Z_POOL";
+
+typedef struct {
+    size_t block_size;
+    uint16_t blocks;
+} pool_class_cfg_t;
+
+#define ZENOH_POOL_CLASS(size, count) { size, count },
+static const pool_class_cfg_t g_class_cfg[] = { ZENOH_PAYLOAD_POOL_CLASSES };
+#undef ZENOH_POOL_CLASS
+
+#define ZENOH_POOL_CLASS(size, count) + (count)
+enum { POOL_TOTAL_BLOCKS = 0 ZENOH_PAYLOAD_POOL_CLASSES };
+#undef ZENOH_POOL_CLASS
+
+#define POOL_CLASS_COUNT (sizeof(g_class_cfg) / sizeof(g_class_cfg[0]))
+
+typedef struct {
+    uint8_t *arena;   // blocks * block_size bytes, one allocation
+    uint16_t *free;   // stack of free block indices, slice of g_free_slots
+    uint16_t free_top;
+    uint16_t first;   // index of the class's first block in g_in_use
+    zenoh_pool_class_stats_t stats;
+} pool_class_t;
+
+static pool_class_t g_classes[POOL_CLASS_COUNT];
+static uint16_t g_free_slots[POOL_TOTAL_BLOCKS];
+static uint32_t g_in_use[(POOL_TOTAL_BLOCKS + 31) / 32]; // one bit per block, catches double releases
+static bool g_pool_ready = false;
+static portMUX_TYPE g_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+bool zenoh_payload_pool_init() {
+    if (g_pool_ready) { return true; }
+    bool ok = true;
+    size_t slot_offset = 0;
+    for (size_t c = 0; c < POOL_CLASS_COUNT; c++) {
+        pool_class_t *pc = &g_classes[c];
+        size_t bytes = g_class_cfg[c].block_size * g_class_cfg[c].blocks;
+        // PSRAM only: reserving the arenas in internal RAM would starve boards without PSRAM
+        pc->arena = (uint8_t *)zenoh_platform_malloc(bytes, true);
+        pc->free = &g_free_slots[slot_offset];
+        pc->first = (uint16_t)slot_offset;
+        slot_offset += g_class_cfg[c].blocks;
+        pc->stats.block_size = g_class_cfg[c].block_size;
+        pc->stats.blocks = 0;
+        pc->free_top = 0;
+        if (pc->arena == NULL) {
+            ZLOGW(TAG, "⚠️ No PSRAM for %u x %u B blocks, class disabled ⚠️",
+                    (unsigned)g_class_cfg[c].blocks, (unsigned)g_class_cfg[c].block_size);
+            ok = false;
+            continue;
+        }
+        pc->stats.blocks = g_class_cfg[c].blocks;
+        for (uint16_t i = 0; i < pc->stats.blocks; i++) {
+            pc->free[pc->free_top++] = (uint16_t)(pc->stats.blocks - 1 - i);
+        }
+        ZLOGI(TAG, "🧱 Pool class: %u x %u B", (unsigned)pc->stats.blocks, (unsigned)pc->stats.block_size);
+    }
+    g_pool_ready = true;
+    return ok;
+}
+
+uint8_t *zenoh_payload_acquire(size_t len) {
+    if (!g_pool_ready) { return NULL; }
+    uint8_t *block = NULL;
+    pool_class_t *best_fit = NULL;
+    portENTER_CRITICAL(&g_pool_lock);
+    for (size_t c = 0; c < POOL_CLASS_COUNT && block == NULL; c++) {
+        pool_class_t *pc = &g_classes[c];
+        if (pc->stats.block_size < len) { continue; }
+        if (best_fit == NULL) { best_fit = pc; }
+        if (pc->free_top == 0) { continue; }
+        uint16_t idx = pc->free[--pc->free_top];
+        uint32_t bit = pc->first + idx;
+        g_in_use[bit / 32] |= 1u << (bit % 32);
+        block = pc->arena + (size_t)idx * pc->stats.block_size;
+        pc->stats.in_use++;
+        if (pc->stats.in_use > pc->stats.high_water) { pc->stats.high_water = pc->stats.in_use; }
+    }
+    // One failure per request, on the class that should have served it
+    if (block == NULL && best_fit != NULL) { best_fit->stats.acquire_failures++; }
+    portEXIT_CRITICAL(&g_pool_lock);
+    if (block == NULL) {
+        ZLOGD_HOT(TAG, "No pool block for %u B", (unsigned)len);
+    }
+    return block;
+}
+
+// Returns the class owning ptr, or NULL.
+static pool_class_t *class_of(const void *ptr) {
+    const uint8_t *p = (const uint8_t *)ptr;
+    for (size_t c = 0; c < POOL_CLASS_COUNT; c++) {
+        pool_class_t *pc = &g_classes[c];
+        if (pc->arena != NULL && p >= pc->arena &&
+            p < pc->arena + (size_t)pc->stats.blocks * pc->stats.block_size) {
+            return pc;
+        }
+    }
+    return NULL;
+}
+
+bool zenoh_payload_pool_owns(const void *ptr) {
+    return g_pool_ready && ptr != NULL && class_of(ptr) != NULL;
+}
+
+void zenoh_payload_release(void *block) {
+    pool_class_t *pc = block ? class_of(block) : NULL;
+    if (pc == NULL) {
+        ZLOGE(TAG, "❗Release of %p which is not a pool block❗", block);
+        return;
+    }
+    size_t offset = (size_t)((uint8_t *)block - pc->arena);
+    if (offset % pc->stats.block_size != 0) {
+        ZLOGE(TAG, "❗Release of %p which is not the start of a pool block❗", block);
+        return;
+    }
+    uint16_t idx = (uint16_t)(offset / pc->stats.block_size);
+    uint32_t bit = pc->first + idx;
+    portENTER_CRITICAL(&g_pool_lock);
+    bool in_use = (g_in_use[bit / 32] & (1u << (bit % 32))) != 0;
+    if (in_use) {
+        g_in_use[bit / 32] &= ~(1u << (bit % 32));
+        pc->free[pc->free_top++] = idx;
+        pc->stats.in_use--;
+    }
+    portEXIT_CRITICAL(&g_pool_lock);
+    if (!in_use) { ZLOGE(TAG, "❗Double release of pool block %p❗", block); }
+}
+
+size_t zenoh_payload_pool_get_stats(zenoh_pool_class_stats_t *out, size_t max) {
+    size_t n = POOL_CLASS_COUNT < max ? POOL_CLASS_COUNT : max;
+    portENTER_CRITICAL(&g_pool_lock);
+    for (size_t c = 0; c < n; c++) { out[c] = g_classes[c].stats; }
+    portEXIT_CRITICAL(&g_pool_lock);
+    return n;
+}
+
+#endif // ZENOH_PAYLOAD_POOL_ON
@@ -0,0 +1,71 @@
+#ifndef ZENOH_POOL_H
+#define ZENOH_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "zenoh_config.h"
+
+#if ZENOH_PAYLOAD_POOL_ON
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Usage of one size class of the payload pool
+typedef struct {
+    size_t block_size;
+    uint16_t blocks;           // total blocks in the class
+    uint16_t in_use;           // blocks currently acquired
+    uint16_t high_water;       // most blocks ever acquired at once
+    uint32_t acquire_failures; // requests no class could serve while this one was the best fit
+} zenoh_pool_class_stats_t;
+
+/**
+ * @brief Allocates every size class once, in PSRAM only.
+ *
+ * A class that does not fit in PSRAM is disabled (zenoh_payload_acquire()
+ * returns NULL for its sizes), internal RAM is never reserved for the pool.
+ * Called by the manager on init; calling it again is a no-op.
+ * @return true if all classes were allocated.
+ */
+bool zenoh_payload_pool_init();
+
+/**
+ * @brief Takes a block of at least len bytes from the smallest fitting class.
+ *
+ * Falls back to the next bigger class when the fitting one is exhausted.
+ * The block can be handed to zenoh_publish_binary() (or any manager API that
+ * takes ownership of a buffer): the manager's deleter returns it to the pool.
+ *
+ * @param len Required size in bytes.
+ * @return The block, or NULL if no class can serve the request.
+ */
+uint8_t *zenoh_payload_acquire(size_t len);
+
+/**
+ * @brief Returns a block to its class. Safe to call from any task.
+ * A block released twice is logged and ignored.
+ * @param block Pointer previously returned by zenoh_payload_acquire().
+ */
+void zenoh_payload_release(void *block);
+
+/**
+ * @brief Tells whether ptr is a block of the payload pool.
+ */
+bool zenoh_payload_pool_owns(const void *ptr);
+
+/**
+ * @brief Copies per-class statistics into out.
+ * @param out Array of at least max entries.
+ * @param max Capacity of out.
+ * @return Number of classes written.
+ */
+size_t zenoh_payload_pool_get_stats(zenoh_pool_class_stats_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_PAYLOAD_POOL_ON
+#endif // ZENOH_POOL_H
@@ -1,47 +1,173 @@
 #include "zenoh_scout.h"
 #include "zenoh_config.h"
 #include "zenoh_utils.h"
+#include "zenoh_settings.h"
 #include <zenoh-pico.h>
-#include <esp_log.h>
+#define ZENOH_LOG_SUBSYSTEM SCOUT
+#include "zenoh_log.h"
+#include <esp_timer.h>
 #include <stdio.h>
-#include <stdlib.h>
+#include <string.h>
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "Z_SCUT";
 
+static zenoh_peer_t g_peers[ZENOH_SCOUT_MAX_PEERS];
+static size_t g_peer_count = 0;
+static portMUX_TYPE g_peers_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t scout_task_handle = NULL;
+static SemaphoreHandle_t g_exit_sem = NULL; // given by the task when it leaves, see zenoh_scout_stop()
+static volatile bool g_stopping = false;
+
+/**
+ * @brief Picks the locator of a hello to remember: the first one using
+ * the active transport, else the first one.
+ */
+static bool hello_locator(const z_loaned_hello_t *hello, char *out, size_t len) {
+    const z_loaned_string_array_t *locators = z_hello_locators(hello);
+    size_t n = z_string_array_len(locators);
+    size_t pick = n;
+    const char *proto = zenoh_settings()->protocol;
+    size_t proto_len = strlen(proto);
+    for (size_t i = 0; i < n && pick == n; i++) {
+        const z_loaned_string_t *loc = z_string_array_get(locators, i);
+        if (z_string_len(loc) > proto_len && strncmp(z_string_data(loc), proto, proto_len) == 0
+            && z_string_data(loc)[proto_len] == '/') {
+            pick = i;
+        }
+    }
+    if (n == 0) { return false; }
+    if (pick == n) { pick = 0; }
+    const z_loaned_string_t *loc = z_string_array_get(locators, pick);
+    snprintf(out, len, "%.*s", (int)z_string_len(loc), z_string_data(loc));
+    return true;
+}
+
 // Scout Functionality Callbacks
 static void scout_callback(z_loaned_hello_t *hello, void *context) {
-    z_id_t zid = z_hello_zid(hello);
-    char zid_str[sizeof(zid.id) * 2 + 1] = {0};
-    format_zid(&zid, zid_str, sizeof(zid_str));
-    ESP_LOGI(TAG, "SCOUT found peer '%s'", zid_str);
-    (*(int *)context)++;
-}
+    int *count = (int *)context;
+    zenoh_peer_t peer;
+    memset(&peer, 0, sizeof(peer));
+    peer.zid = z_hello_zid(hello);
+    peer.whatami = z_hello_whatami(hello);
+    peer.last_seen_us = esp_timer_get_time();
+    if (!hello_locator(hello, peer.locator, sizeof(peer.locator))) { return; }
 
-static void scout_drop(void *context) {
-    int count = *(int *)context;
-    free(context);
-    ESP_LOGI(TAG, "Scout found %d Zenoh instances.", count);
-    // NOTE: SCOUT CANNOT FIND AN ESP32 IN PEER MODE!
+    char zid_str[sizeof(peer.zid.id) * 2 + 1] = {0};
+    format_zid(&peer.zid, zid_str, sizeof(zid_str));
+    ZLOGI(TAG, "SCOUT found %s '%s' at %s",
+            peer.whatami == Z_WHATAMI_ROUTER ? "router" : "peer", zid_str, peer.locator);
+
+    taskENTER_CRITICAL(&g_peers_lock);
+    size_t slot = g_peer_count;
+    for (size_t i = 0; i < g_peer_count; i++) {
+        if (memcmp(g_peers[i].zid.id, peer.zid.id, sizeof(peer.zid.id)) == 0) { slot = i; break; }
+    }
+    if (slot == g_peer_count && g_peer_count == ZENOH_SCOUT_MAX_PEERS) {
+        // Table full: replace the entry seen longest ago
+        slot = 0;
+        for (size_t i = 1; i < g_peer_count; i++) {
+            if (g_peers[i].last_seen_us < g_peers[slot].last_seen_us) { slot = i; }
+        }
+    } else if (slot == g_peer_count) {
+        g_peer_count++;
+    }
+    g_peers[slot] = peer;
+    taskEXIT_CRITICAL(&g_peers_lock);
+    (*count)++;
 }
 
 // Scout Public Function
 void run_scout() {
-    ESP_LOGD(TAG, "Starting Zenoh scout...");
-    int *context = (int *)malloc(sizeof(int));
-    *context = 0;
+    ZLOGD(TAG, "Starting Zenoh scout...");
+    int count = 0;
 
     network_info_t net_info = active_network_interface("SCOUT");
     z_owned_config_t config;
     z_config_default(&config);
 
+    // Scouting goes to the multicast scouting locator, not to the connect key
     char scout_locator[64];
-    snprintf(scout_locator, sizeof(scout_locator), "%s/%s:%s#iface=%s",
-            ZENOH_PROTOCOL, ZENOH_LISTEN_BROADCAST_IP, 
-            ZENOH_PORT, net_info.interface_name);
-    ESP_LOGI(TAG, "SCOUT with locator: %s", scout_locator);
-    zp_config_insert(z_loan_mut(config), Z_CONFIG_CONNECT_KEY, scout_locator);
+    snprintf(scout_locator, sizeof(scout_locator), "%s#iface=%s",
+            ZENOH_SCOUT_MULTICAST_LOCATOR, net_info.interface_name);
+    ZLOGI(TAG, "SCOUT with locator: %s", scout_locator);
+    zp_config_insert(z_loan_mut(config), Z_CONFIG_MULTICAST_LOCATOR_KEY, scout_locator);
+
+    z_scout_options_t options;
+    z_scout_options_default(&options);
+    options.timeout_ms = ZENOH_SCOUT_TIMEOUT_MS;
+    options.what = Z_WHAT_ROUTER_PEER;
 
+    // z_scout returns once the timeout expired, so count can live on the stack
     z_owned_closure_hello_t closure;
-    z_closure_hello(&closure, scout_callback, scout_drop, context);
-    z_scout(z_move(config), z_move(closure), NULL);
+    z_closure_hello(&closure, scout_callback, NULL, &count);
+    z_scout(z_move(config), z_move(closure), &options);
+    ZLOGI(TAG, "Scout found %d Zenoh instances.", count);
+    // NOTE: zenoh-pico nodes do not answer scouts, only routers and zenohd peers do
+}
+
+// Runs until zenoh_scout_stop() sets g_stopping, then gives g_exit_sem and deletes itself
+static void scout_task(void *arg) {
+    EventGroupHandle_t event_group = (EventGroupHandle_t)arg;
+    while (!g_stopping) {
+        run_scout();
+        xEventGroupSetBits(event_group, ZENOH_SCOUT_DONE_BIT);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ZENOH_SCOUT_PERIOD_MS)); // zenoh_scout_stop() wakes it early
+    }
+    xSemaphoreGive(g_exit_sem);
+    vTaskDelete(NULL);
+}
+
+void zenoh_scout_start(EventGroupHandle_t event_group) {
+    if (scout_task_handle != NULL) { return; }
+    if (g_exit_sem == NULL) { g_exit_sem = xSemaphoreCreateBinary(); }
+    g_stopping = false;
+    xEventGroupClearBits(event_group, ZENOH_SCOUT_DONE_BIT);
+    if (xTaskCreatePinnedToCore(scout_task, "zenoh_scout", ZENOH_SCOUT_TASK_STACK, event_group, ZENOH_SCOUT_TASK_PRIO,
+            &scout_task_handle, ZENOH_SCOUT_TASK_CORE) != pdPASS) {
+        ZLOGE(TAG, "❗Unable to create the scout task❗");
+        scout_task_handle = NULL;
+    }
+}
+
+void zenoh_scout_stop() {
+    if (scout_task_handle != NULL) {
+        // A scout in progress owns its socket and config: let it run to its timeout
+        g_stopping = true;
+        xTaskNotifyGive(scout_task_handle);
+        xSemaphoreTake(g_exit_sem, portMAX_DELAY);
+        scout_task_handle = NULL;
+    }
+}
+
+size_t zenoh_scout_peers(zenoh_peer_t *out, size_t max) {
+    taskENTER_CRITICAL(&g_peers_lock);
+    size_t n = g_peer_count < max ? g_peer_count : max;
+    memcpy(out, g_peers, n * sizeof(zenoh_peer_t));
+    taskEXIT_CRITICAL(&g_peers_lock);
+    return n;
+}
+
+bool zenoh_scout_best_locator(char *out, size_t len) {
+    int64_t oldest = esp_timer_get_time() - (int64_t)ZENOH_SCOUT_PEER_TTL_MS * 1000;
+    bool found = false;
+    taskENTER_CRITICAL(&g_peers_lock);
+    const zenoh_peer_t *best = NULL;
+    for (size_t i = 0; i < g_peer_count; i++) {
+        const zenoh_peer_t *p = &g_peers[i];
+        if (p->last_seen_us < oldest) { continue; }
+        if (best == NULL
+            || (p->whatami == Z_WHATAMI_ROUTER && best->whatami != Z_WHATAMI_ROUTER)
+            || ((p->whatami == Z_WHATAMI_ROUTER) == (best->whatami == Z_WHATAMI_ROUTER) && p->last_seen_us > best->last_seen_us)) {
+            best = p;
+        }
+    }
+    if (best != NULL) {
+        strncpy(out, best->locator, len - 1);
+        out[len - 1] = '\0';
+        found = true;
+    }
+    taskEXIT_CRITICAL(&g_peers_lock);
+    return found;
 }
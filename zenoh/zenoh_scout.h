@@ -1,15 +1,64 @@
 #ifndef ZENOH_SCOUT_H
 #define ZENOH_SCOUT_H
 
+#include <zenoh-pico.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "zenoh_config.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// A node that answered a scout
+typedef struct {
+    z_id_t zid;
+    z_whatami_t whatami;                       // Z_WHATAMI_ROUTER, _PEER or _CLIENT
+    char locator[ZENOH_SCOUT_LOCATOR_MAX_LEN]; // preferred locator (active transport first)
+    int64_t last_seen_us;                      // esp_timer time of the last hello
+} zenoh_peer_t;
+
 /**
  * @brief Runs the Zenoh scout to discover peers on the network.
+ *
+ * One synchronous round of ZENOH_SCOUT_TIMEOUT_MS; answers go into the peer table.
  */
 void run_scout();
 
+/**
+ * @brief Starts the background scout task. Called by the manager on init.
+ *
+ * Scouts right away and then every ZENOH_SCOUT_PERIOD_MS; sets
+ * ZENOH_SCOUT_DONE_BIT after each round.
+ */
+void zenoh_scout_start(EventGroupHandle_t event_group);
+
+/**
+ * @brief Stops the background scout task. The peer table is kept.
+ *
+ * A scout in progress is let finish, so this can take up to ZENOH_SCOUT_TIMEOUT_MS.
+ */
+void zenoh_scout_stop();
+
+/**
+ * @brief Copies up to max entries of the peer table into out.
+ * @return Number of entries copied.
+ */
+size_t zenoh_scout_peers(zenoh_peer_t *out, size_t max);
+
+/**
+ * @brief Picks the locator to connect to from the peer table.
+ *
+ * Routers are preferred over peers, then the most recently seen node.
+ * Entries older than ZENOH_SCOUT_PEER_TTL_MS are ignored.
+ *
+ * @return true if a locator was copied into out.
+ */
+bool zenoh_scout_best_locator(char *out, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
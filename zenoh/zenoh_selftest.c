@@ -0,0 +1,339 @@
+#include "zenoh_selftest.h"
+
+#if ZENOH_SELFTEST_ON // The entire file is conditionally compiled
+
+#include "zenoh_manager.h"
+#define ZENOH_LOG_SUBSYSTEM SELFTEST
+#include "zenoh_log.h"
+#include <esp_timer.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "Z_SELFTEST";
+
+#define SELFTEST_KEY(suffix) ZENOH_SELFTEST_KEYEXPR suffix
+
+static const uint32_t k_sizes[] = {
+#define ZENOH_SELFTEST_SIZE(bytes) (uint32_t)(bytes),
+    ZENOH_SELFTEST_SIZES
+#undef ZENOH_SELFTEST_SIZE
+};
+#define SELFTEST_SIZE_COUNT (sizeof(k_sizes) / sizeof(k_sizes[0]))
+
+static zenoh_selftest_result_t g_results[SELFTEST_SIZE_COUNT];
+static size_t g_result_count = 0;
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;
+#define SELFTEST_MAX_SUBS 3
+static zenoh_subscription_t g_subs[SELFTEST_MAX_SUBS] = { -1, -1, -1 };
+static EventGroupHandle_t g_event_group = NULL;
+
+static uint32_t get_u32(const uint8_t *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint64_t get_u64(const uint8_t *p) { return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32); }
+static void put_u32(uint8_t *p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24); }
+static void put_u64(uint8_t *p, uint64_t v) { put_u32(p, (uint32_t)v); put_u32(p + 4, (uint32_t)(v >> 32)); }
+
+// Reads the first len bytes of a sample payload; false if it is shorter
+static bool read_header(const z_loaned_sample_t *sample, uint8_t *out, size_t len) {
+    return zenoh_bytes_read_at(z_sample_payload(sample), 0, out, len) == len;
+}
+
+static void publish_copy(const char *key, const uint8_t *data, size_t len) {
+    z_owned_bytes_t payload;
+    if (z_bytes_copy_from_buf(&payload, data, len) == Z_OK) {
+        zenoh_publish_bytes(key, &payload, NULL);
+    }
+}
+
+#if I_AM_CONSUMER_OR_SERVER == 1 // initiator
+
+static TaskHandle_t g_task = NULL;
+static SemaphoreHandle_t g_signal = NULL;
+static SemaphoreHandle_t g_exit_sem = NULL; // given by the task when it leaves, see zenoh_selftest_stop()
+static volatile bool g_stopping = false;
+// Filled by the handlers, consumed by the task under g_lock
+static uint32_t g_expect_run = 0;
+static uint32_t g_expect_seq = 0;
+static uint32_t g_last_rtt_us = 0;
+static uint8_t g_report[16];
+
+static void pong_handler(z_loaned_sample_t *sample, void *arg) {
+    (void)arg;
+    uint8_t hdr[ZENOH_SELFTEST_HEADER_LEN];
+    if (!read_header(sample, hdr, sizeof(hdr))) { return; }
+    bool match = false;
+    taskENTER_CRITICAL(&g_lock);
+    if (get_u32(hdr) == g_expect_run && get_u32(hdr + 4) == g_expect_seq) {
+        g_last_rtt_us = (uint32_t)(esp_timer_get_time() - (int64_t)get_u64(hdr + 8));
+        g_expect_seq = UINT32_MAX; // late duplicates do not count twice
+        match = true;
+    }
+    taskEXIT_CRITICAL(&g_lock);
+    if (match) { xSemaphoreGive(g_signal); }
+}
+
+static void report_handler(z_loaned_sample_t *sample, void *arg) {
+    (void)arg;
+    uint8_t report[sizeof(g_report)];
+    if (!read_header(sample, report, sizeof(report))) { return; }
+    bool match = false;
+    taskENTER_CRITICAL(&g_lock);
+    if (get_u32(report) == g_expect_run) {
+        memcpy(g_report, report, sizeof(report));
+        g_expect_run = UINT32_MAX;
+        match = true;
+    }
+    taskEXIT_CRITICAL(&g_lock);
+    if (match) { xSemaphoreGive(g_signal); }
+}
+
+static void expect(uint32_t run, uint32_t seq) {
+    taskENTER_CRITICAL(&g_lock);
+    g_expect_run = run;
+    g_expect_seq = seq;
+    taskEXIT_CRITICAL(&g_lock);
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void ping_pong(uint32_t run, uint8_t *buf, uint32_t size, uint32_t *rtt, zenoh_selftest_result_t *r) {
+    uint32_t n = 0;
+    put_u32(buf, run);
+    for (uint32_t seq = 0; seq < ZENOH_SELFTEST_PINGS && !g_stopping; seq++) {
+        while (xSemaphoreTake(g_signal, 0) == pdTRUE) { } // stale pong of a timed out ping
+        expect(run, seq);
+        put_u32(buf + 4, seq);
+        put_u64(buf + 8, (uint64_t)esp_timer_get_time());
+        z_owned_bytes_t payload;
+        // Serialized before the put returns, buf is reused for the next ping
+        if (z_bytes_from_static_buf(&payload, buf, size) != Z_OK) { break; }
+        if (zenoh_publish_bytes(SELFTEST_KEY("/ping"), &payload, NULL) < 0) { continue; }
+        if (xSemaphoreTake(g_signal, pdMS_TO_TICKS(ZENOH_SELFTEST_TIMEOUT_MS)) == pdTRUE) {
+            taskENTER_CRITICAL(&g_lock);
+            rtt[n++] = g_last_rtt_us;
+            taskEXIT_CRITICAL(&g_lock);
+        }
+    }
+    r->pings = n;
+    if (n > 0) {
+        qsort(rtt, n, sizeof(rtt[0]), compare_u32);
+        r->rtt_p50_us = rtt[(n - 1) * 50 / 100];
+        r->rtt_p99_us = rtt[(n - 1) * 99 / 100];
+        r->rtt_max_us = rtt[n - 1];
+    }
+}
+
+static void stream(uint32_t run, uint8_t *buf, uint32_t size, zenoh_selftest_result_t *r) {
+    uint32_t sent = 0;
+    put_u32(buf, run);
+    for (uint32_t seq = 0; seq < ZENOH_SELFTEST_STREAM_COUNT && !g_stopping; seq++) {
+        put_u32(buf + 4, seq);
+        put_u64(buf + 8, (uint64_t)esp_timer_get_time());
+        z_owned_bytes_t payload;
+        if (z_bytes_from_static_buf(&payload, buf, size) != Z_OK) { break; }
+        if (zenoh_publish_bytes(SELFTEST_KEY("/stream"), &payload, NULL) >= 0) { sent++; }
+    }
+    r->stream_sent = sent;
+    if (g_stopping) { return; }
+
+    while (xSemaphoreTake(g_signal, 0) == pdTRUE) { }
+    expect(run, UINT32_MAX);
+    uint8_t end[8];
+    put_u32(end, run);
+    put_u32(end + 4, sent);
+    publish_copy(SELFTEST_KEY("/end"), end, sizeof(end));
+    if (xSemaphoreTake(g_signal, pdMS_TO_TICKS(ZENOH_SELFTEST_TIMEOUT_MS)) != pdTRUE) {
+        ZLOGW(TAG, "⚠️ No stream report for %lu B ⚠️", (unsigned long)size);
+        return;
+    }
+    taskENTER_CRITICAL(&g_lock);
+    uint32_t received = get_u32(g_report + 4);
+    uint32_t bytes = get_u32(g_report + 8);
+    uint32_t span_us = get_u32(g_report + 12);
+    taskEXIT_CRITICAL(&g_lock);
+    if (span_us == 0) { span_us = 1; }
+    r->stream_received = received;
+    r->msgs_per_s = (uint32_t)((uint64_t)received * 1000000 / span_us);
+    r->kbytes_per_s = (uint32_t)((uint64_t)bytes * 1000 / span_us);
+    r->loss_permille = sent ? (uint16_t)((uint64_t)(sent > received ? sent - received : 0) * 1000 / sent) : 0;
+    r->valid = true;
+}
+
+static bool size_seen(size_t index) {
+    for (size_t i = 0; i < index; i++) {
+        if (k_sizes[i] == k_sizes[index]) { return true; }
+    }
+    return false;
+}
+
+/**
+ * @brief One sweep: ping-pong then streaming for every distinct payload size.
+ */
+static void run_sweep() {
+    static uint32_t run = 0;
+    uint32_t *rtt = (uint32_t *)malloc(ZENOH_SELFTEST_PINGS * sizeof(uint32_t));
+    if (rtt == NULL) { return; }
+    ZLOGI(TAG, "🧪 Self-test over %s, %d pings and %d stream messages per size",
+            zenoh_settings()->protocol, ZENOH_SELFTEST_PINGS, ZENOH_SELFTEST_STREAM_COUNT);
+    size_t count = 0;
+    for (size_t i = 0; i < SELFTEST_SIZE_COUNT && !g_stopping; i++) {
+        if (size_seen(i)) { continue; }
+        uint32_t size = k_sizes[i] < ZENOH_SELFTEST_HEADER_LEN ? ZENOH_SELFTEST_HEADER_LEN : k_sizes[i];
+        uint8_t *buf = (uint8_t *)calloc(1, size);
+        if (buf == NULL) {
+            ZLOGE(TAG, "❗No memory for %lu B payloads❗", (unsigned long)size);
+            continue;
+        }
+        zenoh_selftest_result_t r = { .size = size };
+        ping_pong(run++, buf, size, rtt, &r);
+        stream(run++, buf, size, &r);
+        free(buf);
+        if (g_stopping) { break; } // partial results are not kept
+        ZLOGI(TAG, "%6lu B | RTT p50 %6lu us p99 %6lu us max %6lu us (%lu/%d) | %6lu msg/s %6lu kB/s loss %u.%u%%",
+                (unsigned long)size, (unsigned long)r.rtt_p50_us, (unsigned long)r.rtt_p99_us,
+                (unsigned long)r.rtt_max_us, (unsigned long)r.pings, ZENOH_SELFTEST_PINGS,
+                (unsigned long)r.msgs_per_s, (unsigned long)r.kbytes_per_s,
+                r.loss_permille / 10, r.loss_permille % 10);
+        taskENTER_CRITICAL(&g_lock);
+        g_results[count++] = r;
+        g_result_count = count;
+        taskEXIT_CRITICAL(&g_lock);
+    }
+    free(rtt);
+    ZLOGI(TAG, "🧪 Self-test %s", g_stopping ? "stopped" : "done");
+}
+
+// Runs until zenoh_selftest_stop() sets g_stopping, then gives g_exit_sem and deletes itself
+static void selftest_task(void *arg) {
+    (void)arg;
+    while (!g_stopping) {
+        while (!g_stopping && (xEventGroupWaitBits(g_event_group, ZENOH_DECLARED_BIT, pdFALSE, pdFALSE,
+                    pdMS_TO_TICKS(100)) & ZENOH_DECLARED_BIT) == 0) {}
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ZENOH_SELFTEST_START_DELAY_MS)); // the responder declares too
+        if (g_stopping) { break; }
+        run_sweep();
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    xSemaphoreGive(g_exit_sem);
+    vTaskDelete(NULL);
+}
+
+#else // responder
+
+// Current stream run, updated by the stream handler
+static struct {
+    uint32_t run;
+    uint32_t received;
+    uint32_t bytes;
+    int64_t first_us;
+    int64_t last_us;
+} g_rx = { UINT32_MAX, 0, 0, 0, 0 };
+
+static void ping_handler(z_loaned_sample_t *sample, void *arg) {
+    (void)arg;
+    // The echo shares the received buffers, nothing is copied
+    z_owned_bytes_t payload;
+    if (zenoh_sample_retain_payload(sample, &payload) == 0) {
+        zenoh_publish_bytes(SELFTEST_KEY("/pong"), &payload, NULL);
+    }
+}
+
+static void stream_handler(z_loaned_sample_t *sample, void *arg) {
+    (void)arg;
+    uint8_t hdr[4];
+    if (!read_header(sample, hdr, sizeof(hdr))) { return; }
+    uint32_t run = get_u32(hdr);
+    uint32_t len = (uint32_t)z_bytes_len(z_sample_payload(sample));
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&g_lock);
+    if (run != g_rx.run) {
+        g_rx.run = run;
+        g_rx.received = 0;
+        g_rx.bytes = 0;
+        g_rx.first_us = now;
+    }
+    g_rx.received++;
+    g_rx.bytes += len;
+    g_rx.last_us = now;
+    taskEXIT_CRITICAL(&g_lock);
+}
+
+static void end_handler(z_loaned_sample_t *sample, void *arg) {
+    (void)arg;
+    uint8_t end[8];
+    if (!read_header(sample, end, sizeof(end))) { return; }
+    uint32_t run = get_u32(end);
+    uint8_t report[16] = { 0 };
+    put_u32(report, run);
+    taskENTER_CRITICAL(&g_lock);
+    if (g_rx.run == run) {
+        put_u32(report + 4, g_rx.received);
+        put_u32(report + 8, g_rx.bytes);
+        put_u32(report + 12, (uint32_t)(g_rx.last_us - g_rx.first_us));
+    }
+    taskEXIT_CRITICAL(&g_lock);
+    ZLOGD(TAG, "Stream run %lu: %lu/%lu received", (unsigned long)run,
+            (unsigned long)get_u32(report + 4), (unsigned long)get_u32(end + 4));
+    publish_copy(SELFTEST_KEY("/report"), report, sizeof(report));
+}
+
+#endif // I_AM_CONSUMER_OR_SERVER
+
+void zenoh_selftest_start(EventGroupHandle_t event_group) {
+    g_event_group = event_group;
+#if I_AM_CONSUMER_OR_SERVER == 1
+    if (g_task != NULL) { return; }
+    if (g_signal == NULL) { g_signal = xSemaphoreCreateBinary(); }
+    if (g_exit_sem == NULL) { g_exit_sem = xSemaphoreCreateBinary(); }
+    g_stopping = false;
+    g_subs[0] = zenoh_subscribe(SELFTEST_KEY("/pong"), pong_handler, NULL);
+    g_subs[1] = zenoh_subscribe(SELFTEST_KEY("/report"), report_handler, NULL);
+    xTaskCreatePinnedToCore(selftest_task, "zenoh_selftest", ZENOH_SELFTEST_TASK_STACK, NULL, ZENOH_SELFTEST_TASK_PRIO,
+            &g_task, ZENOH_SELFTEST_TASK_CORE);
+#else
+    if (g_subs[0] >= 0) { return; }
+    g_subs[0] = zenoh_subscribe(SELFTEST_KEY("/ping"), ping_handler, NULL);
+    g_subs[1] = zenoh_subscribe(SELFTEST_KEY("/stream"), stream_handler, NULL);
+    g_subs[2] = zenoh_subscribe(SELFTEST_KEY("/end"), end_handler, NULL);
+#endif
+    if (g_subs[0] < 0 || g_subs[1] < 0 || (I_AM_CONSUMER_OR_SERVER == 0 && g_subs[2] < 0)) {
+        ZLOGE(TAG, "❗Self-test subscriptions failed, raise ZENOH_MAX_SUBSCRIPTIONS❗");
+    }
+}
+
+void zenoh_selftest_stop() {
+#if I_AM_CONSUMER_OR_SERVER == 1
+    if (g_task != NULL) {
+        // Deleting it mid-sweep would leak its buffers: wake whatever it waits on instead
+        g_stopping = true;
+        xSemaphoreGive(g_signal);
+        xTaskNotifyGive(g_task);
+        xSemaphoreTake(g_exit_sem, portMAX_DELAY);
+        g_task = NULL;
+    }
+#endif
+    for (size_t i = 0; i < SELFTEST_MAX_SUBS; i++) {
+        if (g_subs[i] >= 0) { zenoh_unsubscribe(g_subs[i]); }
+        g_subs[i] = -1;
+    }
+}
+
+void zenoh_selftest_run() {
+#if I_AM_CONSUMER_OR_SERVER == 1
+    if (g_task != NULL) { xTaskNotifyGive(g_task); }
+#endif
+}
+
+size_t zenoh_selftest_results(zenoh_selftest_result_t *out, size_t max) {
+    taskENTER_CRITICAL(&g_lock);
+    size_t n = g_result_count < max ? g_result_count : max;
+    memcpy(out, g_results, n * sizeof(out[0]));
+    taskEXIT_CRITICAL(&g_lock);
+    return n;
+}
+
+#endif // ZENOH_SELFTEST_ON
@@ -0,0 +1,71 @@
+#ifndef ZENOH_SELFTEST_H
+#define ZENOH_SELFTEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "zenoh_config.h"
+
+#if ZENOH_SELFTEST_ON
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Self-test wire format on ZENOH_SELFTEST_KEYEXPR, little endian:
+ *   "/ping", "/pong", "/stream": u32 run   u32 seq   u64 sent_us (initiator clock), padding
+ *   "/end":    u32 run   u32 sent
+ *   "/report": u32 run   u32 received   u32 bytes   u32 span_us (first to last sample)
+ * The responder echoes pings unchanged on "/pong" and reports each stream run.
+ */
+#define ZENOH_SELFTEST_HEADER_LEN 16
+
+// Result of one payload size
+typedef struct {
+    uint32_t size;           // payload bytes
+    uint32_t pings;          // pongs received out of ZENOH_SELFTEST_PINGS
+    uint32_t rtt_p50_us;
+    uint32_t rtt_p99_us;
+    uint32_t rtt_max_us;
+    uint32_t stream_sent;    // puts accepted by zenoh
+    uint32_t stream_received;
+    uint32_t msgs_per_s;     // as received by the responder
+    uint32_t kbytes_per_s;
+    uint16_t loss_permille;  // stream messages that never arrived
+    bool valid;              // false if the responder did not report
+} zenoh_selftest_result_t;
+
+/**
+ * @brief Starts the self-test. Called by the manager on init.
+ *
+ * The consumer (initiator) runs the sweep once the resources are declared and
+ * again on zenoh_selftest_run(); the server (responder) echoes and counts.
+ */
+void zenoh_selftest_start(EventGroupHandle_t event_group);
+
+/**
+ * @brief Stops the self-test task and drops its subscriptions. Results are kept.
+ */
+void zenoh_selftest_stop();
+
+/**
+ * @brief Runs the sweep again (initiator only); returns immediately.
+ */
+void zenoh_selftest_run();
+
+/**
+ * @brief Copies up to max results of the latest sweep, one per payload size.
+ * @return Number of results copied.
+ */
+size_t zenoh_selftest_results(zenoh_selftest_result_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_SELFTEST_ON
+
+#endif // ZENOH_SELFTEST_H
@@ -0,0 +1,128 @@
+/*
+ * zenoh_settings.c
+ *
+ * Runtime settings with zenoh_config.h defaults and NVS overrides.
+ */
+
+#include "zenoh_settings.h"
+
+#define ZENOH_LOG_SUBSYSTEM SETTINGS
+#include "zenoh_log.h"
+#include <string.h>
+#include <stdio.h>
+#include "nvs.h"
+
+static const char *TAG = "Z_SETTINGS";
+
+static const zenoh_settings_t g_defaults = {
+    .mode = ZENOH_MODE,
+    .protocol = ZENOH_PROTOCOL,
+    .listen_ip = ZENOH_LISTEN_BROADCAST_IP,
+    .port = ZENOH_PORT,
+#if HEARTBEAT_ON
+    .heartbeat_interval_ms = HEARTBEAT_INTERVAL_MS,
+#endif
+#if ZENOH_BATCHING_ON
+    .batching = true,
+    .batch_latency_ms = ZENOH_BATCH_MAX_LATENCY_MS,
+#endif
+};
+
+// Written once by zenoh_settings_apply() during zenoh_client_init, before any task reads it
+static zenoh_settings_t g_active;
+static bool g_applied = false;
+
+void zenoh_settings_defaults(zenoh_settings_t *out) {
+    *out = g_defaults;
+}
+
+static void load_str(nvs_handle_t nvs, const char *key, char *out, size_t len) {
+    size_t size = len;
+    if (nvs_get_str(nvs, key, out, &size) == ESP_OK) {
+        ZLOGI(TAG, "NVS %s = '%s'", key, out);
+    }
+}
+
+// Like load_str, but anything other than choice_a or choice_b keeps the default
+static void load_choice(nvs_handle_t nvs, const char *key, char *out, size_t len,
+        const char *choice_a, const char *choice_b) {
+    char value[16];
+    size_t size = sizeof(value);
+    if (nvs_get_str(nvs, key, value, &size) != ESP_OK) { return; }
+    if ((strcmp(value, choice_a) != 0 && strcmp(value, choice_b) != 0) || strlen(value) >= len) {
+        ZLOGW(TAG, "⚠️ NVS %s = '%s' is not '%s' or '%s', keeping '%s' ⚠️", key, value, choice_a, choice_b, out);
+        return;
+    }
+    strcpy(out, value);
+    ZLOGI(TAG, "NVS %s = '%s'", key, out);
+}
+
+int zenoh_settings_load(zenoh_settings_t *out) {
+    zenoh_settings_defaults(out);
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(ZENOH_SETTINGS_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err == ESP_ERR_NVS_NOT_FOUND) { return 0; } // nothing stored yet
+    if (err != ESP_OK) {
+        ZLOGW(TAG, "NVS open failed (%s), using defaults", esp_err_to_name(err));
+        return -1;
+    }
+    char default_protocol[sizeof(out->protocol)];
+    strcpy(default_protocol, out->protocol);
+    load_choice(nvs, "mode", out->mode, sizeof(out->mode), "peer", "client");
+    load_choice(nvs, "proto", out->protocol, sizeof(out->protocol), "udp", "tcp");
+    if (strcmp(out->protocol, default_protocol) != 0) {
+        // Transport switched in the field: start from that transport's listen default
+        snprintf(out->listen_ip, sizeof(out->listen_ip), "%s",
+                strcmp(out->protocol, "udp") == 0 ? ZENOH_UDP_MULTICAST_IP : "");
+    }
+    load_str(nvs, "listen_ip", out->listen_ip, sizeof(out->listen_ip));
+    load_str(nvs, "port", out->port, sizeof(out->port));
+    load_str(nvs, "connect", out->connect, sizeof(out->connect));
+    uint32_t u32;
+    uint16_t u16;
+    uint8_t u8;
+    if (nvs_get_u32(nvs, "hb_ms", &u32) == ESP_OK && u32 > 0) { out->heartbeat_interval_ms = u32; }
+    if (nvs_get_u8(nvs, "batch", &u8) == ESP_OK) { out->batching = u8 != 0; }
+    if (nvs_get_u16(nvs, "batch_ms", &u16) == ESP_OK && u16 > 0) { out->batch_latency_ms = u16; }
+    nvs_close(nvs);
+    return 0;
+}
+
+int zenoh_settings_save(const zenoh_settings_t *s) {
+    nvs_handle_t nvs;
+    if (nvs_open(ZENOH_SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        ZLOGE(TAG, "❗NVS open for write failed❗");
+        return -1;
+    }
+    esp_err_t err = nvs_set_str(nvs, "mode", s->mode);
+    if (err == ESP_OK) { err = nvs_set_str(nvs, "proto", s->protocol); }
+    if (err == ESP_OK) { err = nvs_set_str(nvs, "listen_ip", s->listen_ip); }
+    if (err == ESP_OK) { err = nvs_set_str(nvs, "port", s->port); }
+    if (err == ESP_OK) { err = nvs_set_str(nvs, "connect", s->connect); }
+    if (err == ESP_OK) { err = nvs_set_u32(nvs, "hb_ms", s->heartbeat_interval_ms); }
+    if (err == ESP_OK) { err = nvs_set_u8(nvs, "batch", s->batching ? 1 : 0); }
+    if (err == ESP_OK) { err = nvs_set_u16(nvs, "batch_ms", s->batch_latency_ms); }
+    if (err == ESP_OK) { err = nvs_commit(nvs); }
+    nvs_close(nvs);
+    if (err != ESP_OK) {
+        ZLOGE(TAG, "❗NVS write failed (%s)❗", esp_err_to_name(err));
+        return -1;
+    }
+    return 0;
+}
+
+void zenoh_settings_apply(const zenoh_settings_t *settings) {
+    g_active = *settings;
+    g_applied = true;
+    ZLOGI(TAG, "Settings: %s over %s, listen '%s', port %s, connect '%s', batching %s",
+            g_active.mode, g_active.protocol, g_active.listen_ip, g_active.port, g_active.connect,
+            g_active.batching ? "on" : "off");
+}
+
+const zenoh_settings_t *zenoh_settings() {
+    return g_applied ? &g_active : &g_defaults;
+}
+
+bool zenoh_settings_is_tcp() {
+    return strcmp(zenoh_settings()->protocol, "tcp") == 0;
+}
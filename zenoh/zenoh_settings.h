@@ -0,0 +1,73 @@
+#ifndef ZENOH_SETTINGS_H
+#define ZENOH_SETTINGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "zenoh_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Runtime settings. The zenoh_config.h macros are the defaults; a device can
+ * override them from NVS (namespace ZENOH_SETTINGS_NVS_NAMESPACE) or the
+ * application can pass its own copy to zenoh_client_init_with_settings().
+ * Role, feature flags and key expressions select compiled code and stay in
+ * zenoh_config.h.
+ *
+ * NVS keys: "mode", "proto", "listen_ip", "port", "connect" (strings),
+ * "hb_ms" (u32), "batch" (u8), "batch_ms" (u16).
+ */
+typedef struct {
+    char mode[8];                    // "peer" or "client" (ZENOH_MODE)
+    char protocol[4];                // "udp" or "tcp" (ZENOH_PROTOCOL)
+    char listen_ip[16];              // UDP multicast group (ZENOH_LISTEN_BROADCAST_IP)
+    char port[6];                    // ZENOH_PORT
+    char connect[ZENOH_SCOUT_LOCATOR_MAX_LEN]; // TCP consumer: fixed endpoint, "" = ZENOH_CONNECT_ENDPOINTS
+    uint32_t heartbeat_interval_ms;  // HEARTBEAT_INTERVAL_MS
+    bool batching;                   // ZENOH_BATCHING_ON at runtime
+    uint16_t batch_latency_ms;       // ZENOH_BATCH_MAX_LATENCY_MS
+} zenoh_settings_t;
+
+/**
+ * @brief Fills *out with the zenoh_config.h defaults.
+ */
+void zenoh_settings_defaults(zenoh_settings_t *out);
+
+/**
+ * @brief Fills *out with the defaults overridden by the values stored in NVS.
+ * @return 0 on success (also when nothing is stored), -1 if NVS could not be read.
+ */
+int zenoh_settings_load(zenoh_settings_t *out);
+
+/**
+ * @brief Stores settings in NVS; they apply from the next start.
+ * @return 0 on success, -1 on failure.
+ */
+int zenoh_settings_save(const zenoh_settings_t *settings);
+
+/**
+ * @brief Makes a copy of settings the active set.
+ *
+ * Called once by zenoh_client_init_and_start/zenoh_client_init_with_settings,
+ * before any of the manager's tasks run.
+ */
+void zenoh_settings_apply(const zenoh_settings_t *settings);
+
+/**
+ * @brief Active settings (the defaults until zenoh_settings_apply()).
+ */
+const zenoh_settings_t *zenoh_settings();
+
+/**
+ * @brief True when the active transport is TCP.
+ */
+bool zenoh_settings_is_tcp();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_SETTINGS_H
@@ -0,0 +1,173 @@
+/*
+ * zenoh_stats.c
+ *
+ * Counters and latency histograms of the manager's hot paths. Every update is
+ * a relaxed atomic add (max: compare-and-swap). The 32-bit counters are
+ * lock-free; the 64-bit totals (publish bytes, latency sums, the downtime
+ * clock) are not on Xtensa, where libatomic wraps them in a short critical
+ * section. Either way recording never waits on a mutex.
+ */
+
+#include "zenoh_stats.h"
+
+#if ZENOH_STATS_ON // The entire file is conditionally compiled
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <esp_timer.h>
+#include "zenoh_pool.h"
+
+typedef struct {
+    atomic_uint count;
+    atomic_uint max_us;
+    atomic_ullong total_us;
+    atomic_uint buckets[ZENOH_STATS_HIST_BUCKETS];
+} hist_t;
+
+static atomic_uint g_publishes;
+static atomic_ullong g_publish_bytes;
+static atomic_uint g_put_failures;
+static atomic_uint g_publish_drops;
+static hist_t g_hists[ZENOH_STATS_HIST_COUNT];
+static atomic_uint g_reconnects;
+static atomic_uint g_downtime_ms;
+static atomic_uint g_last_downtime_ms;
+static atomic_llong g_down_since_us; // 0 while a session is up (or before the first one)
+
+static void hist_add(hist_t *h, uint32_t us) {
+    uint32_t bucket = us > 1 ? 31 - __builtin_clz(us) : 0;
+    if (bucket >= ZENOH_STATS_HIST_BUCKETS) { bucket = ZENOH_STATS_HIST_BUCKETS - 1; }
+    atomic_fetch_add_explicit(&h->buckets[bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->total_us, us, memory_order_relaxed);
+    unsigned int max = atomic_load_explicit(&h->max_us, memory_order_relaxed);
+    while (us > max && !atomic_compare_exchange_weak_explicit(&h->max_us, &max, us,
+            memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static void hist_read(hist_t *h, zenoh_stats_hist_t *out) {
+    out->count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    out->max_us = atomic_load_explicit(&h->max_us, memory_order_relaxed);
+    unsigned long long total = atomic_load_explicit(&h->total_us, memory_order_relaxed);
+    out->avg_us = out->count ? (uint32_t)(total / out->count) : 0;
+    for (size_t i = 0; i < ZENOH_STATS_HIST_BUCKETS; i++) {
+        out->buckets[i] = atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+    }
+}
+
+void zenoh_stats_record_put(size_t bytes, z_result_t res, uint32_t latency_us) {
+    if (res < 0) {
+        atomic_fetch_add_explicit(&g_put_failures, 1, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&g_publishes, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&g_publish_bytes, bytes, memory_order_relaxed);
+    }
+    hist_add(&g_hists[ZENOH_STATS_PUT], latency_us);
+}
+
+void zenoh_stats_record_drop() {
+    atomic_fetch_add_explicit(&g_publish_drops, 1, memory_order_relaxed);
+}
+
+void zenoh_stats_record_latency(zenoh_stats_hist_id_t hist, uint32_t us) {
+    if (hist < ZENOH_STATS_HIST_COUNT) { hist_add(&g_hists[hist], us); }
+}
+
+void zenoh_stats_session_down() {
+    long long expected = 0;
+    atomic_compare_exchange_strong(&g_down_since_us, &expected, esp_timer_get_time());
+}
+
+void zenoh_stats_session_up() {
+    long long since = atomic_exchange(&g_down_since_us, 0);
+    if (since == 0) { return; } // first open
+    uint32_t down_ms = (uint32_t)((esp_timer_get_time() - since) / 1000);
+    atomic_fetch_add_explicit(&g_reconnects, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_downtime_ms, down_ms, memory_order_relaxed);
+    atomic_store_explicit(&g_last_downtime_ms, down_ms, memory_order_relaxed);
+}
+
+void zenoh_get_stats(zenoh_stats_t *out) {
+    out->publishes = atomic_load_explicit(&g_publishes, memory_order_relaxed);
+    out->publish_bytes = atomic_load_explicit(&g_publish_bytes, memory_order_relaxed);
+    out->put_failures = atomic_load_explicit(&g_put_failures, memory_order_relaxed);
+    out->publish_drops = atomic_load_explicit(&g_publish_drops, memory_order_relaxed);
+    hist_read(&g_hists[ZENOH_STATS_PUT], &out->put_latency);
+    hist_read(&g_hists[ZENOH_STATS_HANDLER], &out->handler_latency);
+    hist_read(&g_hists[ZENOH_STATS_QUERY], &out->query_latency);
+    out->reconnects = atomic_load_explicit(&g_reconnects, memory_order_relaxed);
+    out->downtime_ms = atomic_load_explicit(&g_downtime_ms, memory_order_relaxed);
+    out->last_downtime_ms = atomic_load_explicit(&g_last_downtime_ms, memory_order_relaxed);
+
+    out->pool_blocks = out->pool_in_use = out->pool_high_water = out->pool_failures = 0;
+#if ZENOH_PAYLOAD_POOL_ON
+#define ZENOH_POOL_CLASS(size, count) + 1
+    zenoh_pool_class_stats_t classes[0 ZENOH_PAYLOAD_POOL_CLASSES];
+#undef ZENOH_POOL_CLASS
+    size_t n = zenoh_payload_pool_get_stats(classes, sizeof(classes) / sizeof(classes[0]));
+    for (size_t i = 0; i < n; i++) {
+        out->pool_blocks += classes[i].blocks;
+        out->pool_in_use += classes[i].in_use;
+        out->pool_high_water += classes[i].high_water;
+        out->pool_failures += classes[i].acquire_failures;
+    }
+#endif
+}
+
+void zenoh_stats_reset() {
+    atomic_store(&g_publishes, 0);
+    atomic_store(&g_publish_bytes, 0);
+    atomic_store(&g_put_failures, 0);
+    atomic_store(&g_publish_drops, 0);
+    for (size_t h = 0; h < ZENOH_STATS_HIST_COUNT; h++) {
+        atomic_store(&g_hists[h].count, 0);
+        atomic_store(&g_hists[h].max_us, 0);
+        atomic_store(&g_hists[h].total_us, 0);
+        for (size_t i = 0; i < ZENOH_STATS_HIST_BUCKETS; i++) { atomic_store(&g_hists[h].buckets[i], 0); }
+    }
+    atomic_store(&g_reconnects, 0);
+    atomic_store(&g_downtime_ms, 0);
+    atomic_store(&g_last_downtime_ms, 0);
+}
+
+// snprintf at offset *n of buf, keeping *n the would-be length like snprintf
+static void appendf(char *buf, size_t len, int *n, const char *fmt, ...) {
+    size_t at = *n < (int)len ? (size_t)*n : len;
+    va_list ap;
+    va_start(ap, fmt);
+    int w = vsnprintf(buf + at, len - at, fmt, ap);
+    va_end(ap);
+    if (w > 0) { *n += w; }
+}
+
+static void format_hist(const char *name, const zenoh_stats_hist_t *h, char *buf, size_t len, int *n) {
+    appendf(buf, len, n, ",\"%s\":{\"n\":%lu,\"avg_us\":%lu,\"max_us\":%lu,\"log2_us\":[", name,
+            (unsigned long)h->count, (unsigned long)h->avg_us, (unsigned long)h->max_us);
+    for (size_t i = 0; i < ZENOH_STATS_HIST_BUCKETS; i++) {
+        appendf(buf, len, n, "%s%lu", i ? "," : "", (unsigned long)h->buckets[i]);
+    }
+    appendf(buf, len, n, "]}");
+}
+
+int zenoh_stats_format(const zenoh_stats_t *s, char *buf, size_t len) {
+    int n = 0;
+    if (len > 0) { buf[0] = '\0'; }
+    appendf(buf, len, &n,
+            "{\"pub\":%lu,\"pub_bytes\":%llu,\"put_fail\":%lu,\"drops\":%lu,"
+            "\"reconnects\":%lu,\"down_ms\":%lu,\"last_down_ms\":%lu,"
+            "\"pool\":{\"blocks\":%lu,\"in_use\":%lu,\"high\":%lu,\"fail\":%lu}",
+            (unsigned long)s->publishes, (unsigned long long)s->publish_bytes,
+            (unsigned long)s->put_failures, (unsigned long)s->publish_drops,
+            (unsigned long)s->reconnects, (unsigned long)s->downtime_ms, (unsigned long)s->last_downtime_ms,
+            (unsigned long)s->pool_blocks, (unsigned long)s->pool_in_use,
+            (unsigned long)s->pool_high_water, (unsigned long)s->pool_failures);
+    format_hist("put", &s->put_latency, buf, len, &n);
+    format_hist("handler", &s->handler_latency, buf, len, &n);
+    format_hist("query", &s->query_latency, buf, len, &n);
+    appendf(buf, len, &n, "}");
+    return n;
+}
+
+#endif // ZENOH_STATS_ON
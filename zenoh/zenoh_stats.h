@@ -0,0 +1,96 @@
+#ifndef ZENOH_STATS_H
+#define ZENOH_STATS_H
+
+#include <zenoh-pico.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "zenoh_config.h"
+
+#if ZENOH_STATS_ON
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Latency histogram. Bucket i counts durations in [2^i, 2^(i+1)) us (bucket 0
+// also takes 0 us), the last bucket everything above.
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint32_t avg_us;
+    uint32_t buckets[ZENOH_STATS_HIST_BUCKETS];
+} zenoh_stats_hist_t;
+
+// Manager counters, totals since start (or zenoh_stats_reset()) unless noted
+typedef struct {
+    uint32_t publishes;                  // puts accepted by zenoh
+    uint64_t publish_bytes;              // payload bytes of those puts
+    uint32_t put_failures;               // z_put / z_publisher_put returned an error
+    uint32_t publish_drops;              // never reached zenoh (no session or publisher, no memory)
+    zenoh_stats_hist_t put_latency;      // time spent in the put call
+    zenoh_stats_hist_t handler_latency;  // subscriber data handler calls
+    zenoh_stats_hist_t query_latency;    // GET served by the queryable, first to last reply
+    uint32_t reconnects;                 // sessions reopened after a loss
+    uint32_t downtime_ms;                // time without a session between a loss and the reopen
+    uint32_t last_downtime_ms;           // duration of the latest outage
+    uint32_t pool_blocks;                // payload pool, all classes (current values)
+    uint32_t pool_in_use;
+    uint32_t pool_high_water;
+    uint32_t pool_failures;
+} zenoh_stats_t;
+
+typedef enum {
+    ZENOH_STATS_PUT = 0,
+    ZENOH_STATS_HANDLER,
+    ZENOH_STATS_QUERY,
+    ZENOH_STATS_HIST_COUNT
+} zenoh_stats_hist_id_t;
+
+/**
+ * @brief Counts one put handed to zenoh and its latency. Called by the manager.
+ * @param res Result of the put; failures count in put_failures.
+ */
+void zenoh_stats_record_put(size_t bytes, z_result_t res, uint32_t latency_us);
+
+/**
+ * @brief Counts a publication dropped before reaching zenoh.
+ */
+void zenoh_stats_record_drop();
+
+/**
+ * @brief Adds one duration to a histogram.
+ */
+void zenoh_stats_record_latency(zenoh_stats_hist_id_t hist, uint32_t us);
+
+/**
+ * @brief Session lost: starts the downtime clock.
+ */
+void zenoh_stats_session_down();
+
+/**
+ * @brief Session (re)opened: counts a reconnect if it follows a loss.
+ */
+void zenoh_stats_session_up();
+
+/**
+ * @brief Copies every counter into *out. Safe from any task, takes no mutex.
+ */
+void zenoh_get_stats(zenoh_stats_t *out);
+
+/**
+ * @brief Zeroes the totals and histograms (not the pool values).
+ */
+void zenoh_stats_reset();
+
+/**
+ * @brief Formats stats as one JSON object, the payload published on the stats key.
+ * @return Length written (snprintf semantics).
+ */
+int zenoh_stats_format(const zenoh_stats_t *stats, char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_STATS_ON
+#endif // ZENOH_STATS_H
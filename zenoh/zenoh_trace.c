@@ -0,0 +1,195 @@
+/*
+ * zenoh_trace.c
+ *
+ * Sequence numbers and send timestamps on data publications, and the
+ * receiving side: per-publisher gaps, reordering and one-way latency.
+ */
+
+#include "zenoh_trace.h"
+
+#if ZENOH_TRACE_ON // The entire file is conditionally compiled
+
+#include "zenoh_attachment.h"
+#include "zenoh_heartbeat.h"
+#define ZENOH_LOG_SUBSYSTEM TRACE
+#include "zenoh_log.h"
+#include <esp_timer.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "Z_TRACE";
+
+static uint32_t g_next_seq = 1;
+static zenoh_trace_peer_t g_peers[ZENOH_TRACE_MAX_PEERS];
+static size_t g_peer_count = 0;
+static zenoh_trace_chain_t g_chain;
+static portMUX_TYPE g_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void put_u32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; i++) { p[i] = (uint8_t)(v >> (8 * i)); } }
+static void put_u64(uint8_t *p, uint64_t v) { put_u32(p, (uint32_t)v); put_u32(p + 4, (uint32_t)(v >> 32)); }
+static uint32_t get_u32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint64_t get_u64(const uint8_t *p) { return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32); }
+
+size_t zenoh_trace_stamp(uint8_t *buf, size_t cap, const zenoh_trace_origin_t *origin) {
+    size_t len = zenoh_attachment_begin(buf, cap);
+    if (len == 0) { return 0; }
+    uint8_t field[ZENOH_TRACE_ORIGIN_FIELD_LEN];
+    taskENTER_CRITICAL(&g_trace_lock);
+    uint32_t seq = g_next_seq++;
+    taskEXIT_CRITICAL(&g_trace_lock);
+    put_u32(field, seq);
+    put_u64(field + 4, (uint64_t)esp_timer_get_time());
+    zenoh_attachment_add(buf, cap, &len, ZENOH_ATTACH_TRACE, field, ZENOH_TRACE_FIELD_LEN);
+    if (origin != NULL) {
+        memcpy(field, origin->zid.id, sizeof(origin->zid.id));
+        put_u32(field + 16, origin->seq);
+        put_u64(field + 20, (uint64_t)origin->source_us);
+        zenoh_attachment_add(buf, cap, &len, ZENOH_ATTACH_ORIGIN, field, ZENOH_TRACE_ORIGIN_FIELD_LEN);
+    }
+    return len;
+}
+
+bool zenoh_trace_attachment(const zenoh_trace_origin_t *origin, z_owned_bytes_t *out) {
+    uint8_t buf[ZENOH_ATTACH_MAX_LEN];
+    size_t len = zenoh_trace_stamp(buf, sizeof(buf), origin);
+    return len > 0 && z_bytes_copy_from_buf(out, buf, len) == Z_OK;
+}
+
+bool zenoh_trace_origin(const z_loaned_sample_t *sample, zenoh_trace_origin_t *out) {
+    const z_loaned_bytes_t *att = z_sample_attachment(sample);
+    uint8_t field[ZENOH_TRACE_ORIGIN_FIELD_LEN];
+    size_t len = sizeof(field);
+    if (zenoh_attachment_find(att, ZENOH_ATTACH_ORIGIN, field, &len) && len == ZENOH_TRACE_ORIGIN_FIELD_LEN) {
+        memcpy(out->zid.id, field, sizeof(out->zid.id));
+        out->seq = get_u32(field + 16);
+        out->source_us = (int64_t)get_u64(field + 20);
+        return true;
+    }
+    len = sizeof(out->zid.id);
+    if (!zenoh_attachment_find(att, ZENOH_ATTACH_LIVENESS, out->zid.id, &len) || len != sizeof(out->zid.id)) {
+        return false;
+    }
+    len = sizeof(field);
+    if (!zenoh_attachment_find(att, ZENOH_ATTACH_TRACE, field, &len) || len != ZENOH_TRACE_FIELD_LEN) {
+        return false;
+    }
+    out->seq = get_u32(field);
+    out->source_us = (int64_t)get_u64(field + 4);
+    return true;
+}
+
+/**
+ * @brief Converts a timestamp taken on the clock of zid to our clock.
+ * @return false if the offset of that clock is unknown.
+ */
+static bool to_local_clock(const z_id_t *zid, int64_t remote_us, int64_t *local_us) {
+    z_id_t self;
+    if (zenoh_attachment_self(&self) && memcmp(self.id, zid->id, sizeof(self.id)) == 0) {
+        *local_us = remote_us;
+        return true;
+    }
+#if HEARTBEAT_ON
+    int64_t offset_us;
+    if (zenoh_heartbeat_clock_offset(zid, &offset_us)) {
+        *local_us = remote_us - offset_us;
+        return true;
+    }
+#endif
+    return false;
+}
+
+// Must be called with g_trace_lock held
+static zenoh_trace_peer_t *peer_slot_locked(const z_id_t *zid) {
+    size_t oldest = 0;
+    for (size_t i = 0; i < g_peer_count; i++) {
+        if (memcmp(g_peers[i].zid.id, zid->id, sizeof(zid->id)) == 0) { return &g_peers[i]; }
+        if (g_peers[i].last_seen_us < g_peers[oldest].last_seen_us) { oldest = i; }
+    }
+    size_t slot = g_peer_count < ZENOH_TRACE_MAX_PEERS ? g_peer_count++ : oldest;
+    zenoh_trace_peer_t *p = &g_peers[slot];
+    memset(p, 0, sizeof(*p));
+    p->zid = *zid;
+    p->latency_last_us = ZENOH_TRACE_LATENCY_UNKNOWN;
+    return p;
+}
+
+static uint32_t latency_us(int64_t now, int64_t sent_local_us) {
+    return now > sent_local_us ? (uint32_t)(now - sent_local_us) : 0;
+}
+
+void zenoh_trace_note_sample(const z_loaned_sample_t *sample) {
+    const z_loaned_bytes_t *att = z_sample_attachment(sample);
+    z_id_t zid;
+    uint8_t field[ZENOH_TRACE_FIELD_LEN];
+    size_t zid_len = sizeof(zid.id), len = sizeof(field);
+    if (!zenoh_attachment_find(att, ZENOH_ATTACH_TRACE, field, &len) || len != ZENOH_TRACE_FIELD_LEN
+        || !zenoh_attachment_find(att, ZENOH_ATTACH_LIVENESS, zid.id, &zid_len) || zid_len != sizeof(zid.id)) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    uint32_t seq = get_u32(field);
+    int64_t sent_local_us;
+    bool has_latency = to_local_clock(&zid, (int64_t)get_u64(field + 4), &sent_local_us);
+    uint32_t latency = has_latency ? latency_us(now, sent_local_us) : ZENOH_TRACE_LATENCY_UNKNOWN;
+
+    taskENTER_CRITICAL(&g_trace_lock);
+    zenoh_trace_peer_t *p = peer_slot_locked(&zid);
+    if (p->received == 0 || (seq < p->last_seq && p->last_seq - seq > ZENOH_TRACE_REORDER_WINDOW)) {
+        // First message or the publisher restarted
+        p->received = p->lost = p->reordered = p->duplicates = 0;
+        p->last_seq = seq;
+    } else if (seq > p->last_seq) {
+        p->lost += seq - p->last_seq - 1;
+        p->last_seq = seq;
+    } else if (seq == p->last_seq) {
+        p->duplicates++;
+    } else {
+        p->reordered++; // late, fills a gap counted as lost
+        if (p->lost > 0) { p->lost--; }
+    }
+    p->received++;
+    p->last_seen_us = now;
+    if (has_latency) {
+        p->latency_last_us = latency;
+        p->latency_avg_us = p->latency_avg_us == 0 ? latency : p->latency_avg_us - p->latency_avg_us / 8 + latency / 8;
+        if (latency > p->latency_max_us) { p->latency_max_us = latency; }
+    }
+    taskEXIT_CRITICAL(&g_trace_lock);
+
+    uint8_t origin[ZENOH_TRACE_ORIGIN_FIELD_LEN];
+    len = sizeof(origin);
+    if (!zenoh_attachment_find(att, ZENOH_ATTACH_ORIGIN, origin, &len) || len != ZENOH_TRACE_ORIGIN_FIELD_LEN) {
+        return;
+    }
+    z_id_t origin_zid;
+    memcpy(origin_zid.id, origin, sizeof(origin_zid.id));
+    int64_t origin_local_us;
+    if (!to_local_clock(&origin_zid, (int64_t)get_u64(origin + 20), &origin_local_us)) { return; }
+    uint32_t chain_us = latency_us(now, origin_local_us);
+    uint32_t origin_seq = get_u32(origin + 16);
+    taskENTER_CRITICAL(&g_trace_lock);
+    g_chain.count++;
+    g_chain.last_seq = origin_seq;
+    g_chain.last_us = chain_us;
+    g_chain.avg_us = g_chain.avg_us == 0 ? chain_us : g_chain.avg_us - g_chain.avg_us / 8 + chain_us / 8;
+    if (chain_us > g_chain.max_us) { g_chain.max_us = chain_us; }
+    taskEXIT_CRITICAL(&g_trace_lock);
+    ZLOGD_HOT(TAG, "🕒 #%lu origin to result: %lu us (hop %lu us)", (unsigned long)origin_seq,
+            (unsigned long)chain_us, (unsigned long)latency);
+}
+
+size_t zenoh_trace_peers(zenoh_trace_peer_t *out, size_t max) {
+    taskENTER_CRITICAL(&g_trace_lock);
+    size_t n = g_peer_count < max ? g_peer_count : max;
+    memcpy(out, g_peers, n * sizeof(*out));
+    taskEXIT_CRITICAL(&g_trace_lock);
+    return n;
+}
+
+void zenoh_trace_chains(zenoh_trace_chain_t *out) {
+    taskENTER_CRITICAL(&g_trace_lock);
+    *out = g_chain;
+    taskEXIT_CRITICAL(&g_trace_lock);
+}
+
+#endif // ZENOH_TRACE_ON
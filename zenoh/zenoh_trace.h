@@ -0,0 +1,105 @@
+#ifndef ZENOH_TRACE_H
+#define ZENOH_TRACE_H
+
+#include <zenoh-pico.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "zenoh_config.h"
+
+#if ZENOH_TRACE_ON
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Tracing: data publications on KEYEXPR_PUB carry a ZENOH_ATTACH_TRACE field
+ * (per-node sequence number and esp_timer send time) next to the liveness
+ * field. Receivers track gaps, reordering and one-way latency per publisher,
+ * converting the send time with the heartbeat clock offset. A result can also
+ * carry the trace of the message it was computed from (ZENOH_ATTACH_ORIGIN), so
+ * the node that captured a frame sees capture-to-result latency on its own clock.
+ */
+#define ZENOH_TRACE_FIELD_LEN 12
+#define ZENOH_TRACE_ORIGIN_FIELD_LEN 28
+#define ZENOH_TRACE_LATENCY_UNKNOWN UINT32_MAX
+
+// Where a chain of messages started: the first traced message
+typedef struct {
+    z_id_t zid;
+    uint32_t seq;
+    int64_t source_us; // on the clock of zid
+} zenoh_trace_origin_t;
+
+// Sequence and latency of one publisher, as seen by this node
+typedef struct {
+    z_id_t zid;
+    int64_t last_seen_us;
+    uint32_t last_seq;
+    uint32_t received;
+    uint32_t lost;        // sequence gaps never filled
+    uint32_t reordered;   // arrived after a higher sequence number
+    uint32_t duplicates;
+    uint32_t latency_last_us;  // one-way, ZENOH_TRACE_LATENCY_UNKNOWN without clock offset
+    uint32_t latency_avg_us;   // smoothed, 7/8 old + 1/8 new
+    uint32_t latency_max_us;
+} zenoh_trace_peer_t;
+
+// Latency from an origin message to a reply that referenced it
+typedef struct {
+    uint32_t count;
+    uint32_t last_seq;    // origin seq of the last chain
+    uint32_t last_us;
+    uint32_t avg_us;
+    uint32_t max_us;
+} zenoh_trace_chain_t;
+
+/**
+ * @brief Builds the attachment of a traced publication into buf.
+ *
+ * Takes the next sequence number, so call it once per put. Called by the
+ * manager for data puts without an attachment of their own.
+ * @param origin Optional origin to forward (see zenoh_trace_origin()).
+ * @return Attachment length, 0 before the session is open.
+ */
+size_t zenoh_trace_stamp(uint8_t *buf, size_t cap, const zenoh_trace_origin_t *origin);
+
+/**
+ * @brief Builds a traced attachment for a put the application makes with options.
+ *
+ * Use it to reply to a traced message, e.g. pass the origin of the frame to the
+ * result: options.attachment = z_move(att). The bytes are copied.
+ * @return false before the session is open or if out of memory.
+ */
+bool zenoh_trace_attachment(const zenoh_trace_origin_t *origin, z_owned_bytes_t *out);
+
+/**
+ * @brief Origin of a received sample: its own origin field if it has one,
+ * else the sample's trace itself.
+ * @return false if the sample is not traced.
+ */
+bool zenoh_trace_origin(const z_loaned_sample_t *sample, zenoh_trace_origin_t *out);
+
+/**
+ * @brief Updates the publisher table from a received sample. Called by the manager.
+ */
+void zenoh_trace_note_sample(const z_loaned_sample_t *sample);
+
+/**
+ * @brief Copies up to max entries of the publisher table into out.
+ * @return Number of entries copied.
+ */
+size_t zenoh_trace_peers(zenoh_trace_peer_t *out, size_t max);
+
+/**
+ * @brief Copies the origin-to-reply latency of chains with a known clock into *out.
+ */
+void zenoh_trace_chains(zenoh_trace_chain_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_TRACE_ON
+#endif // ZENOH_TRACE_H
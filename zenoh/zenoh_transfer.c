@@ -0,0 +1,528 @@
+#include "zenoh_transfer.h"
+
+#if ZENOH_TRANSFER_ON // The entire file is conditionally compiled
+
+#include "zenoh_manager.h"
+#include "zenoh_utils.h"
+#define ZENOH_LOG_SUBSYSTEM TRANSFER
+#include "zenoh_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "zenoh_platform.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "Z_XFER";
+
+static EventGroupHandle_t g_event_group = NULL;
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void build_header(uint8_t *h, uint8_t type, uint32_t object_id, uint32_t index,
+        uint32_t chunk_count, uint32_t total_len) {
+    h[0] = ZENOH_TRANSFER_MAGIC0;
+    h[1] = ZENOH_TRANSFER_MAGIC1;
+    h[2] = ZENOH_TRANSFER_VERSION;
+    h[3] = type;
+    put_u32(&h[4], object_id);
+    put_u32(&h[8], index);
+    put_u32(&h[12], chunk_count);
+    put_u32(&h[16], total_len);
+}
+
+/* ---------------- Provider side (device with the queryable) ---------------- */
+
+typedef struct {
+    bool staged;
+    uint32_t object_id;
+    const uint8_t *data;
+    size_t len;
+    zenoh_transfer_release_t release;
+    void *ctx;
+} staged_object_t;
+
+static staged_object_t g_stage;
+static SemaphoreHandle_t g_stage_mutex = NULL;
+
+static uint32_t chunk_count_of(size_t len) {
+    return (uint32_t)((len + ZENOH_TRANSFER_CHUNK_SIZE - 1) / ZENOH_TRANSFER_CHUNK_SIZE);
+}
+
+// Must be called with g_stage_mutex held
+static void release_stage_locked() {
+    if (g_stage.staged && g_stage.release) {
+        g_stage.release((void *)g_stage.data, g_stage.ctx);
+    }
+    memset(&g_stage, 0, sizeof(g_stage));
+}
+
+void zenoh_transfer_stage(uint32_t object_id, const uint8_t *data, size_t len,
+        zenoh_transfer_release_t release, void *ctx) {
+    if (g_stage_mutex == NULL) { g_stage_mutex = xSemaphoreCreateMutex(); }
+    xSemaphoreTake(g_stage_mutex, portMAX_DELAY);
+    release_stage_locked();
+    g_stage.staged = true;
+    g_stage.object_id = object_id;
+    g_stage.data = data;
+    g_stage.len = len;
+    g_stage.release = release;
+    g_stage.ctx = ctx;
+    xSemaphoreGive(g_stage_mutex);
+    ZLOGD(TAG, "Staged object %lu: %u B in %lu chunks", (unsigned long)object_id,
+            (unsigned)len, (unsigned long)chunk_count_of(len));
+}
+
+void zenoh_transfer_clear() {
+    if (g_stage_mutex == NULL) { return; }
+    xSemaphoreTake(g_stage_mutex, portMAX_DELAY);
+    release_stage_locked();
+    xSemaphoreGive(g_stage_mutex);
+}
+
+static void reply_error(const z_loaned_query_t *query) {
+    z_owned_bytes_t err_payload;
+    z_bytes_empty(&err_payload);
+    z_query_reply_err(query, z_move(err_payload), NULL);
+}
+
+// Replies with the header followed by the chunk bytes, the latter by reference
+static void reply_chunk(const z_loaned_query_t *query, uint32_t index, uint32_t count) {
+    size_t offset = (size_t)index * ZENOH_TRANSFER_CHUNK_SIZE;
+    size_t len = g_stage.len - offset;
+    if (len > ZENOH_TRANSFER_CHUNK_SIZE) { len = ZENOH_TRANSFER_CHUNK_SIZE; }
+
+    uint8_t header[ZENOH_TRANSFER_HEADER_LEN];
+    build_header(header, ZENOH_TRANSFER_TYPE_CHUNK, g_stage.object_id, index, count, (uint32_t)g_stage.len);
+
+    z_owned_bytes_writer_t writer;
+    z_owned_bytes_t chunk;
+    if (z_bytes_writer_empty(&writer) != Z_OK) { return; }
+    if (z_bytes_writer_write_all(z_loan_mut(writer), header, sizeof(header)) != Z_OK ||
+        z_bytes_from_static_buf(&chunk, g_stage.data + offset, len) != Z_OK) {
+        z_drop(z_move(writer));
+        return;
+    }
+    z_bytes_writer_append(z_loan_mut(writer), z_move(chunk));
+    z_owned_bytes_t payload;
+    z_bytes_writer_finish(z_move(writer), &payload);
+    // zenoh-pico serializes the reply before returning, so the static slice is safe
+    z_query_reply(query, z_query_keyexpr(query), z_move(payload), NULL);
+}
+
+// The query is on ZENOH_TRANSFER_KEYEXPR or one of its sub-keys
+static bool query_on_transfer_key(const z_loaned_query_t *query) {
+    z_view_string_t key_view;
+    z_keyexpr_as_view_string(z_query_keyexpr(query), &key_view);
+    const char *key = z_string_data(z_loan(key_view));
+    size_t key_len = z_string_len(z_loan(key_view));
+    size_t n = strlen(ZENOH_TRANSFER_KEYEXPR);
+    return key_len >= n && strncmp(key, ZENOH_TRANSFER_KEYEXPR, n) == 0 && (key_len == n || key[n] == '/');
+}
+
+bool zenoh_transfer_handle_query(const z_loaned_query_t *query) {
+    if (!query_on_transfer_key(query)) { return false; }
+    z_view_string_t params_view;
+    z_query_parameters(query, &params_view);
+    const char *params = z_string_data(z_loan(params_view));
+    size_t params_len = z_string_len(z_loan(params_view));
+
+    const char *value;
+    size_t value_len;
+    bool is_meta = zenoh_utils_param_get(params, params_len, "meta", &value, &value_len);
+    bool is_chunk = !is_meta && zenoh_utils_param_get(params, params_len, "chunk", &value, &value_len);
+    if (!is_meta && !is_chunk) { return false; }
+
+    if (g_stage_mutex == NULL || xSemaphoreTake(g_stage_mutex, portMAX_DELAY) != pdTRUE) {
+        reply_error(query);
+        return true;
+    }
+    if (!g_stage.staged) {
+        ZLOGW(TAG, "Chunk query but no object is staged");
+        reply_error(query);
+        xSemaphoreGive(g_stage_mutex);
+        return true;
+    }
+
+    uint32_t count = chunk_count_of(g_stage.len);
+    if (is_meta) {
+        uint8_t header[ZENOH_TRANSFER_HEADER_LEN];
+        build_header(header, ZENOH_TRANSFER_TYPE_META, g_stage.object_id, ZENOH_TRANSFER_CHUNK_SIZE,
+                count, (uint32_t)g_stage.len);
+        z_owned_bytes_t payload;
+        z_bytes_copy_from_buf(&payload, header, sizeof(header));
+        z_query_reply(query, z_query_keyexpr(query), z_move(payload), NULL);
+        xSemaphoreGive(g_stage_mutex);
+        return true;
+    }
+
+    // "a-b" range, inclusive
+    uint32_t first = 0, last = 0, obj = 0;
+    const char *dash = memchr(value, '-', value_len);
+    const char *obj_value;
+    size_t obj_len;
+    bool ok = dash != NULL &&
+              zenoh_utils_param_u32(value, (size_t)(dash - value), &first) &&
+              zenoh_utils_param_u32(dash + 1, value_len - (size_t)(dash - value) - 1, &last) &&
+              zenoh_utils_param_get(params, params_len, "obj", &obj_value, &obj_len) &&
+              zenoh_utils_param_u32(obj_value, obj_len, &obj);
+    if (!ok || obj != g_stage.object_id || first > last || first >= count) {
+        // A different object id means the object was replaced: the fetcher restarts
+        ZLOGW(TAG, "Rejected chunk query '%.*s'", (int)params_len, params);
+        reply_error(query);
+        xSemaphoreGive(g_stage_mutex);
+        return true;
+    }
+    if (last >= count) { last = count - 1; }
+    for (uint32_t i = first; i <= last; i++) {
+        reply_chunk(query, i, count);
+    }
+    xSemaphoreGive(g_stage_mutex);
+    return true;
+}
+
+/* ---------------- Fetch side (device issuing the GETs) ---------------- */
+
+#if I_AM_CONSUMER_OR_SERVER == 0
+
+#define META_SLOT ZENOH_TRANSFER_WINDOW
+
+typedef enum { EV_META, EV_QUERY_DONE, EV_STOP } fetch_event_type_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t slot;
+    uint16_t generation;
+    uint32_t object_id;
+    uint32_t chunk_size;
+    uint32_t chunk_count;
+    uint32_t total_len;
+} fetch_event_t;
+
+typedef struct {
+    bool in_use;
+    uint32_t first;
+    uint32_t last;
+    uint8_t attempts;
+} range_req_t;
+
+typedef struct {
+    bool active;
+    bool have_meta;
+    uint16_t generation;
+    char keyexpr[ZENOH_KEYEXPR_MAX_LEN];
+    uint32_t object_id;
+    uint32_t chunk_size;
+    uint32_t chunk_count;
+    size_t total_len;
+    uint8_t *buf;
+    uint8_t *bitmap;
+    uint32_t received;
+    uint32_t next_chunk;
+    uint8_t meta_attempts;
+    range_req_t ranges[ZENOH_TRANSFER_WINDOW];
+    zenoh_transfer_done_t done;
+    void *ctx;
+} fetch_state_t;
+
+static fetch_state_t g_fetch;
+static SemaphoreHandle_t g_fetch_mutex = NULL;
+static QueueHandle_t g_fetch_queue = NULL;
+static TaskHandle_t fetch_task_handle = NULL;
+static SemaphoreHandle_t g_exit_sem = NULL; // given by the task when it leaves, see zenoh_transfer_stop()
+static volatile bool g_stopping = false;
+
+// Closure context packs the generation and the slot, so late callbacks of
+// an earlier fetch are recognised and ignored.
+static void *pack_ctx(uint16_t generation, uint8_t slot) {
+    return (void *)(uintptr_t)(((uint32_t)generation << 8) | slot);
+}
+
+static void fetch_reply_cb(z_loaned_reply_t *reply, void *ctx) {
+    if (!z_reply_is_ok(reply)) { return; }
+    uint16_t generation = (uint16_t)((uintptr_t)ctx >> 8);
+    uint8_t slot = (uint8_t)((uintptr_t)ctx & 0xFF);
+
+    const z_loaned_bytes_t *payload = z_sample_payload(z_reply_ok(reply));
+    z_bytes_reader_t reader = z_bytes_get_reader(payload);
+    uint8_t h[ZENOH_TRANSFER_HEADER_LEN];
+    if (z_bytes_reader_read(&reader, h, sizeof(h)) != sizeof(h) ||
+        h[0] != ZENOH_TRANSFER_MAGIC0 || h[1] != ZENOH_TRANSFER_MAGIC1 || h[2] != ZENOH_TRANSFER_VERSION) {
+        ZLOGW(TAG, "Reply without transfer header ignored");
+        return;
+    }
+
+    if (h[3] == ZENOH_TRANSFER_TYPE_META && slot == META_SLOT) {
+        fetch_event_t ev = { EV_META, slot, generation, get_u32(&h[4]), get_u32(&h[8]),
+                             get_u32(&h[12]), get_u32(&h[16]) };
+        xQueueSend(g_fetch_queue, &ev, 0);
+        return;
+    }
+    if (h[3] != ZENOH_TRANSFER_TYPE_CHUNK) { return; }
+
+    // Copy the chunk straight into the reassembly buffer
+    uint32_t index = get_u32(&h[8]);
+    xSemaphoreTake(g_fetch_mutex, portMAX_DELAY);
+    if (g_fetch.active && g_fetch.buf != NULL && generation == g_fetch.generation &&
+        get_u32(&h[4]) == g_fetch.object_id && index < g_fetch.chunk_count &&
+        !(g_fetch.bitmap[index / 8] & (1u << (index % 8))) &&
+        (uint64_t)index * g_fetch.chunk_size < g_fetch.total_len) {
+        size_t offset = (size_t)index * g_fetch.chunk_size;
+        size_t len = g_fetch.total_len - offset;
+        if (len > g_fetch.chunk_size) { len = g_fetch.chunk_size; }
+        if (z_bytes_len(payload) == sizeof(h) + len &&
+            z_bytes_reader_read(&reader, g_fetch.buf + offset, len) == len) {
+            g_fetch.bitmap[index / 8] |= (uint8_t)(1u << (index % 8));
+            g_fetch.received++;
+        }
+    }
+    xSemaphoreGive(g_fetch_mutex);
+}
+
+static void fetch_drop_cb(void *ctx) {
+    fetch_event_t ev = { 0 };
+    ev.type = EV_QUERY_DONE;
+    ev.generation = (uint16_t)((uintptr_t)ctx >> 8);
+    ev.slot = (uint8_t)((uintptr_t)ctx & 0xFF);
+    xQueueSend(g_fetch_queue, &ev, portMAX_DELAY);
+}
+
+static int send_get(const char *params, uint8_t slot) {
+    z_owned_closure_reply_t closure;
+    z_closure(&closure, fetch_reply_cb, fetch_drop_cb, pack_ctx(g_fetch.generation, slot));
+    z_get_options_t options;
+    z_get_options_default(&options);
+    options.consolidation = z_query_consolidation_none(); // chunks share one key
+    options.timeout_ms = ZENOH_TRANSFER_GET_TIMEOUT_MS;
+    if (zenoh_get_with_closure(g_fetch.keyexpr, params, &closure, &options) < 0) {
+        ZLOGE(TAG, "❗Failed to send GET '%s?%s'❗", g_fetch.keyexpr, params);
+        return -1;
+    }
+    return 0;
+}
+
+static int request_range(uint8_t slot, uint32_t first, uint32_t last) {
+    char params[48];
+    snprintf(params, sizeof(params), "obj=%lu;chunk=%lu-%lu", (unsigned long)g_fetch.object_id,
+            (unsigned long)first, (unsigned long)last);
+    g_fetch.ranges[slot].in_use = true;
+    g_fetch.ranges[slot].first = first;
+    g_fetch.ranges[slot].last = last;
+    return send_get(params, slot);
+}
+
+// Hands out the next range of never-requested chunks to a free slot
+static int request_next_range(uint8_t slot) {
+    if (g_fetch.next_chunk >= g_fetch.chunk_count) { return 0; }
+    uint32_t first = g_fetch.next_chunk;
+    uint32_t last = first + ZENOH_TRANSFER_RANGE_CHUNKS - 1;
+    if (last >= g_fetch.chunk_count) { last = g_fetch.chunk_count - 1; }
+    g_fetch.next_chunk = last + 1;
+    g_fetch.ranges[slot].attempts = 0;
+    return request_range(slot, first, last);
+}
+
+static void finish_fetch(int status) {
+    xSemaphoreTake(g_fetch_mutex, portMAX_DELAY);
+    uint8_t *buf = g_fetch.buf;
+    size_t len = g_fetch.total_len;
+    zenoh_transfer_done_t done = g_fetch.done;
+    void *ctx = g_fetch.ctx;
+    free(g_fetch.bitmap);
+    g_fetch.bitmap = NULL;
+    g_fetch.buf = NULL;
+    g_fetch.active = false;
+    g_fetch.generation++;
+    xSemaphoreGive(g_fetch_mutex);
+
+    if (status == 0) {
+        ZLOGI(TAG, "✅ Object %lu received: %u B", (unsigned long)g_fetch.object_id, (unsigned)len);
+        xEventGroupSetBits(g_event_group, TRANSFER_COMPLETE_BIT);
+    } else {
+        ZLOGE(TAG, "❗Transfer of '%s' failed❗", g_fetch.keyexpr);
+        if (buf) { zenoh_psram_free(buf); }
+        buf = NULL;
+        len = 0;
+    }
+    if (done) { done(status, buf, len, ctx); }
+    else if (buf) { zenoh_psram_free(buf); }
+}
+
+static bool chunk_missing(uint32_t index) {
+    return !(g_fetch.bitmap[index / 8] & (1u << (index % 8)));
+}
+
+static void on_meta(const fetch_event_t *ev) {
+    if (g_fetch.have_meta) { return; }
+    // Values off the network: the chunk layout must describe exactly total_len bytes
+    if (ev->chunk_size == 0 || ev->total_len > ZENOH_TRANSFER_MAX_OBJECT_BYTES
+        || ev->chunk_count != (uint32_t)(((uint64_t)ev->total_len + ev->chunk_size - 1) / ev->chunk_size)) {
+        ZLOGW(TAG, "Rejected META: %lu B in %lu chunks of %lu B", (unsigned long)ev->total_len,
+                (unsigned long)ev->chunk_count, (unsigned long)ev->chunk_size);
+        return; // the meta query-done event then retries or fails the fetch
+    }
+    size_t bitmap_len = (ev->chunk_count + 7) / 8;
+    uint8_t *buf = (uint8_t *)zenoh_psram_malloc(ev->total_len ? ev->total_len : 1);
+    uint8_t *bitmap = (uint8_t *)calloc(bitmap_len ? bitmap_len : 1, 1);
+    if (buf == NULL || bitmap == NULL) {
+        ZLOGE(TAG, "❗No memory for a %lu B object❗", (unsigned long)ev->total_len);
+        if (buf) { zenoh_psram_free(buf); }
+        free(bitmap);
+        return; // the meta query-done event then fails the fetch
+    }
+    xSemaphoreTake(g_fetch_mutex, portMAX_DELAY);
+    g_fetch.object_id = ev->object_id;
+    g_fetch.chunk_size = ev->chunk_size;
+    g_fetch.chunk_count = ev->chunk_count;
+    g_fetch.total_len = ev->total_len;
+    g_fetch.buf = buf;
+    g_fetch.bitmap = bitmap;
+    g_fetch.received = 0;
+    g_fetch.next_chunk = 0;
+    g_fetch.have_meta = true;
+    xSemaphoreGive(g_fetch_mutex);
+    ZLOGD(TAG, "Object %lu: %lu B in %lu chunks", (unsigned long)ev->object_id,
+            (unsigned long)ev->total_len, (unsigned long)ev->chunk_count);
+}
+
+// A GET has delivered all its replies (or timed out)
+static void on_query_done(uint8_t slot) {
+    if (slot == META_SLOT) {
+        if (!g_fetch.have_meta) {
+            if (++g_fetch.meta_attempts > ZENOH_TRANSFER_MAX_RETRIES || send_get("meta", META_SLOT) < 0) {
+                finish_fetch(-1);
+            }
+            return;
+        }
+        for (uint8_t s = 0; s < ZENOH_TRANSFER_WINDOW; s++) {
+            if (request_next_range(s) < 0) { finish_fetch(-1); return; }
+        }
+    } else if (slot < ZENOH_TRANSFER_WINDOW && g_fetch.ranges[slot].in_use) {
+        range_req_t *r = &g_fetch.ranges[slot];
+        r->in_use = false;
+        // Narrow the range to what is still missing and ask again
+        uint32_t first = r->first, last = r->last;
+        xSemaphoreTake(g_fetch_mutex, portMAX_DELAY);
+        while (first <= last && !chunk_missing(first)) { first++; }
+        while (last > first && !chunk_missing(last)) { last--; }
+        xSemaphoreGive(g_fetch_mutex);
+        int res;
+        if (first <= last) {
+            if (++r->attempts > ZENOH_TRANSFER_MAX_RETRIES) { finish_fetch(-1); return; }
+            ZLOGD(TAG, "Re-requesting chunks %lu-%lu", (unsigned long)first, (unsigned long)last);
+            res = request_range(slot, first, last);
+        } else {
+            res = request_next_range(slot);
+        }
+        if (res < 0) { finish_fetch(-1); return; }
+    }
+
+    if (g_fetch.have_meta && g_fetch.received == g_fetch.chunk_count) {
+        finish_fetch(0);
+    }
+}
+
+// Runs until zenoh_transfer_stop() sets g_stopping and posts EV_STOP, then gives g_exit_sem and deletes itself
+static void fetch_task(void *arg) {
+    (void)arg;
+    fetch_event_t ev;
+    while (!g_stopping) {
+        if (xQueueReceive(g_fetch_queue, &ev, pdMS_TO_TICKS(ZENOH_TRANSFER_GET_TIMEOUT_MS * 2)) != pdTRUE) {
+            // zenoh always calls the drop of a GET, so silence this long means the session is gone
+            if (g_fetch.active) { finish_fetch(-1); }
+            continue;
+        }
+        if (ev.type == EV_STOP || g_stopping) { break; }
+        if (!g_fetch.active || ev.generation != g_fetch.generation) { continue; }
+        if (ev.type == EV_META) {
+            on_meta(&ev);
+        } else {
+            on_query_done(ev.slot);
+        }
+    }
+    xSemaphoreGive(g_exit_sem);
+    vTaskDelete(NULL);
+}
+
+int zenoh_fetch_object(const char *keyexpr, zenoh_transfer_done_t done, void *ctx) {
+    if (fetch_task_handle == NULL) {
+        ZLOGE(TAG, "Transfer module not initialized");
+        return -1;
+    }
+    if (strlen(keyexpr) >= sizeof(g_fetch.keyexpr)) { return -1; }
+    size_t n = strlen(ZENOH_TRANSFER_KEYEXPR);
+    if (strncmp(keyexpr, ZENOH_TRANSFER_KEYEXPR, n) != 0 || (keyexpr[n] != '\0' && keyexpr[n] != '/')) {
+        ZLOGE(TAG, "'%s' is not under ZENOH_TRANSFER_KEYEXPR", keyexpr);
+        return -1;
+    }
+    xSemaphoreTake(g_fetch_mutex, portMAX_DELAY);
+    if (g_fetch.active) {
+        xSemaphoreGive(g_fetch_mutex);
+        ZLOGW(TAG, "⚠️ A transfer is already running ⚠️");
+        return -1;
+    }
+    uint16_t generation = g_fetch.generation;
+    memset(&g_fetch, 0, sizeof(g_fetch));
+    g_fetch.generation = generation;
+    strcpy(g_fetch.keyexpr, keyexpr);
+    g_fetch.done = done;
+    g_fetch.ctx = ctx;
+    g_fetch.active = true;
+    xSemaphoreGive(g_fetch_mutex);
+
+    xEventGroupClearBits(g_event_group, TRANSFER_COMPLETE_BIT);
+    ZLOGI(TAG, "➡️ Chunked GET for '%s'", keyexpr);
+    if (send_get("meta", META_SLOT) < 0) {
+        finish_fetch(-1);
+        return -1;
+    }
+    return 0;
+}
+
+#endif // I_AM_CONSUMER_OR_SERVER == 0
+
+void zenoh_transfer_init(EventGroupHandle_t event_group) {
+    g_event_group = event_group;
+    if (g_stage_mutex == NULL) { g_stage_mutex = xSemaphoreCreateMutex(); }
+#if I_AM_CONSUMER_OR_SERVER == 0
+    if (g_fetch_mutex == NULL) { g_fetch_mutex = xSemaphoreCreateMutex(); }
+    if (g_fetch_queue == NULL) { g_fetch_queue = xQueueCreate(ZENOH_TRANSFER_WINDOW * 4, sizeof(fetch_event_t)); }
+    if (g_exit_sem == NULL) { g_exit_sem = xSemaphoreCreateBinary(); }
+    if (fetch_task_handle == NULL) {
+        g_stopping = false;
+        if (xTaskCreatePinnedToCore(fetch_task, "zenoh_fetch", ZENOH_TRANSFER_TASK_STACK, NULL,
+                ZENOH_TRANSFER_TASK_PRIO, &fetch_task_handle, ZENOH_TRANSFER_TASK_CORE) != pdPASS) {
+            ZLOGE(TAG, "❗Unable to create the fetch task❗");
+            fetch_task_handle = NULL;
+        }
+    }
+#endif
+}
+
+void zenoh_transfer_stop() {
+#if I_AM_CONSUMER_OR_SERVER == 0
+    if (fetch_task_handle != NULL) {
+        // The task may hold g_fetch_mutex or be inside a GET holding the session mutex: let it finish
+        g_stopping = true;
+        fetch_event_t stop = { .type = EV_STOP };
+        xQueueSendToFront(g_fetch_queue, &stop, portMAX_DELAY);
+        xSemaphoreTake(g_exit_sem, portMAX_DELAY);
+        fetch_task_handle = NULL;
+        xQueueReset(g_fetch_queue);
+    }
+    if (g_fetch_mutex != NULL && g_fetch.active) {
+        g_fetch.done = NULL;
+        finish_fetch(-1);
+    }
+#endif
+    zenoh_transfer_clear();
+}
+
+#endif // ZENOH_TRANSFER_ON
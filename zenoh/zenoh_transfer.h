@@ -0,0 +1,103 @@
+#ifndef ZENOH_TRANSFER_H
+#define ZENOH_TRANSFER_H
+
+#include <zenoh-pico.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "zenoh_config.h"
+
+#if ZENOH_TRANSFER_ON
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Chunk protocol, selector parameters of the GET:
+ *   "meta"                      -> one reply, META header only
+ *   "obj=<id>;chunk=<a>-<b>"    -> one reply per chunk a..b (inclusive)
+ * Every reply starts with this little endian header:
+ *   'Z' 'T' <version=1> <type>  u32 object_id  u32 index  u32 chunk_count  u32 total_len
+ * For META, index carries the chunk size. GETs must disable consolidation,
+ * since all chunk replies share the same key expression.
+ */
+#define ZENOH_TRANSFER_MAGIC0 'Z'
+#define ZENOH_TRANSFER_MAGIC1 'T'
+#define ZENOH_TRANSFER_VERSION 1
+#define ZENOH_TRANSFER_TYPE_META 1
+#define ZENOH_TRANSFER_TYPE_CHUNK 2
+#define ZENOH_TRANSFER_HEADER_LEN 20
+
+// Releases a staged object once it is replaced or cleared
+typedef void (*zenoh_transfer_release_t)(void *data, void *ctx);
+
+/**
+ * @brief Called once a fetch ends.
+ * @param status 0 on success, negative on failure (data is NULL then).
+ * @param data Reassembled object, heap_caps allocated; owned by the callee.
+ * @param len Object length.
+ * @param ctx Context given to zenoh_fetch_object().
+ */
+typedef void (*zenoh_transfer_done_t)(int status, uint8_t *data, size_t len, void *ctx);
+
+/**
+ * @brief Starts the transfer module once the session is open. Called by the manager.
+ *
+ * GETs go through the manager (zenoh_get_with_closure), under its session lock.
+ */
+void zenoh_transfer_init(EventGroupHandle_t event_group);
+
+/**
+ * @brief Stops the fetch task and releases any staged object.
+ *
+ * Waits for the task to finish the event it is handling (possibly a GET),
+ * so the caller must not hold the session mutex.
+ */
+void zenoh_transfer_stop();
+
+/**
+ * @brief Exposes an object to chunked GETs, replacing the previous one.
+ *
+ * Chunks are replied straight from data, which must stay valid until release
+ * is called (when the object is replaced or cleared).
+ *
+ * @param object_id Identifier of the object (e.g. frame counter), echoed in replies.
+ * @param data Object bytes.
+ * @param len Object length.
+ * @param release Optional release callback.
+ * @param ctx Context for release.
+ */
+void zenoh_transfer_stage(uint32_t object_id, const uint8_t *data, size_t len,
+        zenoh_transfer_release_t release, void *ctx);
+
+/**
+ * @brief Withdraws the staged object and releases it.
+ */
+void zenoh_transfer_clear();
+
+/**
+ * @brief Serves a query if it uses the chunk protocol on ZENOH_TRANSFER_KEYEXPR.
+ * @return true if the query was a chunk query and has been replied to.
+ */
+bool zenoh_transfer_handle_query(const z_loaned_query_t *query);
+
+/**
+ * @brief Starts fetching the object behind keyexpr in the background.
+ *
+ * Clears TRANSFER_COMPLETE_BIT, sets it when the last chunk is in and then
+ * calls done. Only one fetch runs at a time. keyexpr must be
+ * ZENOH_TRANSFER_KEYEXPR or a sub-key of it, providers only serve those.
+ *
+ * @return 0 if started, -1 if a fetch is already running or the GET failed.
+ */
+int zenoh_fetch_object(const char *keyexpr, zenoh_transfer_done_t done, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZENOH_TRANSFER_ON
+#endif // ZENOH_TRANSFER_H
@@ -0,0 +1,283 @@
+#ifndef ZENOH_TYPED_HPP
+#define ZENOH_TYPED_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <type_traits>
+#include <utility>
+
+#include "zenoh_manager.h"
+#include "zenoh_platform.h"
+
+/*
+ * Typed C++ layer over the manager, header only.
+ *
+ *   struct result_t { uint32_t frame_id; uint16_t faces; uint16_t flags; };
+ *   static void on_result(const result_t &r, void *ctx) { ... }
+ *
+ *   static const zenoh::Publisher<result_t> results(KEYEXPR_RESULTS "/faces");
+ *   results.put(r);                                             // no copy, no heap
+ *   zenoh::Subscriber<result_t, on_result> sub(KEYEXPR_RESULTS "/faces", ctx);
+ *
+ * A struct goes on the wire as its object representation (Codec<T>): fixed
+ * size, native byte order, padding included, so both sides must share the
+ * definition (as with shared_payload.h). Buffers handed to the manager carry
+ * their allocator in their type, so a buffer can only reach the call whose
+ * deleter matches it, and leaks or double frees do not compile.
+ */
+namespace zenoh {
+
+/**
+ * @brief Fixed-layout serializer of a trivially copyable struct.
+ *
+ * Specialize it for a type that needs another layout; Publisher and
+ * Subscriber only use size, wrap() and decode().
+ */
+template <typename T>
+struct Codec {
+    static_assert(std::is_trivially_copyable<T>::value, "zenoh::Codec<T> needs a trivially copyable T");
+    static_assert(std::is_standard_layout<T>::value, "zenoh::Codec<T> needs a standard layout T");
+
+    static constexpr size_t size = sizeof(T);
+
+    // Payload referencing value in place. Puts serialize before returning (local
+    // subscribers get a copy), so value only has to live until the publish call returns.
+    static bool wrap(const T &value, z_owned_bytes_t *out) {
+        return z_bytes_from_static_buf(out, reinterpret_cast<const uint8_t *>(&value), size) == Z_OK;
+    }
+
+    // Reads a payload of exactly size bytes straight into *out
+    static bool decode(const z_loaned_bytes_t *bytes, T *out) {
+        return z_bytes_len(bytes) == size
+                && zenoh_bytes_read_at(bytes, 0, reinterpret_cast<uint8_t *>(out), size) == size;
+    }
+};
+
+/**
+ * @brief Move-only owner of a z_owned_* handle, dropped on destruction.
+ *
+ *   zenoh::Owned<z_owned_bytes_t> kept;
+ *   kept.init([&](z_owned_bytes_t *b) { return zenoh_sample_retain_payload(sample, b); });
+ */
+template <typename H>
+class Owned {
+public:
+    Owned() = default;
+    ~Owned() { reset(); }
+    Owned(const Owned &) = delete;
+    Owned &operator=(const Owned &) = delete;
+    Owned(Owned &&other) noexcept : handle_(other.handle_), valid_(other.valid_) { other.valid_ = false; }
+    Owned &operator=(Owned &&other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = other.handle_;
+            valid_ = other.valid_;
+            other.valid_ = false;
+        }
+        return *this;
+    }
+
+    // Runs fn(H *) to fill the handle; it is owned if fn returns >= 0
+    template <typename Init>
+    bool init(Init &&fn) {
+        reset();
+        valid_ = fn(&handle_) >= 0;
+        return valid_;
+    }
+
+    bool valid() const { return valid_; }
+    auto loan() const -> decltype(z_loan(std::declval<const H &>())) { return z_loan(handle_); }
+
+    // Gives the handle up, e.g. to a call that consumes it; the caller owns it now
+    H *release() {
+        valid_ = false;
+        return &handle_;
+    }
+
+    void reset() {
+        if (valid_) { z_drop(z_move(handle_)); }
+        valid_ = false;
+    }
+
+private:
+    H handle_;
+    bool valid_ = false;
+};
+
+// Allocators of publishable buffers. binary: accepted by zenoh_publish_binary()
+// (payload_deleter frees with free() or returns pool blocks); face_image: accepted as
+// the image of zenoh_publish_face_payload() (freed with zenoh_psram_free()).
+struct HeapAlloc {
+    static void *allocate(size_t len) { return malloc(len); }
+    static void release(void *p) { free(p); }
+    static constexpr bool binary = true;
+    static constexpr bool face_image = false;
+};
+
+struct PsramAlloc {
+    static void *allocate(size_t len) { return zenoh_psram_malloc(len); }
+    static void release(void *p) { zenoh_psram_free(p); }
+    static constexpr bool binary = false;
+    static constexpr bool face_image = true;
+};
+
+#if ZENOH_PAYLOAD_POOL_ON
+struct PoolAlloc {
+    static void *allocate(size_t len) { return zenoh_payload_acquire(len); }
+    static void release(void *p) { zenoh_payload_release(p); }
+    static constexpr bool binary = true;
+    static constexpr bool face_image = false;
+};
+#endif
+
+/**
+ * @brief Move-only payload buffer, freed by its allocator unless published.
+ */
+template <typename Alloc>
+class Buffer {
+public:
+    Buffer() = default;
+    explicit Buffer(size_t len) : data_(static_cast<uint8_t *>(Alloc::allocate(len))), len_(data_ ? len : 0) {}
+    ~Buffer() { reset(); }
+    Buffer(const Buffer &) = delete;
+    Buffer &operator=(const Buffer &) = delete;
+    Buffer(Buffer &&other) noexcept : data_(other.data_), len_(other.len_) {
+        other.data_ = nullptr;
+        other.len_ = 0;
+    }
+    Buffer &operator=(Buffer &&other) noexcept {
+        if (this != &other) {
+            reset();
+            std::swap(data_, other.data_);
+            std::swap(len_, other.len_);
+        }
+        return *this;
+    }
+
+    explicit operator bool() const { return data_ != nullptr; }
+    uint8_t *data() { return data_; }
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return len_; }
+
+    // Hands the memory over; whoever takes it frees it with Alloc::release
+    uint8_t *release() {
+        uint8_t *p = data_;
+        data_ = nullptr;
+        len_ = 0;
+        return p;
+    }
+
+    void reset() {
+        if (data_ != nullptr) { Alloc::release(data_); }
+        data_ = nullptr;
+        len_ = 0;
+    }
+
+private:
+    uint8_t *data_ = nullptr;
+    size_t len_ = 0;
+};
+
+/**
+ * @brief Publishes len bytes of buf (all of it by default) and consumes it.
+ */
+template <typename Alloc>
+void publish(const char *keyexpr, Buffer<Alloc> &&buf, const z_publisher_put_options_t *options = nullptr) {
+    static_assert(Alloc::binary, "zenoh::publish() frees with free() or the pool; use HeapAlloc or PoolAlloc");
+    if (!buf) { return; }
+    size_t len = buf.size();
+    zenoh_publish_binary(keyexpr, buf.release(), len, options);
+}
+
+/**
+ * @brief Publishes a face payload; the image buffer is consumed.
+ */
+template <typename Alloc>
+void publish_face(const char *keyexpr, const face_payload_header_t &header, const int *keypoints,
+        Buffer<Alloc> &&image) {
+    static_assert(Alloc::face_image, "the face image is freed with zenoh_psram_free(); use PsramAlloc");
+    zenoh_publish_face_payload(keyexpr, &header, keypoints, image.release());
+}
+
+/**
+ * @brief Publishes prebuilt bytes; they are always consumed.
+ */
+inline int publish(const char *keyexpr, Owned<z_owned_bytes_t> &&bytes, const z_publisher_put_options_t *options = nullptr) {
+    if (!bytes.valid()) { return _Z_ERR_GENERIC; }
+    return zenoh_publish_bytes(keyexpr, bytes.release(), options);
+}
+
+/**
+ * @brief Typed publisher for a key expression.
+ *
+ * Holds no zenoh handle: the manager declares the publisher on first use and
+ * redeclares it after a reconnect (publisher registry), so a Publisher can be
+ * a constant that outlives sessions.
+ */
+template <typename T>
+class Publisher {
+public:
+    explicit constexpr Publisher(const char *keyexpr) : keyexpr_(keyexpr) {}
+
+    // Returns the zenoh result code (< 0 on failure)
+    int put(const T &value, const z_publisher_put_options_t *options = nullptr) const {
+        z_owned_bytes_t payload;
+        if (!Codec<T>::wrap(value, &payload)) { return _Z_ERR_GENERIC; }
+        return zenoh_publish_bytes(keyexpr_, &payload, options);
+    }
+
+    const char *keyexpr() const { return keyexpr_; }
+
+private:
+    const char *keyexpr_;
+};
+
+#if SUBSCRIBER_ON
+/**
+ * @brief Typed subscription, undeclared on destruction.
+ *
+ * Handler is bound at compile time and gets ctx as is, so the object itself
+ * is never referenced from the callback and may be moved. Samples whose size
+ * is not Codec<T>::size are skipped.
+ */
+template <typename T, void (*Handler)(const T &value, void *ctx)>
+class Subscriber {
+public:
+    explicit Subscriber(const char *keyexpr, void *ctx = nullptr) : handle_(zenoh_subscribe(keyexpr, &dispatch, ctx)) {}
+    ~Subscriber() { reset(); }
+    Subscriber(const Subscriber &) = delete;
+    Subscriber &operator=(const Subscriber &) = delete;
+    Subscriber(Subscriber &&other) noexcept : handle_(other.handle_) { other.handle_ = -1; }
+    Subscriber &operator=(Subscriber &&other) noexcept {
+        if (this != &other) {
+            reset();
+            std::swap(handle_, other.handle_);
+        }
+        return *this;
+    }
+
+    // False if the subscription table was full
+    bool valid() const { return handle_ >= 0; }
+
+    void reset() {
+        if (handle_ >= 0) { zenoh_unsubscribe(handle_); }
+        handle_ = -1;
+    }
+
+private:
+    static_assert(std::is_trivially_default_constructible<T>::value,
+            "zenoh::Subscriber<T> decodes into a local T");
+
+    static void dispatch(z_loaned_sample_t *sample, void *ctx) {
+        T value;
+        if (Codec<T>::decode(z_sample_payload(sample), &value)) { Handler(value, ctx); }
+    }
+
+    zenoh_subscription_t handle_;
+};
+#endif // SUBSCRIBER_ON
+
+} // namespace zenoh
+
+#endif // ZENOH_TYPED_HPP
@@ -1,7 +1,17 @@
 #include "zenoh_utils.h"
-#include <esp_log.h>
-#include <esp_netif.h>
+#include "zenoh_platform.h"
+#define ZENOH_LOG_SUBSYSTEM UTILS
+#include "zenoh_log.h"
 #include <string.h>
+#include <stdlib.h>
+#if ZENOH_PLATFORM_HOST
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#else
+#include <esp_netif.h>
+#endif
 #include <stdio.h>
 
 static const char *TAG = "Z_UTIL";
@@ -21,18 +31,44 @@ const char* zenoh_utils_get_primary_listener() {
     return primary_listener;
 }
 
+#if ZENOH_PLATFORM_HOST
+// Host build: the first IPv4 interface that is up, preferring anything over loopback
+network_info_t active_network_interface(const char* log_prefix) {
+    network_info_t local_network_info = {0};
+    struct ifaddrs *ifaddr;
+    if (getifaddrs(&ifaddr) != 0) {
+        ZLOGE(TAG, "%s | getifaddrs failed", log_prefix);
+        return local_network_info;
+    }
+    const struct ifaddrs *pick = NULL;
+    for (const struct ifaddrs *ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET || !(ifa->ifa_flags & IFF_UP)) { continue; }
+        if (pick == NULL || ((pick->ifa_flags & IFF_LOOPBACK) && !(ifa->ifa_flags & IFF_LOOPBACK))) { pick = ifa; }
+    }
+    if (pick != NULL) {
+        inet_ntop(AF_INET, &((const struct sockaddr_in *)pick->ifa_addr)->sin_addr,
+                local_network_info.ip_address, sizeof(local_network_info.ip_address));
+        strncpy(local_network_info.interface_name, pick->ifa_name, sizeof(local_network_info.interface_name) - 1);
+        ZLOGI(TAG, "Active Iface: '%s', IP: %s", local_network_info.interface_name, local_network_info.ip_address);
+    } else {
+        ZLOGE(TAG, "%s | No IPv4 interface is up", log_prefix);
+    }
+    freeifaddrs(ifaddr);
+    return local_network_info;
+}
+#else
 // Get the active network interface
 network_info_t active_network_interface(const char* log_prefix) {
     network_info_t local_network_info = {0};
     esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
     if (!netif) {
-        ESP_LOGE(TAG, "%s | Could not get network interface handle.", log_prefix);
+        ZLOGE(TAG, "%s | Could not get network interface handle.", log_prefix);
         return local_network_info;
     }
 
     esp_netif_ip_info_t ip_info;
     if (esp_netif_get_ip_info(netif, &ip_info) != ESP_OK) {
-        ESP_LOGE(TAG, "%s | Failed to get IP info", log_prefix);
+        ZLOGE(TAG, "%s | Failed to get IP info", log_prefix);
         return local_network_info;
     }
 
@@ -44,12 +80,13 @@ network_info_t active_network_interface(const char* log_prefix) {
         strncpy(local_network_info.interface_name, "N/A", sizeof(local_network_info.interface_name));
     }
 
-    ESP_LOGI(TAG, "Active Iface: '%s', IP: %s",
+    ZLOGI(TAG, "Active Iface: '%s', IP: %s",
         local_network_info.interface_name,
         local_network_info.ip_address);
         
     return local_network_info;
 }
+#endif
 
 // Helper function to format a Zenoh ID into a printable string
 void format_zid(const z_id_t *zid, char *buffer, size_t len) {
@@ -57,3 +94,70 @@ void format_zid(const z_id_t *zid, char *buffer, size_t len) {
         sprintf(&buffer[i*2], "%02X", zid->id[i]);
     }
 }
+
+// Selector parameters: ';' separates entries, '=' separates key and value
+bool zenoh_utils_param_get(const char *params, size_t params_len, const char *key,
+        const char **value, size_t *value_len) {
+    size_t key_len = strlen(key);
+    size_t pos = 0;
+    while (params != NULL && pos < params_len) {
+        size_t end = pos;
+        while (end < params_len && params[end] != ';') { end++; }
+        size_t eq = pos;
+        while (eq < end && params[eq] != '=') { eq++; }
+        if (eq - pos == key_len && strncmp(&params[pos], key, key_len) == 0) {
+            *value = (eq < end) ? &params[eq + 1] : &params[end];
+            *value_len = (eq < end) ? end - eq - 1 : 0;
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+bool zenoh_utils_param_u32(const char *value, size_t value_len, uint32_t *out) {
+    if (value_len == 0 || value_len > 10) { return false; }
+    uint64_t v = 0;
+    for (size_t i = 0; i < value_len; i++) {
+        if (value[i] < '0' || value[i] > '9') { return false; }
+        v = v * 10 + (uint64_t)(value[i] - '0');
+    }
+    if (v > UINT32_MAX) { return false; }
+    *out = (uint32_t)v;
+    return true;
+}
+
+// A loaned sample is zenoh-pico's _z_sample_t: copy it by value, then point the copy at payload
+void zenoh_utils_sample_with_payload(const z_loaned_sample_t *sample,
+        const z_loaned_bytes_t *payload, z_loaned_sample_t *out) {
+    *out = *sample;
+    out->payload = *payload;
+}
+
+void zenoh_utils_sample_with_attachment(const z_loaned_sample_t *sample,
+        const z_loaned_bytes_t *attachment, z_loaned_sample_t *out) {
+    *out = *sample;
+    out->attachment = *attachment;
+}
+
+static void free_deleter(void *data, void *context) {
+    (void)context;
+    free(data);
+}
+
+bool zenoh_utils_bytes_copy(const z_loaned_bytes_t *src, z_owned_bytes_t *out) {
+    z_view_slice_t view;
+    if (z_bytes_get_contiguous_view(src, &view) == Z_OK) {
+        return z_bytes_copy_from_buf(out, z_slice_data(z_loan(view)), z_slice_len(z_loan(view))) == Z_OK;
+    }
+    size_t len = z_bytes_len(src);
+    uint8_t *data = (uint8_t *)malloc(len);
+    if (data == NULL) { return false; }
+    z_bytes_reader_t reader = z_bytes_get_reader(src);
+    z_bytes_reader_read(&reader, data, len);
+    if (z_bytes_from_buf(out, data, len, free_deleter, NULL) != Z_OK) {
+        free(data);
+        return false;
+    }
+    return true;
+}
@@ -3,6 +3,8 @@
 
 #include <zenoh-pico.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,7 +13,7 @@ extern "C" {
 // network interface and IP
 typedef struct {
     char ip_address[16];      // IPv4
-    char interface_name[8];   // "st1" or 'st0"
+    char interface_name[16];  // "st1" or 'st0" (host: "eth0", "lo", ...)
 } network_info_t;
 
 /**
@@ -40,6 +42,55 @@ network_info_t active_network_interface(const char* log_prefix);
  */
 void format_zid(const z_id_t *zid, char *buffer, size_t len);
 
+/**
+ * @brief Looks up a key in zenoh selector parameters ("k1=v1;k2=v2;flag").
+ *
+ * @param params Parameters string (not necessarily NUL terminated).
+ * @param params_len Length of params.
+ * @param key Key to look for (NUL terminated).
+ * @param value Set to the start of the value (inside params); empty for a bare flag.
+ * @param value_len Set to the value length.
+ * @return true if the key is present.
+ */
+bool zenoh_utils_param_get(const char *params, size_t params_len, const char *key,
+        const char **value, size_t *value_len);
+
+/**
+ * @brief Parses an unsigned decimal parameter value.
+ * @return true if the whole value is a number (and fits in 32 bits).
+ */
+bool zenoh_utils_param_u32(const char *value, size_t value_len, uint32_t *out);
+
+/**
+ * @brief Builds a view of a sample that carries a different payload.
+ *
+ * The original sample is not modified. Keyexpr, encoding, timestamp,
+ * attachment etc. of the view still reference it, so *out is only valid while
+ * both sample and payload are alive and must never be dropped. Used to hand
+ * unbatched records to a z_data_handler_t.
+ *
+ * @param sample Original sample.
+ * @param payload Payload the copy should expose.
+ * @param out Storage for the copy.
+ */
+void zenoh_utils_sample_with_payload(const z_loaned_sample_t *sample,
+        const z_loaned_bytes_t *payload, z_loaned_sample_t *out);
+
+/**
+ * @brief Same as zenoh_utils_sample_with_payload() for the attachment.
+ */
+void zenoh_utils_sample_with_attachment(const z_loaned_sample_t *sample,
+        const z_loaned_bytes_t *attachment, z_loaned_sample_t *out);
+
+/**
+ * @brief Copies the content of bytes into a heap buffer owned by *out.
+ *
+ * Unlike z_bytes_clone(), the copy does not reference the original slices,
+ * so it outlives a z_bytes_from_static_buf() source.
+ * @return false if out of memory (*out is then left unset).
+ */
+bool zenoh_utils_bytes_copy(const z_loaned_bytes_t *src, z_owned_bytes_t *out);
+
 #ifdef __cplusplus
 }
 #endif